@@ -1,17 +1,37 @@
 package.path = LUA_PATH
+-- Load modules through the chunk cache of the engine, so they are compiled only once.
+table.insert(package.searchers, 2, function(name)
+    local path = package.searchpath(name, package.path)
+    if (path == nil) then return nil end
+    local loader = API_LoadChunk(path)
+    if (type(loader) == "string") then return "\n\t" .. loader end
+    return loader, path
+end)
 require("logger")
 require("input")
 require("keys")
 require('ecs')
+require('scheduler')
 
 function C_SetupParam(instance, param_name)
-    if (_G[instance][param_name] == nil) then
-        _G[instance][param_name] = {}
+    if (instance[param_name] == nil) then
+        instance[param_name] = {}
     end
-    setmetatable(_G[instance][param_name], {
+    setmetatable(instance[param_name], {
         __newindex = function(self, index, value)
             rawset(self, index, value)
-            _G[instance].API_RegParam(index)
+            instance.API_RegParam(index)
         end,
     })
 end
+
+-- Call methods of script instances in a single loop. Used by LuaScriptSystem in batched mode.
+-- @param instances Array of instance tables.
+-- @param methods Array of methods of the instances (with the same order).
+-- Errors are logged, so that a failing script doesn't stop the others.
+function C_CallBatch(instances, methods, count, dt)
+    for i = 1, count do
+        local ok, err = pcall(methods[i], instances[i], dt)
+        if (not ok) then LogE(err) end
+    end
+end
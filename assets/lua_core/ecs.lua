@@ -1,23 +1,72 @@
 require('vector')
 
+-- Entities, whose components were changed through the wrappers since the last C_TakeChanges().
+-- C++ patches their components, so that the other systems (renderer, physics, ...) see the changes.
+local Changes = {}
+Changes.__index = Changes
+
+function Changes.new()
+    return setmetatable({ entities = {}, count = 0, marked = {} }, Changes)
+end
+
+function Changes:mark(entity)
+    if (self.marked[entity]) then return end
+    self.marked[entity] = true
+    self.count = self.count + 1
+    self.entities[self.count] = entity
+end
+
+-- Returns the array of entities and its length. The array is reused, so only the first `count` items are valid.
+function Changes:take()
+    local count = self.count
+    for i = 1, count do self.marked[self.entities[i]] = nil end
+    self.count = 0
+    return self.entities, count
+end
+
+local transform_changes, sprite_changes = Changes.new(), Changes.new()
+
 -- Create new component wrapper
--- @param component_name Name of the component in Components array defined in C++
--- @param component_def Table containing accept, get and set arrays. See TransformDef below.
-local function new_component(component_name, component_def)
+-- Fields are read and written through the usertype of the component. Vectors are returned as new Vec2/Vec3
+-- (copies), written without creating any C++ objects. Use the methods (for ex. Transform:Move(dx, dy))
+-- to avoid creating garbage every frame. Writes and modifying methods mark the component as changed.
+-- @param component Component usertype of the entity (from Components array defined in C++)
+-- @param component_def Table containing get, set, methods and modifiers arrays. See TransformDef below.
+-- @param changes Changes of the component type.
+-- @param entity Entity of the component.
+local function new_component(component, component_def, changes, entity)
+    local get, set = component_def.get, component_def.set
     local table = {}
+    -- Methods of the usertype are called on the component, not on the wrapper.
+    for _, name in ipairs(component_def.methods) do
+        local method = component[name]
+        table[name] = function(_, ...) return method(component, ...) end
+    end
+    for _, name in ipairs(component_def.modifiers) do
+        local method = component[name]
+        table[name] = function(_, ...)
+            method(component, ...)
+            changes:mark(entity)
+        end
+    end
+    -- Mark changes made through the usertype directly (for ex. Components.Transform.position:add(dx, dy)).
+    table.Changed = function() changes:mark(entity) end
     setmetatable(table, {
         __index = function(_, index)
-            if (component_def.accept[index] == nil) then return nil end
-            if (component_def.get[index] == nil) then return Components[component_name][index] end
-            return component_def.get[index]()
+            local getter = get[index]
+            if (getter == nil) then return nil end
+            if (getter == true) then return component[index] end
+            return getter(component)
         end,
         __newindex = function(_, index, value)
-            if (component_def.accept[index] == nil) then return end
-            if (component_def.set[index] == nil) then 
-                Components[component_name][index] = value 
-                return
+            local setter = set[index]
+            if (setter == nil) then return end
+            if (setter == true) then
+                component[index] = value
+            else
+                setter(component, value)
             end
-            component_def.set[index](value)
+            changes:mark(entity)
         end
     })
     return table
@@ -26,16 +75,22 @@ end
 --------------------------------
 ---------- Transform -----------
 --------------------------------
+-- true means the field is passed to the component as is.
 local TransformDef = {
-    accept = { position = 0, scale = 0, rotation = 0, layer = 0, dirty = 0 },
     get = {
-        position = function() return Vec2:new_from(Components.Transform.position) end,
-        scale = function() return Vec2:new_from(Components.Transform.scale) end
+        position = function(c) return Vec2:new(c:GetPosition()) end,
+        scale = function(c) return Vec2:new(c:GetScale()) end,
+        rotation = true, layer = true,
     },
     set = {
-        position = function(value) Components.Transform.position = glmvec2:new(value.x, value.y) end,
-        scale = function(value) Components.Transform.scale = glmvec2:new(value.x, value.y) end,
-    }
+        position = function(c, value) c:SetPosition(value.x, value.y) end,
+        scale = function(c, value) c:SetScale(value.x, value.y) end,
+        rotation = true, layer = true,
+        -- Removed, writing the transform doesn't move the body anymore.
+        dirty = function() error("Transform.dirty was removed, use Physics.Teleport(x, y) to move the body.", 3) end,
+    },
+    methods = { "GetPosition", "GetScale" },
+    modifiers = { "SetPosition", "Move", "SetScale" },
 }
 Transform = {
     -- Reprezents Transform component on this entity.
@@ -47,34 +102,78 @@ Transform = {
     rotation = 0,
     -- Rendering layer.
     layer = 0,
-    -- Set this to true if this component has a RigidBody component 
-    -- and you want to enforce Transform position for this frame.
-    dirty = false,
 }
--- We use Transform as a wrapper for Component.Transform defined as usertype in C++
-Transform = new_component("Transform", TransformDef) -- Above definition is for intellisense only.
+-- Transform of an entity with a RigidBody holds the state of the body after the last physics step (the sprite is rendered
+-- interpolated, see RenderTransformComponent). It is overwritten by the physics, move it with Physics.Teleport(x, y).
+-- Methods (don't allocate anything):
+--   Transform:GetPosition()     -- Returns x, y.
+--   Transform:SetPosition(x, y)
+--   Transform:Move(dx, dy)      -- Add to the position.
+--   Transform:GetScale()        -- Returns x, y.
+--   Transform:SetScale(x, y)
+--   Transform:Changed()         -- Notify the engine about changes made through Components.Transform directly.
+-- Above definition is for intellisense only. Each entity gets its own Transform, which is a wrapper
+-- for Components.Transform defined as usertype in C++ (see C_SetupEntity below).
 
 
 --------------------------------
 ------------ Sprite ------------
 --------------------------------
 SpriteDef = {
-    accept = { color = 0, ppu = 0 },
     get = {
-        color = function() return Vec2:new_from(Components.Sprite.color) end,
-        ppu = function() return Vec2:new_from(Components.Sprite.ppu) end,
+        color = function(c) return Vec3:new(c:GetColor()) end,
+        ppu = function(c) return Vec2:new(c:GetPPU()) end,
     },
     set = {
-        color = function(value) Components.Sprite.color = glmivec2:new(value.x, value.y) end,
-        ppu = function(value) 
-            value = Vec.floor(value)
-            Components.Sprite.ppu = glmivec2:new(value.x, value.y) 
-        end,
-    }
+        color = function(c, value) c:SetColor(math.floor(value.x), math.floor(value.y), math.floor(value.z)) end,
+        ppu = function(c, value) c:SetPPU(math.floor(value.x), math.floor(value.y)) end,
+    },
+    methods = { "GetColor", "GetPPU" },
+    modifiers = { "SetColor", "SetPPU" },
 }
 Sprite = {
-    color = Vec2:new(0, 0),
+    -- Color as r, g, b in range 0-255.
+    color = Vec3:new(0, 0, 0),
     -- Pixels per single unit.
     ppu = Vec2:new(0, 0)
 }
-Sprite = new_component("Sprite", SpriteDef)
+-- Methods (don't allocate anything):
+--   Sprite:GetColor()           -- Returns r, g, b.
+--   Sprite:SetColor(r, g, b)
+--   Sprite:GetPPU()             -- Returns x, y.
+--   Sprite:SetPPU(x, y)
+--   Sprite:Changed()            -- Notify the engine about changes made through Components.Sprite directly.
+
+
+-- Create component wrappers in the environment of an entity. Called from C++,
+-- when the first script is attached to the entity.
+-- Components.Transform and Components.Sprite are the usertypes itself. Their vector fields
+-- are views, which can be modified in place (for ex. Components.Transform.position:add(dx, dy)),
+-- but the engine doesn't see such changes until Transform:Changed() (or Sprite:Changed()) is called.
+-- @param env Environment of the entity containing Components array.
+-- @param entity Entity of the environment.
+function C_SetupEntity(env, entity)
+    env.Transform = new_component(env.Components.Transform, TransformDef, transform_changes, entity)
+    env.Sprite = new_component(env.Components.Sprite, SpriteDef, sprite_changes, entity)
+end
+
+-- Take entities with changed components. Called from C++ after the scripts are updated.
+-- @returns Array of entities with changed Transform and its length, the same for Sprite.
+function C_TakeChanges()
+    local transforms, transform_count = transform_changes:take()
+    local sprites, sprite_count = sprite_changes:take()
+    return transforms, transform_count, sprites, sprite_count
+end
+
+
+--------------------------------
+----------- Physics ------------
+--------------------------------
+-- Physics table is defined in C++. Collision layers are referenced by their names,
+-- fixtures by their index starting at 1 (nil means all fixtures).
+--   Physics.SetLayer(name, fixture)         -- Set collision layer of the fixture.
+--   Physics.GetLayer(fixture)               -- Name of the collision layer of the fixture ("" if it has none).
+--   Physics.SetLayersCollide(a, b, collide) -- Change the layer matrix of the scene.
+--   Physics.Mask(name, ...)                 -- Mask of the named layers for the queries.
+--   Physics.RaycastBatch(rays, mask)        -- rays = { x1, y1, x2, y2, ... }, returns entities (-1 = no hit) and fractions.
+--   Physics.OverlapBatch(boxes, max, mask)  -- boxes = { min_x, min_y, max_x, max_y, ... }, returns counts and entities.
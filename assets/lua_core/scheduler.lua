@@ -0,0 +1,220 @@
+-- Coroutine scheduler of the lua state.
+-- Scripts start coroutines with self:StartCoroutine(func, ...). Inside of them these functions suspend the coroutine:
+--     wait(seconds)       -- Resume after given time.
+--     wait_frames(n)      -- Resume after n frames (updates).
+--     wait_until(event)   -- Resume when signal(event, ...) is called. Returns the arguments of the signal.
+-- Waiting coroutines are stored in timer wheels, so they are not touched at all until they are due.
+-- Entity whose scripts only wait in coroutines (and have no OnUpdate) costs nothing per frame.
+
+-- Resolution of wait(seconds).
+local TICK = 0.01
+local WAIT_TIME, WAIT_FRAMES, WAIT_EVENT = 1, 2, 3
+
+-- Timer wheel. Slot of a timer is its due tick modulo the number of slots. Timers due after more than one
+-- revolution stay in their slot until they are due. Slots are flat arrays of (tick, coroutine) pairs.
+local Wheel = {}
+Wheel.__index = Wheel
+
+function Wheel.new(size)
+    local wheel = setmetatable({ size = size, slots = {}, now = 0 }, Wheel)
+    for i = 1, size do wheel.slots[i] = {} end
+    return wheel
+end
+
+function Wheel:add(tick, co)
+    local slot = self.slots[tick % self.size + 1]
+    slot[#slot + 1] = tick
+    slot[#slot + 1] = co
+end
+
+-- Move to the tick `now` and append coroutines, which are due, to `due`.
+function Wheel:advance(now, due)
+    local from = math.max(self.now + 1, now - self.size + 1)
+    self.now = now
+    for t = from, now do
+        local slot = self.slots[t % self.size + 1]
+        local n, keep = #slot, 0
+        for i = 1, n, 2 do
+            local tick, co = slot[i], slot[i + 1]
+            if (tick <= now) then
+                due[#due + 1] = co
+            else
+                slot[keep + 1], slot[keep + 2] = tick, co
+                keep = keep + 2
+            end
+        end
+        for i = keep + 1, n do slot[i] = nil end
+    end
+end
+
+Scheduler = {
+    -- Time and number of frames since the state was created.
+    time = 0,
+    frame = 0,
+}
+
+local time_wheel = Wheel.new(256)
+local frame_wheel = Wheel.new(64)
+-- Coroutines waiting for the event.
+local events = {}
+-- Event, which the coroutine waits for.
+local waits = {}
+-- Owner (script instance) of every living coroutine. Stopped coroutines are removed and skipped, when they are due.
+local owners = {}
+-- Coroutines of the owner as a set.
+local owned = setmetatable({}, { __mode = "k" })
+-- Instruction budget of the owner (see LuaScriptSystem::SetBudget()).
+local budgets = setmetatable({}, { __mode = "k" })
+-- Reused list of the due coroutines.
+local due = {}
+
+-- Remove the coroutine from the list of its event, so stopped coroutines don't pile up in events, which are never signaled.
+local function unwait(co)
+    local event = waits[co]
+    if (event == nil) then return end
+    waits[co] = nil
+    local waiting = events[event]
+    for i = #waiting, 1, -1 do
+        if (waiting[i] == co) then
+            table.remove(waiting, i)
+            break
+        end
+    end
+    if (#waiting == 0) then events[event] = nil end
+end
+
+local function forget(co)
+    local owner = owners[co]
+    owners[co] = nil
+    unwait(co)
+    if (owner ~= nil and owned[owner] ~= nil) then owned[owner][co] = nil end
+end
+
+local schedule
+
+local function resume(co, ...)
+    local owner = owners[co]
+    if (owner == nil) then return end
+
+    -- Coroutine has its own hook. Resumed from an update, it counts to the budget of the update. Otherwise it gets
+    -- the budget of its owner.
+    local limited = API_PrepareCoroutine(co, budgets[owner] or 0)
+    local ok, kind, arg = coroutine.resume(co, ...)
+    if (limited) then API_FinishCoroutine() end
+    if (not ok) then
+        LogE(debug.traceback(co, kind))
+        forget(co)
+    elseif (coroutine.status(co) == "dead") then
+        forget(co)
+    else
+        schedule(co, kind, arg)
+    end
+end
+
+schedule = function(co, kind, arg)
+    if (kind == WAIT_TIME) then
+        -- Never in the current tick, which was already processed.
+        time_wheel:add(math.max(math.ceil(arg / TICK), time_wheel.now + 1), co)
+    elseif (kind == WAIT_EVENT) then
+        local waiting = events[arg]
+        if (waiting == nil) then
+            waiting = {}
+            events[arg] = waiting
+        end
+        waiting[#waiting + 1] = co
+        waits[co] = arg
+    else
+        -- Plain coroutine.yield() waits for the next frame.
+        frame_wheel:add(kind == WAIT_FRAMES and arg or Scheduler.frame + 1, co)
+    end
+end
+
+local function check_coroutine(name)
+    local co = coroutine.running()
+    assert(owners[co] ~= nil, name .. "() must be called from a coroutine started by StartCoroutine().")
+end
+
+function wait(seconds)
+    check_coroutine("wait")
+    coroutine.yield(WAIT_TIME, Scheduler.time + seconds)
+end
+
+function wait_frames(n)
+    check_coroutine("wait_frames")
+    coroutine.yield(WAIT_FRAMES, Scheduler.frame + math.max(n, 1))
+end
+
+function wait_until(event)
+    check_coroutine("wait_until")
+    return coroutine.yield(WAIT_EVENT, event)
+end
+
+-- Resume all coroutines waiting for the event. Arguments are returned by their wait_until().
+function signal(event, ...)
+    local waiting = events[event]
+    if (waiting == nil) then return end
+    events[event] = nil
+    for i = 1, #waiting do
+        waits[waiting[i]] = nil
+    end
+    for i = 1, #waiting do
+        resume(waiting[i], ...)
+    end
+end
+
+-- Methods of all script instances.
+Script = {}
+
+-- Start coroutine calling func(self, ...). It runs until its first wait.
+-- @returns The coroutine, which can be passed to StopCoroutine().
+function Script:StartCoroutine(func, ...)
+    local co = coroutine.create(func)
+    owners[co] = self
+    owned[self] = owned[self] or {}
+    owned[self][co] = true
+    resume(co, self, ...)
+    return co
+end
+
+function Script:StopCoroutine(co)
+    if (owners[co] == self) then forget(co) end
+end
+
+-- Stop all coroutines of the script. Called from C++, when the script is destroyed.
+function Script:StopCoroutines()
+    local cos = owned[self]
+    if (cos == nil) then return end
+    for co in pairs(cos) do
+        owners[co] = nil
+        unwait(co)
+    end
+    owned[self] = nil
+end
+
+local ScriptMeta = { __index = Script }
+
+-- Give the instance table methods of Script. Called from C++, when the script is initialized.
+function C_SetupInstance(instance, instructions)
+    setmetatable(instance, ScriptMeta)
+    C_SetBudget(instance, instructions)
+end
+
+-- Set instruction budget of coroutines of the instance (0 means no limit). Called from C++.
+function C_SetBudget(instance, instructions)
+    budgets[instance] = instructions > 0 and instructions or nil
+end
+
+-- Advance the scheduler and resume due coroutines. Called from C++ once per frame.
+-- Components changed by the coroutines are marked by the component wrappers (see ecs.lua).
+function C_Tick(dt)
+    Scheduler.time = Scheduler.time + dt
+    Scheduler.frame = Scheduler.frame + 1
+
+    frame_wheel:advance(Scheduler.frame, due)
+    time_wheel:advance(math.floor(Scheduler.time / TICK), due)
+    for i = 1, #due do
+        local co = due[i]
+        due[i] = nil
+        resume(co)
+    end
+end
@@ -4,32 +4,59 @@
 -- Currently support vectors with 2 - 4 components. This could be extended by 
 -- editing 'comps' and 'n_comps' variables.
 -- Provides:
---     VecN - Vector with N components
+--     Vec4 - Vector with 4 components
 --     VecGen - Generic vector with up to n_comps components
+-- Vec2 and Vec3 are native types defined in C++ (see LuaVector.hpp). They have the same
+-- interface (x, y, z, size, operators, new, new_from) and work with the functions of Vec.
+-- Native and table vectors can be mixed in operators (Vec2 + { 1, 2 }, Vec2 * VecGen, ...), except:
+--     a == b           -- Always false between a native vector and a table (Lua compares them by type). Use Vec.equal(a, b).
+--     setmetatable(v)  -- Native vectors are userdata. Use Vec.to_table(v) to get a VecGen copy.
 
 local comps = { "x", "y", "z", "w" }
 local n_comps = 4
 
+-- Vec2 and Vec3 are userdata, table vectors are tables.
+local function native(v) return type(v) == "userdata" end
+
 -- Contains generic operations between generic vectors
 -- FIXME: Handle zero length vectors. Rigth now there is undefined behaiviour.
 Vec = {
     -- Dot product between two vectors.
     dot = function(a, b)
         assert(a.size == b.size, "Dot product must be between two vectors of the same number of components.")
+        if (native(a)) then return a:dot(b) end
+        if (native(b)) then return b:dot(a) end
 
         local res = 0
-        for i = 1, n_comps do
-            if (a[comps[i]] == nil) then return res end
+        for i = 1, a.size do
             res = res + a[comps[i]] * b[comps[i]]
         end
         return res
     end,
     -- Length of the vector.
     length = function(v)
+        if (native(v)) then return v:length() end
         return math.sqrt(Vec.dot(v, v))
     end,
+    -- Compare vectors of any kind.
+    equal = function(a, b)
+        if (a.size ~= b.size) then return false end
+        if (native(a)) then return a:equals(b) end
+        if (native(b)) then return b:equals(a) end
+        for i = 1, a.size do
+            if (a[comps[i]] ~= b[comps[i]]) then return false end
+        end
+        return true
+    end,
+    -- Copy of the vector as a table (VecGen).
+    to_table = function(v)
+        local res = {}
+        for i = 1, v.size do res[i] = v[comps[i]] end
+        return VecGen:new(res)
+    end,
     -- Convert vector to (x, y, ...) string.
     string = function(v)
+        if (native(v)) then return tostring(v) end
         local res = "("
         for i = 1, v.size do
             res = res .. v[comps[i]]
@@ -122,12 +149,11 @@ VecGenMeta = {
         return VecGen:new(res)
     end,
     __len = Vec.length,
+    -- The other operand can also be a native vector.
     __concat = function(a, b)
-        if (type(a) == "string" and type(b) == "table") then return a .. Vec.string(b) end
-        if (type(a) == "table" and type(b) == "string") then return Vec.string(a) .. b end
-        if (type(a) == "table" and type(b) == "table") then return Vec.string(a) .. ", " .. Vec.string(b) end
-        if (type(a) == "string" and type(b) == "string") then return a .. b end
-        return nil
+        if (type(a) == "string") then return a .. Vec.string(b) end
+        if (type(b) == "string") then return Vec.string(a) .. b end
+        return Vec.string(a) .. ", " .. Vec.string(b)
     end,
 }
 
@@ -154,28 +180,6 @@ function VecGen:new(components)
     return res
 end
 
-Vec2 = {}
-function Vec2:new(x, y)
-    local res = { size = 2, x = x, y = y }
-    setmetatable(res, VecGenMeta)
-    res.__index = self
-    return res
-end
-function Vec2:new_from(glmvec2)
-    return Vec2:new(glmvec2.x, glmvec2.y)
-end
-
-Vec3 = {}
-function Vec3:new(x, y, z)
-    local res = { size = 3, x = x, y = y, z = z }
-    setmetatable(res, VecGenMeta)
-    res.__index = self
-    return res
-end
-function Vec3:new_from(glmvec3)
-    return Vec3:new(glmvec3.x, glmvec3.y, glmvec3.z)
-end
-
 Vec4 = {}
 function Vec4:new(x, y, z, w)
     local res = { size = 4, x = x, y = y, z = z, w = w }
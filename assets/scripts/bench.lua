@@ -0,0 +1,11 @@
+Bench.p.speed = 1
+
+function Bench:OnInit()
+    self.time = 0
+    self.x, self.y = Transform:GetPosition()
+end
+
+function Bench:OnUpdate(dt)
+    self.time = self.time + dt * self.p.speed
+    Transform:SetPosition(self.x + math.sin(self.time), self.y + math.cos(self.time))
+end
@@ -0,0 +1,21 @@
+-- Coroutines running far more instructions than the budget of the script (see BenchmarkLayer::checkCoroutineBudget()).
+-- They should be aborted before they finish. Results are written to the global BudgetCheckResult table.
+local function spin(name)
+    for i = 1, 100000000 do end
+    BudgetCheckResult[name] = true
+end
+
+function BudgetCheck:OnInit()
+    -- Resumed by the scheduler in the next update.
+    self:StartCoroutine(function()
+        wait_frames(1)
+        BudgetCheckResult.ticked = true
+        spin("tick_finished")
+    end)
+    -- Resumed by LuaScriptSystem::Signal().
+    self:StartCoroutine(function()
+        wait_until("budget_check")
+        BudgetCheckResult.signaled = true
+        spin("signal_finished")
+    end)
+end
@@ -4,7 +4,7 @@ Test.p.stop = false
 
 function Test:OnInit()
     self.time = 0
-    self.orig_ppu = Sprite.ppu
+    self.ppu_x, self.ppu_y = Sprite:GetPPU()
 
     LogI(self.p.value1)
     LogI(self.p.name)
@@ -13,19 +13,33 @@ function Test:OnInit()
     else
         LogI("Don't stop")
     end
+
+    self:StartCoroutine(self.Blink)
+end
+
+-- Flash the sprite every second. The coroutine isn't resumed at all while it waits.
+function Test:Blink()
+    local r, g, b = Sprite:GetColor()
+    while true do
+        wait(1)
+        Sprite:SetColor(255, 64, 64)
+        wait_frames(10)
+        Sprite:SetColor(r, g, b)
+    end
 end
 
 function Test:OnUpdate(dt)
-    local dir = Vec2:new(0, 0)
+    -- Plain numbers and in-place methods, so that no garbage is created every frame.
+    local dx, dy = 0, 0
 
-    if (KeyHeld(KEY_W)) then dir.y = dir.y + 1 end
-    if (KeyHeld(KEY_S)) then dir.y = dir.y - 1 end
-    if (KeyHeld(KEY_A)) then dir.x = dir.x - 1 end
-    if (KeyHeld(KEY_D)) then dir.x = dir.x + 1 end
+    if (KeyHeld(KEY_W)) then dy = dy + 1 end
+    if (KeyHeld(KEY_S)) then dy = dy - 1 end
+    if (KeyHeld(KEY_A)) then dx = dx - 1 end
+    if (KeyHeld(KEY_D)) then dx = dx + 1 end
 
-    if (dir ~= {0, 0}) then
-        local norm_dir = dir / #dir
-        Transform.position = Transform.position + norm_dir * dt * 10
+    if (dx ~= 0 or dy ~= 0) then
+        local step = dt * 10 / math.sqrt(dx * dx + dy * dy)
+        Transform:Move(dx * step, dy * step)
     end
 
     local new_rot = Transform.rotation - 180 * dt
@@ -33,6 +47,6 @@ function Test:OnUpdate(dt)
     Transform.rotation = new_rot
 
     self.time = self.time + dt
-    Sprite.ppu = self.orig_ppu * (1 + math.abs(math.sin(self.time)))
+    local k = 1 + math.abs(math.sin(self.time))
+    Sprite:SetPPU(math.floor(self.ppu_x * k), math.floor(self.ppu_y * k))
 end
-
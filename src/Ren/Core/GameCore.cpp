@@ -7,6 +7,7 @@
 #include "Ren/Core/GameCore.hpp"
 #include "Ren/Core/Core.hpp"
 #include <algorithm>
+#include <cmath>
 #include <imgui_impl_sdl2.h>
 #include <imgui_impl_sdlrenderer2.h>
 #include "Ren/Core/Layer.hpp"
@@ -127,6 +128,19 @@ void GameCore::Loop() {
         ImGui_ImplSDL2_NewFrame();
         ImGui::NewFrame();
 
+        // User defined fixed update of all layers for every whole fixed step in accumulated time.
+        m_fixedAccumulator += delta_time;
+        for (int32_t step = 0; m_fixedAccumulator >= m_FixedTimeStep; step++) {
+            if (step == m_MaxFixedSteps) {
+                m_fixedAccumulator = std::fmod(m_fixedAccumulator, m_FixedTimeStep);
+                break;
+            }
+            for (auto&& layer : m_layerStack)
+                layer->OnFixedUpdate(m_FixedTimeStep);
+            OnFixedUpdate(m_FixedTimeStep);
+            m_fixedAccumulator -= m_FixedTimeStep;
+        }
+
         // User defined update of all layers.
         for (auto&& layer : m_layerStack)
             layer->OnUpdate(delta_time);
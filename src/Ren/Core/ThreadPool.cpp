@@ -0,0 +1,104 @@
+/**
+ * @file Ren/Core/ThreadPool.cpp
+ * @brief Implementation of thread pool used for data parallel work.
+ */
+#include <utility>
+
+#include "Ren/Core/ThreadPool.hpp"
+
+using namespace Ren;
+
+// Pool, whose job is being run by this thread.
+static thread_local const ThreadPool* t_currentPool = nullptr;
+
+ThreadPool::ThreadPool(std::size_t thread_count) {
+    m_workers.reserve(thread_count);
+    for (std::size_t i = 0; i < thread_count; i++)
+        m_workers.emplace_back(&ThreadPool::workerLoop, this);
+}
+ThreadPool::~ThreadPool() {
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_stop = true;
+    }
+    m_wake.notify_all();
+    for (auto&& worker : m_workers)
+        worker.join();
+}
+
+ThreadPool& ThreadPool::Global() {
+    static ThreadPool pool;
+    return pool;
+}
+
+void ThreadPool::ParallelFor(std::size_t count, const std::function<void(std::size_t)>& func) {
+    if (count == 0)
+        return;
+    // Not worth waking anyone up. Nested calls (from an item of a job) run on the calling thread as well.
+    if (count == 1 || m_workers.empty() || t_currentPool == this) {
+        for (std::size_t i = 0; i < count; i++)
+            func(i);
+        return;
+    }
+
+    std::lock_guard<std::mutex> job_lock(m_jobMutex);
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_func = &func;
+        m_count = count;
+        m_next = 0;
+        m_busy = m_workers.size();
+        m_error = nullptr;
+        m_generation++;
+    }
+    m_wake.notify_all();
+    work(func, count);
+
+    // Workers may still hold the function, so wait for all of them.
+    std::unique_lock<std::mutex> lock(m_mutex);
+    m_done.wait(lock, [this] { return m_busy == 0; });
+    m_func = nullptr;
+    if (std::exception_ptr error = std::exchange(m_error, nullptr)) {
+        lock.unlock();
+        std::rethrow_exception(error);
+    }
+}
+
+void ThreadPool::workerLoop() {
+    uint64_t generation = 0;
+    while (true) {
+        const std::function<void(std::size_t)>* func;
+        std::size_t count;
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            m_wake.wait(lock, [&] { return m_stop || m_generation != generation; });
+            if (m_stop)
+                return;
+            generation = m_generation;
+            func = m_func;
+            count = m_count;
+        }
+        work(*func, count);
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            if (--m_busy == 0)
+                m_done.notify_one();
+        }
+    }
+}
+void ThreadPool::work(const std::function<void(std::size_t)>& func, std::size_t count) {
+    t_currentPool = this;
+    for (std::size_t i = m_next.fetch_add(1, std::memory_order_relaxed); i < count; i = m_next.fetch_add(1, std::memory_order_relaxed)) {
+        // Exception must not escape a worker (std::terminate) nor skip the wait for the workers in ParallelFor().
+        try {
+            func(i);
+        } catch (...) {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            if (!m_error)
+                m_error = std::current_exception();
+            // Skip items, which didn't start yet.
+            m_next.store(count, std::memory_order_relaxed);
+        }
+    }
+    t_currentPool = nullptr;
+}
@@ -0,0 +1,141 @@
+/**
+ * @file Ren/ECS/CommandBuffer.cpp
+ * @brief Implementation of entity command buffer.
+ */
+#include <algorithm>
+#include <ren_utils/logging.hpp>
+
+#include "Ren/ECS/CommandBuffer.hpp"
+#include "Ren/ECS/ComponentSystems.hpp"
+
+using namespace Ren;
+
+DeferredEntity EntityCommandBuffer::Create(const TransformComponent& transform_comp, const TagList& tag_list) {
+    m_commands.creates.push_back({ transform_comp, tag_list });
+    return { uint32_t(m_commands.creates.size() - 1) };
+}
+void EntityCommandBuffer::Destroy(Target target) {
+    m_commands.destroys.push_back(target);
+}
+
+bool EntityCommandBuffer::Empty() const {
+    return m_commands.Empty();
+}
+
+void EntityCommandBuffer::Playback(Scene* scene) {
+    // Nested call (for ex. a handler calling Scene::PlaybackCommandBuffers()) is served by the next round of the outer one.
+    if (m_inPlayback)
+        return;
+    m_inPlayback = true;
+    // Recorded commands are moved out of the buffer before they are applied, so that handlers called during the playback
+    // can record new commands without invalidating the iterated ones. Those are applied in the next round.
+    for (uint32_t round = 0; round < MAX_PLAYBACK_ROUNDS && !m_commands.Empty(); round++) {
+        std::swap(m_playing, m_commands);
+        playback(scene, m_playing);
+        m_playing.Clear();
+        m_created.clear();
+    }
+    m_inPlayback = false;
+    if (!m_commands.Empty())
+        LOG_W("Commands keep recording other commands during playback. The rest is left for the next sync point.");
+}
+
+void EntityCommandBuffer::Clear() {
+    m_commands.Clear();
+}
+
+bool EntityCommandBuffer::Commands::Empty() const {
+    return creates.empty() && emplaces.empty() && removes.empty() && tags.empty() && destroys.empty();
+}
+void EntityCommandBuffer::Commands::Clear() {
+    creates.clear();
+    emplaces.clear();
+    removes.clear();
+    tags.clear();
+    destroys.clear();
+}
+
+void EntityCommandBuffer::playback(Scene* scene, Commands& commands) {
+    entt::registry& reg = *scene->m_Registry;
+
+    // Create all entities at once and insert their transforms in one go.
+    m_created.resize(commands.creates.size());
+    if (!commands.creates.empty()) {
+        std::vector<TransformComponent> transforms;
+        transforms.reserve(commands.creates.size());
+        for (auto&& create : commands.creates)
+            transforms.push_back(create.transform);
+
+        reg.create(m_created.begin(), m_created.end());
+        reg.insert<TransformComponent>(m_created.begin(), m_created.end(), transforms.data());
+        for (std::size_t i = 0; i < commands.creates.size(); i++)
+            for (auto&& tag : commands.creates[i].tags)
+                scene->AddTag(m_created[i], tag);
+    }
+
+    // Sort component commands by type, so that each storage is worked on contiguously.
+    // Stable sort keeps the order of commands for the same type.
+    std::stable_sort(commands.emplaces.begin(), commands.emplaces.end(), [](const EmplaceCommand& a, const EmplaceCommand& b) { return a.type < b.type; });
+    // Rigid bodies are created and destroyed in the physics world together with their components.
+    const entt::id_type rigid_body_type = entt::type_hash<RigidBodyComponent>::value();
+    PhysicsSystem* physics = scene->GetSystem<PhysicsSystem>();
+    for (auto&& emplace : commands.emplaces) {
+        entt::entity ent = resolve(emplace.target);
+        if (!reg.valid(ent))
+            continue;
+        if (emplace.type != rigid_body_type || !physics) {
+            emplace.emplace(reg, ent);
+            continue;
+        }
+
+        // Replaced body is removed from the world first.
+        if (auto rig = reg.try_get<RigidBodyComponent>(ent); rig && rig->Initialized())
+            physics->CleanupPhysicsBody(ent);
+        emplace.emplace(reg, ent);
+        // Component may be a copy of a living one, so it must not take over its body.
+        auto& rig = reg.get<RigidBodyComponent>(ent);
+        rig.p_body = nullptr;
+        rig.body_def.userData.pointer = 0;
+        rig.active_index = -1;
+        if (reg.all_of<TransformComponent>(ent))
+            physics->InitPhysicsBody(ent);
+    }
+
+    std::stable_sort(commands.removes.begin(), commands.removes.end(), [](const RemoveCommand& a, const RemoveCommand& b) { return a.type < b.type; });
+    std::vector<entt::entity> to_remove;
+    for (auto it = commands.removes.begin(); it != commands.removes.end();) {
+        // Remove components of the same type in one call.
+        auto type_end = std::find_if(it, commands.removes.end(), [type = it->type](const RemoveCommand& c) { return c.type != type; });
+        to_remove.clear();
+        for (auto cmd = it; cmd != type_end; cmd++) {
+            entt::entity ent = resolve(cmd->target);
+            if (reg.valid(ent))
+                to_remove.push_back(ent);
+        }
+        if (it->type == rigid_body_type && physics) {
+            for (entt::entity ent : to_remove)
+                if (auto rig = reg.try_get<RigidBodyComponent>(ent); rig && rig->Initialized())
+                    physics->CleanupPhysicsBody(ent);
+        }
+        it->remove(reg, to_remove.data(), to_remove.size());
+        it = type_end;
+    }
+
+    for (auto&& tag_cmd : commands.tags) {
+        entt::entity ent = resolve(tag_cmd.target);
+        if (!reg.valid(ent))
+            continue;
+        if (tag_cmd.add)
+            scene->AddTag(ent, tag_cmd.tag);
+        else
+            scene->RemTag(ent, tag_cmd.tag);
+    }
+
+    // Destroy entities last, so that other commands can still target them. Duplicates are ignored.
+    for (auto&& target : commands.destroys) {
+        entt::entity ent = resolve(target);
+        if (reg.valid(ent))
+            scene->DestroyEntity(scene->ToEntity(ent));
+    }
+}
+
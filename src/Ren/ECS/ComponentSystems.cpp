@@ -9,6 +9,10 @@
 #include "Ren/Physics/Physics.hpp"
 #include "Ren/Scripting/LuaScript.hpp"
 #include "Ren/ECS/Components.hpp"
+#include "Ren/Core/ThreadPool.hpp"
+
+#include <cmath>
+#include <algorithm>
 
 #include <ren_utils/logging.hpp>
 
@@ -16,18 +20,147 @@ using namespace Ren;
 
 #pragma region --> Render system
 
-void RenderSystem::Render() {
-    // Render all sprites.
+RenderSystem::RenderSystem(Scene* p_scene, KeyInterface* p_input)
+    : ComponentSystem(p_scene, p_input)
+{
+    auto& reg = *m_scene->m_Registry;
+    reg.on_construct<SpriteComponent>().connect<&RenderSystem::onChange>(this);
+    reg.on_update<SpriteComponent>().connect<&RenderSystem::onChange>(this);
+    reg.on_destroy<SpriteComponent>().connect<&RenderSystem::onChange>(this);
+    // Entity can get its sprite before the transform, so the transform is watched the same way.
+    reg.on_construct<TransformComponent>().connect<&RenderSystem::onChange>(this);
+    reg.on_update<TransformComponent>().connect<&RenderSystem::onChange>(this);
+    reg.on_destroy<TransformComponent>().connect<&RenderSystem::onChange>(this);
+    reg.on_construct<RenderTransformComponent>().connect<&RenderSystem::onChange>(this);
+    reg.on_update<RenderTransformComponent>().connect<&RenderSystem::onChange>(this);
+    reg.on_destroy<RenderTransformComponent>().connect<&RenderSystem::onChange>(this);
+}
+RenderSystem::~RenderSystem() {
+    auto& reg = *m_scene->m_Registry;
+    reg.on_construct<SpriteComponent>().disconnect(this);
+    reg.on_update<SpriteComponent>().disconnect(this);
+    reg.on_destroy<SpriteComponent>().disconnect(this);
+    reg.on_construct<TransformComponent>().disconnect(this);
+    reg.on_update<TransformComponent>().disconnect(this);
+    reg.on_destroy<TransformComponent>().disconnect(this);
+    reg.on_construct<RenderTransformComponent>().disconnect(this);
+    reg.on_update<RenderTransformComponent>().disconnect(this);
+    reg.on_destroy<RenderTransformComponent>().disconnect(this);
+}
+
+void RenderSystem::Init() {
+    Invalidate();
+}
+
+void RenderSystem::Invalidate() {
+    m_proxies.clear();
+    m_proxyIndex.clear();
+    m_insertedProxies.clear();
+    m_removedFrom = SIZE_MAX;
+    m_journal.clear();
+    std::fill(m_journaled.begin(), m_journaled.end(), entt::entity(entt::null));
     auto view = m_scene->SceneView<TransformComponent, SpriteComponent>();
     for (auto&& ent : view)
-    {
-        auto [trans, sprite] = view.get(ent);
-        Renderer::SetRenderLayer(trans.layer);
+        updateProxy(ent);
+    mergeProxies();
+}
+
+void RenderSystem::Render() {
+    flushJournal();
 
-        glm::vec2 size = sprite.GetSize();
+    // Proxies are already sorted by layer, so the renderer has nothing to reorder.
+    for (auto&& proxy : m_proxies) {
+        Renderer::SetRenderLayer(proxy.layer);
+        Renderer::RenderQuad({ proxy.pos, proxy.size }, proxy.rotation, proxy.color, proxy.texture);
+    }
+}
 
-        Renderer::RenderQuad({ trans.position - size * 0.5f, size }, trans.rotation, sprite.m_Color, sprite.GetTexture());
+void RenderSystem::onChange(entt::registry& reg, entt::entity ent) {
+    // Entity usually changes more times per frame (for ex. transform and sprite), but it is updated only once.
+    auto index = entt::to_entity(ent);
+    if (index >= m_journaled.size())
+        m_journaled.resize(index + 1, entt::null);
+    if (m_journaled[index] == ent)
+        return;
+    m_journaled[index] = ent;
+    m_journal.push_back(ent);
+}
+
+void RenderSystem::flushJournal() {
+    auto& reg = *m_scene->m_Registry;
+    for (auto&& ent : m_journal) {
+        auto& journaled = m_journaled[entt::to_entity(ent)];
+        if (journaled == ent)
+            journaled = entt::null;
+        if (reg.valid(ent) && reg.all_of<TransformComponent, SpriteComponent>(ent))
+            updateProxy(ent);
+        else
+            removeProxy(ent);
     }
+    m_journal.clear();
+    mergeProxies();
+}
+
+void RenderSystem::updateProxy(entt::entity ent) {
+    auto& reg = *m_scene->m_Registry;
+    auto [trans, sprite] = reg.get<TransformComponent, SpriteComponent>(ent);
+    auto render = reg.try_get<RenderTransformComponent>(ent);
+
+    // Proxy, which changed layer, is moved to its new place by the next merge.
+    auto it = m_proxyIndex.find(ent);
+    if (it != m_proxyIndex.end() && m_proxies[it->second].layer != trans.layer) {
+        removeProxy(ent);
+        it = m_proxyIndex.end();
+    }
+    RenderProxy* proxy = nullptr;
+    if (it == m_proxyIndex.end()) {
+        proxy = &m_insertedProxies.emplace_back();
+        proxy->ent = ent;
+        proxy->layer = trans.layer;
+    }
+    else
+        proxy = &m_proxies[it->second];
+
+    proxy->texture = sprite.GetTexture();
+    proxy->size = sprite.GetSize();
+    proxy->pos = (render ? render->position : trans.position) - proxy->size * 0.5f;
+    proxy->rotation = render ? render->rotation : trans.rotation;
+    proxy->color = sprite.m_Color;
+}
+
+void RenderSystem::removeProxy(entt::entity ent) {
+    auto it = m_proxyIndex.find(ent);
+    if (it == m_proxyIndex.end())
+        return;
+
+    // Proxies behind it keep their order, so they are only shifted by the next merge.
+    m_proxies[it->second].ent = entt::null;
+    m_removedFrom = std::min(m_removedFrom, it->second);
+    m_proxyIndex.erase(it);
+}
+
+void RenderSystem::mergeProxies() {
+    const auto by_layer = [](const RenderProxy& a, const RenderProxy& b) { return a.layer < b.layer; };
+
+    // Proxies before the first removed or inserted one don't move.
+    std::size_t first_moved = m_removedFrom;
+    if (m_removedFrom != SIZE_MAX) {
+        auto removed = std::remove_if(m_proxies.begin() + m_removedFrom, m_proxies.end(), [](const RenderProxy& p) { return p.ent == entt::null; });
+        m_proxies.erase(removed, m_proxies.end());
+        m_removedFrom = SIZE_MAX;
+    }
+    if (!m_insertedProxies.empty()) {
+        // Only the new proxies are sorted, the rest is sorted already.
+        std::stable_sort(m_insertedProxies.begin(), m_insertedProxies.end(), by_layer);
+        std::size_t middle = m_proxies.size();
+        auto first = std::upper_bound(m_proxies.begin(), m_proxies.end(), m_insertedProxies.front(), by_layer);
+        first_moved = std::min(first_moved, std::size_t(first - m_proxies.begin()));
+        m_proxies.insert(m_proxies.end(), m_insertedProxies.begin(), m_insertedProxies.end());
+        std::inplace_merge(m_proxies.begin() + first_moved, m_proxies.begin() + middle, m_proxies.end(), by_layer);
+        m_insertedProxies.clear();
+    }
+    for (std::size_t i = first_moved; i < m_proxies.size(); i++)
+        m_proxyIndex[m_proxies[i].ent] = i;
 }
 
 #pragma endregion
@@ -55,50 +188,179 @@ void NativeScriptSystem::Init() {
         script->OnInit();
     });
 }
+void NativeScriptSystem::InitScript(entt::entity ent) {
+    NativeScript* script = m_scene->m_Registry->get<NativeScriptComponent>(ent).script_instance;
+    if (!script)
+        return;
+    script->m_entity = Entity{ ent, m_scene };
+    script->m_input = m_input;
+    script->OnInit();
+}
+void NativeScriptSystem::DestroyScript(entt::entity ent) {
+    NativeScript* script = m_scene->m_Registry->get<NativeScriptComponent>(ent).script_instance;
+    if (script)
+        script->OnDestroy();
+}
 void NativeScriptSystem::Destroy() {
     for_each_native_script(m_scene, [](entt::entity ent, NativeScript* script) {
         script->OnDestroy();
     });
 }
+// Scripts change components through NativeScript::PatchComponent(), so the other systems are notified by the registry.
 void NativeScriptSystem::Update(float dt) {
-    for_each_native_script(m_scene, [&dt](entt::entity ent, NativeScript* script) {
+    for_each_native_script(m_scene, [&](entt::entity ent, NativeScript* script) {
         script->OnUpdate(dt);
     });
 }
+void NativeScriptSystem::FixedUpdate(float dt) {
+    for_each_native_script(m_scene, [&](entt::entity ent, NativeScript* script) {
+        script->OnFixedUpdate(dt);
+    });
+}
 #pragma endregion
 
 #pragma reqion --> LuaScript system
+sol::state& LuaScriptSystem::GetState() {
+    return *getLane(0).lua;
+}
+std::size_t LuaScriptSystem::GetMemoryUsed() {
+    std::size_t memory = 0;
+    for (auto&& lane : m_lanes)
+        memory += lane.lua->memory_used();
+    return memory;
+}
+LuaScriptSystem::StateStats LuaScriptSystem::GetStateStats(std::size_t index) const {
+    const Lane& lane = m_lanes.at(index);
+    StateStats stats;
+    if (LuaAllocator* allocator = LuaAllocator::Get(lane.lua->lua_state()))
+        stats.memory = allocator->GetStats();
+    stats.gc_ms = lane.gc_ms;
+    return stats;
+}
+LuaScriptSystem::Lane& LuaScriptSystem::getLane(std::size_t index) {
+    while (m_lanes.size() <= index) {
+        Lane lane;
+        lane.lua = LuaAllocator::CreateState();
+        if (m_gcBudget > 0.0f)
+            lane.lua->stop_gc();
+        LuaScript::register_bindings(*lane.lua, m_input);
+        lane.update.instances = lane.lua->create_table();
+        lane.update.methods = lane.lua->create_table();
+        lane.fixed_update.instances = lane.lua->create_table();
+        lane.fixed_update.methods = lane.lua->create_table();
+        lane.call_batch = (*lane.lua)["C_CallBatch"];
+        lane.tick = (*lane.lua)["C_Tick"];
+        lane.take_changes = (*lane.lua)["C_TakeChanges"];
+        lane.profiler = CreateRef<LuaProfiler>(lane.lua->lua_state());
+        lane.profiler->SetSampling(m_profiling, m_sampleInstructions);
+        m_lanes.push_back(std::move(lane));
+    }
+    return m_lanes[index];
+}
+
+void LuaScriptSystem::SetProfiling(bool profiling, uint32_t sample_instructions) {
+    m_profiling = profiling;
+    m_sampleInstructions = sample_instructions;
+    for (auto&& lane : m_lanes)
+        lane.profiler->SetSampling(profiling, sample_instructions);
+}
+LuaProfiler::Report LuaScriptSystem::GetProfile() const {
+    LuaProfiler::Report report;
+    for (auto&& lane : m_lanes)
+        report.Merge(lane.profiler->GetReport());
+    return report;
+}
+void LuaScriptSystem::ResetProfile() {
+    for (auto&& lane : m_lanes)
+        lane.profiler->Reset();
+}
+void LuaScriptSystem::SetBudget(LuaScript& script, const LuaBudget& budget) {
+    if (script.m_lane >= 0) {
+        Lane& lane = m_lanes[script.m_lane];
+        lane.budgeted += std::size_t(budget.Active()) - std::size_t(script.m_budget.Active());
+        // Coroutines of the script are resumed by the scheduler with its budget (see scheduler.lua).
+        (*lane.lua)["C_SetBudget"](script.m_instance, budget.instructions);
+    }
+    script.m_budget = budget;
+    script.m_updateThrottle = script.m_fixedUpdateThrottle = LuaThrottle{};
+}
+
+void LuaScriptSystem::Signal(const std::string& event) {
+    forEachLane([&event](Lane& lane) {
+        sol::protected_function signal = (*lane.lua)["signal"];
+        sol::protected_function_result result = signal(event);
+        if (!result.valid()) {
+            sol::error err = result;
+            LOG_E("Signal '" + event + "' failed: " + err.what());
+        }
+    });
+}
+void LuaScriptSystem::Defer(std::function<void()> func) {
+    if (!m_inParallel) {
+        func();
+        return;
+    }
+    std::lock_guard<std::mutex> lock(m_deferredMutex);
+    m_deferred.push_back(std::move(func));
+}
+
 void LuaScriptSystem::InitScript(entt::entity ent, std::string name) {
+    auto& comp = m_scene->m_Registry->get<LuaScriptComponent>(ent);
+    InitScript(ent, comp.scripts.at(name));
+}
+void LuaScriptSystem::InitScript(entt::entity ent, Ref<LuaScript> script) {
+    // Lanes and their batches can't change while they are updated.
+    if (m_inParallel) {
+        Defer([this, ent, script]() { InitScript(ent, script); });
+        return;
+    }
     // Set data the script needs and initialize it.
     Entity e = { ent, m_scene };
     auto& comp = e.Get<LuaScriptComponent>();
-    auto& script = comp.scripts.at(name);
+    // First script of the entity creates its environment (in the next lane in parallel mode).
+    if (!comp.env.valid()) {
+        comp.lua = getLane(m_stateCount > 1 ? m_nextLane++ % m_stateCount : 0).lua;
+        comp.env = LuaScript::create_environment(*comp.lua, e);
+    }
+    auto lane = std::find_if(m_lanes.begin(), m_lanes.end(), [&comp](const Lane& l) { return l.lua == comp.lua; });
+    REN_ASSERT(lane != m_lanes.end(), "Lua state of the component doesn't belong to this scene.");
+
     script->m_entity = e;
     script->m_input = m_input;
+    script->m_lua = comp.lua.get();
+    script->m_env = comp.env;
+    script->m_lane = int32_t(lane - m_lanes.begin());
+    if (script->m_budget.Active())
+        lane->budgeted++;
     script->init();
-    script->OnInit();
-}
-void LuaScriptSystem::InitScript(entt::entity ent, Ref<LuaScript> script) {
-    script->m_entity = { ent, m_scene };
-    script->m_input = m_input;
-    script->init();
+    addToBatch(lane->update, script.get(), &LuaScript::m_updateIndex, script->m_onUpdate);
+    addToBatch(lane->fixed_update, script.get(), &LuaScript::m_fixedUpdateIndex, script->m_onFixedUpdate);
     script->OnInit();
 }
 
 void LuaScriptSystem::DestroyScript(entt::entity ent, std::string name) {
-    Entity e = { ent, m_scene };
-    auto& comp = e.Get<LuaScriptComponent>();
-    auto& script = comp.scripts.at(name);
-    script->OnDestroy();
-    script->destroy();
-    script->m_entity = Entity{};
-    script->m_input = nullptr;
+    auto& comp = m_scene->m_Registry->get<LuaScriptComponent>(ent);
+    DestroyScript(ent, comp.scripts.at(name));
 }
 void LuaScriptSystem::DestroyScript(entt::entity ent, Ref<LuaScript> script) {
+    if (m_inParallel) {
+        Defer([this, ent, script]() { DestroyScript(ent, script); });
+        return;
+    }
     script->OnDestroy();
+    if (script->m_lane >= 0) {
+        Lane& lane = m_lanes[script->m_lane];
+        if (script->m_budget.Active())
+            lane.budgeted--;
+        removeFromBatch(lane.update, script.get(), &LuaScript::m_updateIndex);
+        removeFromBatch(lane.fixed_update, script.get(), &LuaScript::m_fixedUpdateIndex);
+    }
     script->destroy();
     script->m_entity = Entity{};
     script->m_input = nullptr;
+    script->m_lua = nullptr;
+    script->m_env = sol::environment{};
+    script->m_lane = -1;
 }
 
 template<typename Func>
@@ -111,156 +373,388 @@ void for_each_lua_script(Scene* scene, Func pred) {
     }
 }
 void LuaScriptSystem::Init() {
-    for_each_lua_script(m_scene, [this](entt::entity ent, Ref<LuaScript> script){
+    for_each_lua_script(m_scene, [this](entt::entity ent, const Ref<LuaScript>& script){
         InitScript(ent, script);
     });
 }
 void LuaScriptSystem::Destroy() {
-    for_each_lua_script(m_scene, [this](entt::entity ent, Ref<LuaScript> script){
+    for_each_lua_script(m_scene, [this](entt::entity ent, const Ref<LuaScript>& script){
         DestroyScript(ent, script);
     });
 }
 void LuaScriptSystem::Update(float dt) {
-    for_each_lua_script(m_scene, [dt](entt::entity ent, Ref<LuaScript> script){
-        script->OnUpdate(dt);
+    update(&Lane::update, &LuaScript::OnUpdate, &LuaScript::m_updateThrottle, dt, true);
+    if (m_gcBudget > 0.0f)
+        CollectGarbage(m_gcBudget);
+}
+void LuaScriptSystem::FixedUpdate(float dt) {
+    update(&Lane::fixed_update, &LuaScript::OnFixedUpdate, &LuaScript::m_fixedUpdateThrottle, dt);
+}
+
+void LuaScriptSystem::SetGCBudget(float budget_ms) {
+    m_gcBudget = std::max(budget_ms, 0.0f);
+    for (auto&& lane : m_lanes) {
+        if (m_gcBudget > 0.0f)
+            lane.lua->stop_gc();
+        else
+            lane.lua->restart_gc();
+    }
+}
+void LuaScriptSystem::CollectGarbage(float budget_ms) {
+    using Clock = std::chrono::steady_clock;
+    forEachLane([budget_ms](Lane& lane) {
+        // Steps work even when the collector is stopped.
+        auto start = Clock::now();
+        float elapsed = 0.0f;
+        do {
+            if (lane.lua->step_gc(0))
+                break;  // Cycle finished.
+            elapsed = std::chrono::duration<float, std::milli>(Clock::now() - start).count();
+        } while (elapsed < budget_ms);
+        lane.gc_ms = std::chrono::duration<float, std::milli>(Clock::now() - start).count();
     });
 }
+
+void LuaScriptSystem::addToBatch(Batch& batch, LuaScript* script, int32_t LuaScript::* index, const sol::protected_function& method) {
+    if (!method.valid() || script->*index >= 0)
+        return;
+    script->*index = int32_t(batch.scripts.size());
+    batch.scripts.push_back(script);
+    batch.instances.raw_set(batch.scripts.size(), script->m_instance);
+    batch.methods.raw_set(batch.scripts.size(), method);
+}
+void LuaScriptSystem::removeFromBatch(Batch& batch, LuaScript* script, int32_t LuaScript::* index) {
+    int32_t i = script->*index;
+    if (i < 0)
+        return;
+    // Move the last script into the free slot.
+    std::size_t last = batch.scripts.size();
+    LuaScript* moved = batch.scripts.back();
+    batch.scripts[i] = moved;
+    moved->*index = i;
+    batch.instances.raw_set(i + 1, batch.instances.raw_get<sol::object>(last));
+    batch.methods.raw_set(i + 1, batch.methods.raw_get<sol::object>(last));
+    batch.instances.raw_set(last, sol::lua_nil);
+    batch.methods.raw_set(last, sol::lua_nil);
+    batch.scripts.pop_back();
+    script->*index = -1;
+}
+void LuaScriptSystem::runBatch(Lane& lane, Batch& batch, void (LuaScript::* method)(float), LuaThrottle LuaScript::* throttle, float dt) {
+    // Budgets and profiling need to know, which script is running.
+    if (m_batched && !m_profiling && lane.budgeted == 0) {
+        if (batch.scripts.empty())
+            return;
+        sol::protected_function_result result = lane.call_batch(batch.instances, batch.methods, batch.scripts.size(), dt);
+        if (!result.valid()) {
+            sol::error err = result;
+            LOG_E(std::string("Batched Lua update failed: ") + err.what());
+        }
+        return;
+    }
+
+    // Scripts may be initialized or destroyed by other scripts, so don't hold an iterator.
+    for (std::size_t i = 0; i < batch.scripts.size(); i++) {
+        LuaScript* script = batch.scripts[i];
+        if (m_profiling || script->m_budget.Active())
+            runScript(lane, script, method, throttle, dt);
+        else
+            (script->*method)(dt);
+    }
+}
+void LuaScriptSystem::runScript(Lane& lane, LuaScript* script, void (LuaScript::* method)(float), LuaThrottle LuaScript::* throttle, float dt) {
+    using Clock = std::chrono::steady_clock;
+    const LuaBudget& budget = script->m_budget;
+    // Throttled script skips the call, but gets the whole skipped time in the next one.
+    LuaThrottle& t = script->*throttle;
+    if (t.skip > 0) {
+        t.skip--;
+        t.dt += dt;
+        return;
+    }
+    dt += t.dt;
+    t.dt = 0.0f;
+
+    lane.profiler->BeginCall(budget.instructions);
+    auto start = Clock::now();
+    (script->*method)(dt);
+    double ms = std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+    lane.profiler->EndCall();
+
+    if (m_profiling)
+        lane.profiler->AddScriptCall(script->m_scriptPath.string(), script->m_entity.id, ms);
+    if (budget.time_ms > 0.0f && ms > budget.time_ms)
+        t.skip = std::min(int32_t(ms / budget.time_ms), LuaBudget::MAX_SKIP);
+}
+void LuaScriptSystem::update(Batch Lane::* batch, void (LuaScript::* method)(float), LuaThrottle LuaScript::* throttle, float dt, bool tick) {
+    forEachLane([&](Lane& lane) {
+        runBatch(lane, lane.*batch, method, throttle, dt);
+        if (tick)
+            this->tick(lane, dt);
+        takeChanges(lane);
+    });
+
+    // Registry is not thread-safe, so the changed components are patched once all scripts are done.
+    auto& reg = *m_scene->m_Registry;
+    for (auto&& lane : m_lanes) {
+        for (entt::entity ent : lane.changed_transforms)
+            if (reg.valid(ent) && reg.all_of<TransformComponent>(ent))
+                reg.patch<TransformComponent>(ent);
+        for (entt::entity ent : lane.changed_sprites)
+            if (reg.valid(ent) && reg.all_of<SpriteComponent>(ent))
+                reg.patch<SpriteComponent>(ent);
+    }
+}
+void LuaScriptSystem::tick(Lane& lane, float dt) {
+    lane.profiler->BeginCall();
+    sol::protected_function_result result = lane.tick(dt);
+    lane.profiler->EndCall();
+    if (!result.valid()) {
+        sol::error err = result;
+        LOG_E(std::string("Lua scheduler failed: ") + err.what());
+    }
+}
+void LuaScriptSystem::takeChanges(Lane& lane) {
+    lane.changed_transforms.clear();
+    lane.changed_sprites.clear();
+    sol::protected_function_result result = lane.take_changes();
+    if (!result.valid()) {
+        sol::error err = result;
+        LOG_E(std::string("Taking changes of Lua scripts failed: ") + err.what());
+        return;
+    }
+    // Arrays of entities are reused by Lua, so only their first `count` items are valid.
+    const auto read = [](const sol::table& entities, std::size_t count, std::vector<entt::entity>& out) {
+        for (std::size_t i = 1; i <= count; i++)
+            out.push_back(entt::entity(entities.raw_get<entt::id_type>(i)));
+    };
+    read(result.get<sol::table>(0), result.get<std::size_t>(1), lane.changed_transforms);
+    read(result.get<sol::table>(2), result.get<std::size_t>(3), lane.changed_sprites);
+}
+void LuaScriptSystem::forEachLane(const std::function<void(Lane&)>& func) {
+    if (m_lanes.size() <= 1) {
+        for (auto&& lane : m_lanes)
+            func(lane);
+        return;
+    }
+
+    // Lua states are independent, so each of them can run on a different thread.
+    m_inParallel = true;
+    ThreadPool::Global().ParallelFor(m_lanes.size(), [&](std::size_t i) { func(m_lanes[i]); });
+    m_inParallel = false;
+
+    std::vector<std::function<void()>> deferred;
+    {
+        std::lock_guard<std::mutex> lock(m_deferredMutex);
+        deferred.swap(m_deferred);
+    }
+    for (auto&& f : deferred)
+        f();
+}
 #pragma endregion
 
 #pragma region --> Physics system
 PhysicsSystem::PhysicsSystem(Scene* scene, KeyInterface* input)
     : ComponentSystem(scene, input)
-    , m_physWorld(CreateRef<b2World>(GRAVITY))
-    , m_contactListener(this)
 {
-    m_physWorld->SetContactListener(&m_contactListener);
+    AddShard();
+    m_physWorld = m_shards.GetWorld(0);
+}
+PhysicsSystem::~PhysicsSystem() {
+    stopThread();
 }
 // Physics system.
 void PhysicsSystem::Init() {
     auto view = m_scene->SceneView<RigidBodyComponent>();
     for (auto&& ent : view)
         InitPhysicsBody(ent);
+    rebuildStaticGeometry();
 }
 void PhysicsSystem::Destroy() {
+    // Finish all pending work of the physics thread.
+    SetThreaded(false);
 
-    // Destroy all bodies in world when the world is deleted.
-    for (b2Body* body = m_physWorld->GetBodyList(); body;) {
-        b2Body* next = body->GetNext();
-        Entity* ent = reinterpret_cast<Entity*>(body->GetUserData().pointer);
-        CleanupPhysicsBody(ent->id);
-        body = next;
-    }
-
+    // Bodies don't own any other data, so they are released together with the world.
     // Set pointers of the components to null, so that they don't point to free'd memory.
     auto view = m_scene->SceneView<RigidBodyComponent>();
     for (auto&& ent : view) {
         auto [r] = view.get(ent);
         r.p_body = nullptr;
+        r.body_def.userData.pointer = 0;
+        r.active_index = -1;
     }
+    m_activeBodies.clear();
+    m_teleports.clear();
+    m_scene->m_Registry->clear<RenderTransformComponent>();
 
-    m_physWorld.reset();
+    m_staticGeometry.Clear();
+    m_stepContacts.clear();
+    m_physWorld = nullptr;
+    m_shards.Clear();
 }
 void PhysicsSystem::Update(float dt) {
     if (!m_physWorld)
         return;
+    rebuildStaticGeometry();
+    if (m_threaded) {
+        syncFromThread();
+        return;
+    }
 
-    // Update physics.
-    m_physWorld->Step(dt, m_VelocityIterations, m_PositionIterations);
+    auto& reg = *m_scene->m_Registry;
 
-    // Sync TransformComponent position with RigidBodyComponent position.
-    // TODO: Call collision callbacks.
-    auto view = m_scene->SceneView<TransformComponent, RigidBodyComponent>();
-    for (auto&& ent : view) {
-        auto [trans, rig] = view.get(ent);
-        if (trans.dirty) {
-            rig.p_body->SetTransform(Utils::to_b2Vec2(trans.position), rig.p_body->GetAngle());
-            trans.dirty = false;
+    // Apply transforms enforced by Teleport(). Body is woken up, so that it is synced from now on.
+    for (entt::entity ent : m_teleports) {
+        if (!reg.valid(ent) || !reg.all_of<TransformComponent, RigidBodyComponent>(ent))
+            continue;
+        auto [trans, rig] = reg.get<TransformComponent, RigidBodyComponent>(ent);
+        if (!rig.p_body)
+            continue;
+        rig.p_body->SetTransform(Utils::to_b2Vec2(trans.position), rig.p_body->GetAngle());
+        rig.p_body->SetAwake(true);
+        if (rig.active_index >= 0) {
+            m_activeBodies[rig.active_index].prev_position = rig.p_body->GetPosition();
+            m_activeBodies[rig.active_index].prev_angle = rig.p_body->GetAngle();
         }
         else
-            trans.position = Utils::to_vec2(rig.p_body->GetPosition());
-        trans.rotation = rig.p_body->GetAngle() * (180.0f / 3.141592f);
+            trackBody(rig.p_body, false);
+    }
+    m_teleports.clear();
+
+    // Transforms of the active bodies were synced by the last step. Bodies are rendered somewhere between the last two
+    // fixed steps at this point of time.
+    float alpha = m_Interpolate ? m_scene->GetFixedAlpha() : 1.0f;
+    for (std::size_t i = 0; i < m_activeBodies.size();) {
+        ActiveBody& active = m_activeBodies[i];
+        // Bodies, which fell asleep, are rendered at their final state (transform) and removed from the list.
+        bool asleep = !active.body->IsAwake();
+        setRenderTransform(active.ent, active.prev_position, active.prev_angle, active.body->GetPosition(), active.body->GetAngle(), asleep ? 1.0f : alpha);
+        if (asleep)
+            removeActiveBody(i);
+        else
+            i++;
     }
 }
+void PhysicsSystem::FixedUpdate(float dt) {
+    // Physics thread steps the world on its own.
+    if (!m_physWorld || m_threaded)
+        return;
+    rebuildStaticGeometry();
+    // Bodies woken up by the commands are tracked by Enqueue().
+    runCommands();
+
+    // Remember the state before the step for interpolation.
+    for (auto&& active : m_activeBodies) {
+        active.prev_position = active.body->GetPosition();
+        active.prev_angle = active.body->GetAngle();
+    }
+
+    std::vector<CreatedBody> migrated;
+    {
+        auto lock = LockWorld();
+        stepShards(ThreadPool::Global(), dt, migrated);
+    }
+    auto& reg = *m_scene->m_Registry;
+    for (auto&& m : migrated) {
+        auto rig = reg.try_get<RigidBodyComponent>(m.ent);
+        if (!rig)
+            continue;
+        rig->p_body = m.body;
+        if (rig->active_index >= 0)
+            m_activeBodies[rig->active_index].body = m.body;
+        else
+            trackBody(m.body, true);
+    }
+    updateActiveBodies();
+
+    // Transforms hold the state after the step, so the game reads the same state as the physics. Patch, so that
+    // the others (for ex. render system) are notified about the change.
+    for (auto&& active : m_activeBodies) {
+        reg.patch<TransformComponent>(active.ent, [&active](TransformComponent& trans) {
+            trans.position = Utils::to_vec2(active.body->GetPosition());
+            trans.rotation = glm::degrees(active.body->GetAngle());
+        });
+    }
+
+    // Handlers are called after the step, so they can modify the world.
+    std::vector<ContactEvent> contacts;
+    contacts.swap(m_stepContacts);
+    dispatchContacts(contacts);
+    // Keep the memory for the next step.
+    contacts.clear();
+    if (m_stepContacts.empty())
+        m_stepContacts.swap(contacts);
+}
 void PhysicsSystem::Render() {
     if (!m_DebugRender)
         return;
 
+    m_debugDraw.SetFlags(m_DebugDrawFlags);
+    m_debugDraw.Clear();
+    {
+        auto lock = LockWorld();
+        for (b2World* world : m_shards.GetWorlds())
+            m_debugDraw.Draw(*world, Ren::Renderer::GetViewMin(), Ren::Renderer::GetViewMax());
+    }
     Ren::Renderer::SetRenderLayer(1000);
-    const auto draw_body = [&](b2Body* body){
-        glm::vec2 pos = Utils::to_vec2(body->GetPosition());
-
-        REN_ASSERT(body->GetFixtureList(), "Body does not have a fixture!");
-
-        // Pre-calculate sin and cos for polygon rotation purposes.
-        float sin_a = std::sin(body->GetAngle());
-        float cos_a = std::cos(body->GetAngle());
-        const auto rot_point = [sin_a, cos_a](const glm::vec2& p) -> glm::vec2 {
-            return { p.x * cos_a - p.y * sin_a,
-                     p.x * sin_a + p.y * cos_a };
-        };
-
-        for (auto fix = body->GetFixtureList(); fix; fix = fix->GetNext()) {
-            switch (fix->GetShape()->GetType()) {
-            case b2Shape::Type::e_polygon: {
-                b2PolygonShape* shape = (b2PolygonShape*)fix->GetShape();
-
-                // If polygon is rectangle and is not offseted, we can render it as a retangle.
-                if (shape->m_count == 4 && Utils::to_vec2(shape->m_centroid) == glm::vec2(0.0f)) {
-                    Ren::Rect rect{ pos + Utils::to_vec2(shape->m_vertices[0]), Utils::to_vec2(shape->m_vertices[2]) - Utils::to_vec2(shape->m_vertices[0]) };
-                    Ren::Renderer::DrawRect(rect, glm::degrees(body->GetAngle()), Ren::Colors4::White);
-                }
-                // Otherwise we render lines between every vertex.
-                else {
-                    for (int i = 0; i < shape->m_count; i++) {
-                        glm::vec2 a = Utils::to_vec2(shape->m_vertices[i]);
-                        glm::vec2 b = Utils::to_vec2(shape->m_vertices[(i + 1) % shape->m_count]);
-                        a = rot_point(a) + pos;
-                        b = rot_point(b) + pos;
-
-                        Ren::Renderer::DrawLine(a, b, Ren::Colors4::White);
-                    }
-                }
-                } break;
-            case b2Shape::Type::e_circle: {
-                b2CircleShape* shape = (b2CircleShape*)fix->GetShape();
-                Ren::Renderer::DrawCircle(pos + Utils::to_vec2(shape->m_p), shape->m_radius, Ren::Colors4::White);
-                } break;
-            default:
-                LOG_W("Only polygon and circle shapes are supported for debug printing.");
-                break;
-            }
-        }
-
-    };
-    for (b2Body* body = m_physWorld->GetBodyList(); body; body = body->GetNext())
-        draw_body(body);
+    Ren::Renderer::DrawBatch(&m_debugDraw.GetBatch());
 }
-void PhysicsSystem::InitPhysicsBody(entt::entity raw_ent) {
+void PhysicsSystem::InitPhysicsBody(entt::entity raw_ent, bool keep_body_pose) {
     Entity ent = { raw_ent, m_scene };
     REN_ASSERT((ent.HasAll<RigidBodyComponent, TransformComponent>()), "Body must have RigidBodyComponent and TransformComponent to be initialized in physics world.");
 
     auto [rig, trans] = ent.GetM<RigidBodyComponent, TransformComponent>();
 
-    // Body was already initialized.
-    if (rig.p_body)
+    // Body was already initialized (or it is being created by the physics thread).
+    if (rig.Initialized())
         return;
 
     // By default, position body at its transform.
-    rig.body_def.position = Utils::to_b2Vec2(trans.position);
+    if (!keep_body_pose) {
+        rig.body_def.position = Utils::to_b2Vec2(trans.position);
+    }
+    else {
+        m_scene->m_Registry->patch<TransformComponent>(raw_ent, [&rig](TransformComponent& t) {
+            t.position = Utils::to_vec2(rig.body_def.position);
+            t.rotation = glm::degrees(rig.body_def.angle);
+        });
+    }
 
-    // Each body has a custom data pointer to Entity structure allocated on heap (to be freed in Scene::CleanupPhysicsBody)
-    Entity* p_entity = new Entity();
-    *p_entity = ent;
-    rig.body_def.userData.pointer = reinterpret_cast<uintptr_t>(p_entity);
+    // Body knows its entity through the user data.
+    rig.body_def.userData.pointer = Utils::to_user_data(raw_ent);
 
-    // Create body in physics world.
-    rig.p_body = m_physWorld->CreateBody(&rig.body_def);
+    // Static geometry is merged with its neighbours instead (bodies are rebuilt before the next step).
+    if (rig.static_geometry && addStaticTile(raw_ent, rig))
+        return;
+
+    uint32_t shard = shardOf(rig);
+
+    // Body is created by the physics thread and handed over in syncFromThread().
+    if (m_threaded) {
+        // Layers are resolved here, the thread doesn't touch the scene. Captured fixtures keep the shapes alive.
+        std::vector<b2FixtureDef> fixture_defs;
+        for (auto&& fixture : rig.fixtures)
+            fixture_defs.push_back(fixtureDef(fixture));
+        Enqueue([this, raw_ent, shard, body_def = rig.body_def, fixtures = rig.fixtures, fixture_defs = std::move(fixture_defs)](b2World&) mutable {
+            b2Body* body = m_shards.GetWorld(shard)->CreateBody(&body_def);
+            for (auto&& fixture_def : fixture_defs)
+                body->CreateFixture(&fixture_def);
+            m_threadBodies[raw_ent] = body;
+
+            std::lock_guard<std::mutex> lock(m_fromThreadMutex);
+            m_createdBodies.push_back({ raw_ent, body, body_def.userData.pointer });
+        });
+        return;
+    }
+
+    // Create body in physics world. Awake body is synced right away.
+    rig.p_body = m_shards.GetWorld(shard)->CreateBody(&rig.body_def);
+    trackBody(rig.p_body, false);
 
     // Create all fixtures of a body.
-    for (auto&& [p_shape, fixture_def] : rig.fixtures) {
-        REN_ASSERT(p_shape, "Body must have a shape. Entity tag = " + ent.GetTags().front());
+    for (auto&& fixture : rig.fixtures) {
+        REN_ASSERT(fixture.shape, "Body must have a shape. Entity tag = " + ent.GetTags().front());
 
-        fixture_def.shape = p_shape.get();
+        b2FixtureDef fixture_def = fixtureDef(fixture);
         rig.p_body->CreateFixture(&fixture_def);
     }
 }
@@ -268,49 +762,561 @@ void PhysicsSystem::CleanupPhysicsBody(entt::entity raw_ent) {
     Entity ent = { raw_ent, m_scene };
     REN_ASSERT((ent.HasAll<RigidBodyComponent>()), "Body must have RigidBodyComponent to be cleanedup");
     auto& rig = ent.Get<RigidBodyComponent>();
-    REN_ASSERT(rig.p_body, "Rigid body was not initialized or was deleted in runtime.");
+    REN_ASSERT(rig.Initialized(), "Rigid body was not initialized or was deleted in runtime.");
 
-    // Delete from physics world (this internaly calls ContactListener::ContanctEnd(), so we have to make sure the custom data, which our
-    // implementation of this listener uses, is not deleted by then).
-    m_physWorld->DestroyBody(rig.p_body);
+    if (rig.active_index >= 0)
+        removeActiveBody(rig.active_index);
+    ent.p_scene->m_Registry->remove<RenderTransformComponent>(raw_ent);
 
-    // Delete custom data pointer to the parent entity.
-    if (!rig.body_def.userData.pointer)
+    if (m_staticGeometry.Contains(raw_ent)) {
+        removeStaticTile(raw_ent);
+        rig.body_def.userData.pointer = 0;
         return;
-    Entity* p_ent = reinterpret_cast<Entity*>(rig.body_def.userData.pointer);
-    delete p_ent;
+    }
 
+    // Body (even the one, which is not created yet) is destroyed by the physics thread.
+    if (m_threaded) {
+        Enqueue([this, raw_ent](b2World&) {
+            auto it = m_threadBodies.find(raw_ent);
+            if (it != m_threadBodies.end()) {
+                it->second->GetWorld()->DestroyBody(it->second);
+                m_threadBodies.erase(it);
+            }
+        });
+        m_pendingTeleports.erase(raw_ent);
+        rig.body_def.userData.pointer = 0;
+        rig.p_body = nullptr;
+        return;
+    }
+
+    // Delete from physics world (this internaly calls EndContact() of the shard, which is recorded as usual).
+    if (rig.p_body)
+        rig.p_body->GetWorld()->DestroyBody(rig.p_body);
     rig.body_def.userData.pointer = 0;
     rig.p_body = nullptr;
 }
 
-// Call function with arguments on each native script instance in scene.
-template<typename Fun, typename... Args>
-inline void call_on_nativescript(Scene* scene, Fun fun, b2Contact* contact, Args... args) {
-    auto fixA = contact->GetFixtureA();
-    auto fixB = contact->GetFixtureB();
+void PhysicsSystem::SetFixtureLayer(entt::entity ent, int32_t fixture, int32_t layer) {
+    REN_ASSERT(layer < m_scene->m_CollisionLayers.Count(), "Unknown collision layer.");
+    auto& rig = m_scene->m_Registry->get<RigidBodyComponent>(ent);
+    rig.fixtures.SetLayer(fixture, layer);
+    refreshFilters(ent, rig);
+}
+void PhysicsSystem::ApplyCollisionLayers() {
+    for (auto&& [ent, rig] : m_scene->SceneView<RigidBodyComponent>().each()) {
+        bool layered = std::any_of(rig.fixtures.begin(), rig.fixtures.end(), [](const Fixture& f) { return f.layer >= 0; });
+        if (layered)
+            refreshFilters(ent, rig);
+    }
+}
+b2FixtureDef PhysicsSystem::fixtureDef(const Fixture& fixture) const {
+    b2FixtureDef def = fixture.def;
+    def.shape = fixture.shape.get();
+    if (fixture.layer >= 0)
+        def.filter = m_scene->m_CollisionLayers.GetFilter(fixture.layer, def.filter.groupIndex);
+    return def;
+}
+void PhysicsSystem::refreshFilters(entt::entity ent, RigidBodyComponent& rig) {
+    if (!rig.Initialized())
+        return;
+    // Merged geometry is grouped by the filter, so it is merged again.
+    if (m_staticGeometry.Contains(ent)) {
+        removeStaticTile(ent);
+        addStaticTile(ent, rig);
+        return;
+    }
+
+    std::vector<b2Filter> filters;
+    for (auto&& fixture : rig.fixtures)
+        filters.push_back(fixtureDef(fixture).filter);
+    Enqueue(ent, [filters = std::move(filters)](b2Body& body) {
+        // Fixtures are prepended by CreateFixture(), so they are in reverse order.
+        std::size_t i = filters.size();
+        for (b2Fixture* fixture = body.GetFixtureList(); fixture && i > 0; fixture = fixture->GetNext())
+            fixture->SetFilterData(filters[--i]);
+    });
+}
+
+void PhysicsSystem::updateActiveBodies() {
+    // Step wakes up a sleeping body only through a body, which was awake: when their contact begins or ends, or when
+    // they are in the same island (touching contacts and joints). So only the contact events and the neighbours of the
+    // synced bodies are checked, sleeping part of the world is not walked at all.
+    auto& reg = *m_scene->m_Registry;
+    for (auto&& event : m_stepContacts) {
+        if (event.type != ContactEventType::begin && event.type != ContactEventType::end)
+            continue;
+        for (entt::entity ent : { event.a, event.b })
+            if (reg.valid(ent) && reg.all_of<RigidBodyComponent>(ent))
+                trackBody(reg.get<RigidBodyComponent>(ent).p_body, true);
+    }
+    // Bodies are appended during the walk, so the neighbours of the woken up ones are checked as well.
+    for (std::size_t i = 0; i < m_activeBodies.size(); i++) {
+        b2Body* body = m_activeBodies[i].body;
+        for (b2ContactEdge* edge = body->GetContactList(); edge; edge = edge->next)
+            if (edge->contact->IsTouching())
+                trackBody(edge->other, true);
+        for (b2JointEdge* edge = body->GetJointList(); edge; edge = edge->next)
+            trackBody(edge->other, true);
+    }
+}
+void PhysicsSystem::trackBody(b2Body* body, bool stepped) {
+    if (!body || body->GetType() == b2_staticBody || !body->IsAwake() || !body->IsEnabled())
+        return;
+    auto& reg = *m_scene->m_Registry;
+    entt::entity ent = Utils::body_entity(body);
+    if (!reg.valid(ent) || !reg.all_of<RigidBodyComponent, TransformComponent>(ent))
+        return;
+    auto [rig, trans] = reg.get<RigidBodyComponent, TransformComponent>(ent);
+    if (rig.active_index >= 0 || rig.p_body != body)
+        return;
+
+    rig.active_index = int32_t(m_activeBodies.size());
+    // Body woke up in this step. Until then it didn't move, so the transform holds its previous state.
+    if (stepped)
+        m_activeBodies.push_back({ ent, body, Utils::to_b2Vec2(trans.position), glm::radians(trans.rotation) });
+    else
+        m_activeBodies.push_back({ ent, body, body->GetPosition(), body->GetAngle() });
+}
+void PhysicsSystem::Teleport(entt::entity ent, glm::vec2 position) {
+    auto& reg = *m_scene->m_Registry;
+    // Patch, so that the others (for ex. render system) see the new position right away.
+    reg.patch<TransformComponent>(ent, [&position](TransformComponent& trans) { trans.position = position; });
+    reg.remove<RenderTransformComponent>(ent);
+    // Body is moved in the next Update(), as the body may not be created yet (threaded mode).
+    if (reg.all_of<RigidBodyComponent>(ent))
+        m_teleports.push_back(ent);
+}
+void PhysicsSystem::TrackBody(entt::entity ent) {
+    // Physics thread publishes all awake bodies on its own.
+    if (m_threaded)
+        return;
+    if (auto rig = m_scene->m_Registry->try_get<RigidBodyComponent>(ent))
+        trackBody(rig->p_body, false);
+}
+void PhysicsSystem::removeActiveBody(std::size_t index) {
+    auto& reg = *m_scene->m_Registry;
+    if (auto rig = reg.try_get<RigidBodyComponent>(m_activeBodies[index].ent))
+        rig->active_index = -1;
+
+    // Swap with the last one and pop.
+    if (index != m_activeBodies.size() - 1) {
+        m_activeBodies[index] = m_activeBodies.back();
+        reg.get<RigidBodyComponent>(m_activeBodies[index].ent).active_index = int32_t(index);
+    }
+    m_activeBodies.pop_back();
+}
+void PhysicsSystem::clearActiveBodies() {
+    auto& reg = *m_scene->m_Registry;
+    for (auto&& active : m_activeBodies)
+        if (auto rig = reg.try_get<RigidBodyComponent>(active.ent))
+            rig->active_index = -1;
+    m_activeBodies.clear();
+}
+
+bool PhysicsSystem::addStaticTile(entt::entity ent, const RigidBodyComponent& rig) {
+    if (rig.body_def.type != b2_staticBody)
+        return false;
+    std::vector<b2FixtureDef> fixtures;
+    for (auto&& fixture : rig.fixtures)
+        fixtures.push_back(fixtureDef(fixture));
+    auto lock = LockWorld();
+    return m_staticGeometry.Add(ent, rig.body_def, fixtures, shardOf(rig));
+}
+void PhysicsSystem::removeStaticTile(entt::entity ent) {
+    auto lock = LockWorld();
+    m_staticGeometry.Remove(ent);
+}
+void PhysicsSystem::rebuildStaticGeometry() {
+    for (auto&& update : m_staticGeometry.Rebuild()) {
+        Enqueue([this, update = std::move(update)](b2World&) {
+            m_staticGeometry.Apply(*m_shards.GetWorld(update.shard), update);
+        });
+    }
+}
+void PhysicsSystem::QueryAABB(const b2AABB& aabb, std::vector<entt::entity>& out) {
+    std::size_t first = out.size();
+    auto lock = LockWorld();
+
+    struct Query : b2QueryCallback {
+        std::vector<entt::entity>& out;
+        Query(std::vector<entt::entity>& out) : out(out) {}
+        bool ReportFixture(b2Fixture* fixture) override {
+            entt::entity ent = Utils::body_entity(fixture->GetBody());
+            if (ent != entt::null)
+                out.push_back(ent);
+            return true;
+        }
+    } query(out);
+    for (b2World* world : m_shards.GetWorlds())
+        world->QueryAABB(&query, aabb);
+    m_staticGeometry.Query(aabb, [&out](entt::entity ent) { out.push_back(ent); return true; });
+
+    // Bodies with more fixtures are reported more times.
+    std::sort(out.begin() + first, out.end());
+    out.erase(std::unique(out.begin() + first, out.end()), out.end());
+}
+
+uint32_t PhysicsSystem::AddShard(std::optional<b2AABB> region) {
+    // Physics thread walks the shards under the lock.
+    auto lock = LockWorld();
+    return m_shards.Add(region);
+}
+uint32_t PhysicsSystem::shardOf(const RigidBodyComponent& rig) const {
+    if (rig.shard >= 0) {
+        REN_ASSERT(std::size_t(rig.shard) < m_shards.Size(), "Rigid body is assigned to a shard, which doesn't exist.");
+        return uint32_t(rig.shard);
+    }
+    return m_shards.ShardAt(rig.body_def.position);
+}
+void PhysicsSystem::stepShards(ThreadPool& pool, float dt, std::vector<CreatedBody>& migrated, std::vector<ShardedWorld::BodyState>* states) {
+    m_shards.m_RecordSolveEvents = m_RecordSolveEvents;
+    if (states)
+        m_shards.StepTracked(pool, dt, m_VelocityIterations, m_PositionIterations, *states);
+    else
+        m_shards.Step(pool, dt, m_VelocityIterations, m_PositionIterations);
+
+    // Component still points to the old body in threaded mode, so it is kept (disabled) until syncFromThread().
+    std::vector<ShardedWorld::Migration> moved;
+    m_shards.Migrate(m_threaded, moved);
+    for (auto&& [body, old_body] : moved)
+        migrated.push_back({ Utils::body_entity(body), body, body->GetUserData().pointer, old_body });
+    m_shards.CollectContacts(m_stepContacts);
+}
+
+// Queries of a batch are taken by the threads in chunks of this size.
+static constexpr std::size_t QUERY_CHUNK = 64;
 
-    Entity* p_entA = reinterpret_cast<Entity*>(fixA->GetBody()->GetUserData().pointer);
-    Entity* p_entB = reinterpret_cast<Entity*>(fixB->GetBody()->GetUserData().pointer);
+void PhysicsSystem::RaycastBatch(const RaycastQuery* queries, std::size_t count, RaycastHit* hits) {
+    auto lock = LockWorld();
+    ThreadPool::Global().ParallelFor((count + QUERY_CHUNK - 1) / QUERY_CHUNK, [&](std::size_t chunk) {
+        std::size_t end = std::min(count, (chunk + 1) * QUERY_CHUNK);
+        for (std::size_t i = chunk * QUERY_CHUNK; i < end; i++)
+            hits[i] = raycast(queries[i]);
+    });
+}
+void PhysicsSystem::OverlapBatch(const OverlapQuery* queries, std::size_t count, entt::entity* results, std::size_t max_results, uint32_t* counts) {
+    auto lock = LockWorld();
+    ThreadPool::Global().ParallelFor((count + QUERY_CHUNK - 1) / QUERY_CHUNK, [&](std::size_t chunk) {
+        std::size_t end = std::min(count, (chunk + 1) * QUERY_CHUNK);
+        for (std::size_t i = chunk * QUERY_CHUNK; i < end; i++)
+            counts[i] = overlap(queries[i], results + i * max_results, max_results);
+    });
+}
+RaycastHit PhysicsSystem::raycast(const RaycastQuery& query) {
+    struct Callback : b2RayCastCallback {
+        const RaycastQuery& query;
+        RaycastHit hit;
+        Callback(const RaycastQuery& query) : query(query) {}
+        float ReportFixture(b2Fixture* fixture, const b2Vec2& point, const b2Vec2& normal, float fraction) override {
+            if (!(fixture->GetFilterData().categoryBits & query.mask) || (fixture->IsSensor() && !query.hit_sensors))
+                return -1.0f;
+            entt::entity ent = Utils::body_entity(fixture->GetBody());
+            if (ent != entt::null && ent == query.ignore)
+                return -1.0f;
+            // Shards are cast one after another, so keep the closest hit of all of them.
+            if (hit.hit && fraction >= hit.fraction)
+                return hit.fraction;
+            hit = { true, ent, point, normal, fraction };
+            return fraction;
+        }
+    } callback(query);
+
+    // Box2D asserts on zero length rays.
+    if ((query.to - query.from).LengthSquared() <= 0.0f)
+        return {};
+    for (b2World* world : m_shards.GetWorlds())
+        world->RayCast(&callback, query.from, query.to);
+
+    // Merged static geometry has no entity, find the merged one at the hit point.
+    RaycastHit& hit = callback.hit;
+    if (hit.hit && hit.ent == entt::null && !m_staticGeometry.Empty()) {
+        b2AABB box{ hit.point - b2Vec2(b2_linearSlop, b2_linearSlop), hit.point + b2Vec2(b2_linearSlop, b2_linearSlop) };
+        m_staticGeometry.Query(box, [&hit](entt::entity ent) { hit.ent = ent; return false; });
+    }
+    return hit;
+}
+uint32_t PhysicsSystem::overlap(const OverlapQuery& query, entt::entity* results, std::size_t max_results) {
+    uint32_t found = 0;
+    // Bodies with more fixtures are reported more times, results are short, so a linear search is fine.
+    const auto add = [&](entt::entity ent) {
+        if (ent == entt::null || ent == query.ignore || std::find(results, results + found, ent) != results + found)
+            return true;
+        results[found++] = ent;
+        return found < max_results;
+    };
 
-    const auto call_fun = [&](NativeScript* instance, Entity e) { if (instance) (instance->*fun)(e, contact, args...); };
+    struct Callback : b2QueryCallback {
+        const OverlapQuery& query;
+        const decltype(add)& add;
+        bool full{ false };
+        Callback(const OverlapQuery& query, const decltype(add)& add) : query(query), add(add) {}
+        bool ReportFixture(b2Fixture* fixture) override {
+            if (!(fixture->GetFilterData().categoryBits & query.mask))
+                return true;
+            // Broad-phase reports fattened boxes, so test the real ones.
+            for (int32 child = 0; child < fixture->GetShape()->GetChildCount(); child++) {
+                if (b2TestOverlap(fixture->GetAABB(child), query.aabb)) {
+                    full = !add(Utils::body_entity(fixture->GetBody()));
+                    break;
+                }
+            }
+            return !full;
+        }
+    } callback(query, add);
 
-    if (p_entA->HasAll<NativeScriptComponent>())
-        call_fun(p_entA->Get<NativeScriptComponent>().script_instance, *p_entB);
-    if (p_entB->HasAll<NativeScriptComponent>())
-        call_fun(p_entB->Get<NativeScriptComponent>().script_instance, *p_entA);
+    if (max_results == 0)
+        return 0;
+    for (b2World* world : m_shards.GetWorlds()) {
+        world->QueryAABB(&callback, query.aabb);
+        if (callback.full)
+            return found;
+    }
+    // Filter of the merged entity is the filter of its groups.
+    m_staticGeometry.Query(query.aabb, [&](entt::entity ent) {
+        return (m_staticGeometry.GetCategoryBits(ent) & query.mask) ? add(ent) : true;
+    });
+    return found;
 }
 
-void PhysicsSystem::ContactListener::BeginContact(b2Contact* contact) {
-    call_on_nativescript(m_sys->m_scene, &NativeScript::OnContactBegin, contact);
+void PhysicsSystem::Enqueue(std::function<void(b2World&)> command) {
+    std::lock_guard<std::mutex> lock(m_commandsMutex);
+    m_commands.push_back([this, command = std::move(command)]{ command(*m_physWorld); });
+    m_commandsEnqueued++;
 }
-void PhysicsSystem::ContactListener::EndContact(b2Contact* contact) {
-    call_on_nativescript(m_sys->m_scene, &NativeScript::OnContactEnd, contact);
+void PhysicsSystem::Enqueue(entt::entity ent, std::function<void(b2Body&)> command) {
+    Enqueue([this, ent, command = std::move(command)](b2World&) {
+        b2Body* body = findBody(ent);
+        if (!body)
+            return;
+        command(*body);
+        // Command could wake the body up (physics thread publishes all awake bodies on its own).
+        if (!m_threaded)
+            trackBody(body, false);
+    });
 }
-void PhysicsSystem::ContactListener::PreSolve(b2Contact* contact, const b2Manifold* oldManifold) {
-    call_on_nativescript(m_sys->m_scene, &NativeScript::OnContactPreSolve, contact, oldManifold);
+void PhysicsSystem::setRenderTransform(entt::entity ent, const b2Vec2& prev_position, float prev_angle, const b2Vec2& position, float angle, float alpha) {
+    auto& reg = *m_scene->m_Registry;
+    if (alpha >= 1.0f || (prev_position == position && prev_angle == angle)) {
+        reg.remove<RenderTransformComponent>(ent);
+        return;
+    }
+    reg.emplace_or_replace<RenderTransformComponent>(ent,
+        glm::mix(Utils::to_vec2(prev_position), Utils::to_vec2(position), alpha), glm::degrees(glm::mix(prev_angle, angle, alpha)));
 }
-void PhysicsSystem::ContactListener::PostSolve(b2Contact* contact, const b2ContactImpulse* impulse) {
-    call_on_nativescript(m_sys->m_scene, &NativeScript::OnContactPostSolve, contact, impulse);
+void PhysicsSystem::runCommands() {
+    std::vector<std::function<void()>> commands;
+    {
+        std::lock_guard<std::mutex> lock(m_commandsMutex);
+        commands.swap(m_commands);
+    }
+    for (auto&& command : commands)
+        command();
+    m_commandsApplied += commands.size();
+}
+b2Body* PhysicsSystem::findBody(entt::entity ent) {
+    if (m_threaded) {
+        auto it = m_threadBodies.find(ent);
+        return it != m_threadBodies.end() ? it->second : nullptr;
+    }
+    auto& reg = *m_scene->m_Registry;
+    return (reg.valid(ent) && reg.all_of<RigidBodyComponent>(ent)) ? reg.get<RigidBodyComponent>(ent).p_body : nullptr;
+}
+
+void PhysicsSystem::SetThreaded(bool threaded) {
+    if (threaded == m_threaded || !m_physWorld)
+        return;
+
+    if (threaded) {
+        // Hand over existing bodies and commands to the thread.
+        runCommands();
+        clearActiveBodies();
+        m_scene->m_Registry->clear<RenderTransformComponent>();
+        m_threadBodies.clear();
+        for (auto&& [ent, rig] : m_scene->SceneView<RigidBodyComponent>().each())
+            if (rig.p_body)
+                m_threadBodies[ent] = rig.p_body;
+        m_commandsApplied = m_commandsEnqueued;
+        m_states.ForEach([this](StateBuffer& state) { state.commands_applied = m_commandsApplied; });
+
+        if (!m_threadPool)
+            m_threadPool = std::make_unique<ThreadPool>();
+        m_threaded = true;
+        m_threadRunning = true;
+        m_thread = std::thread(&PhysicsSystem::threadLoop, this);
+        return;
+    }
+
+    stopThread();
+    // Everything the thread didn't finish is done here.
+    runCommands();
+    syncFromThread();
+    m_threaded = false;
+    m_threadBodies.clear();
+    m_pendingTeleports.clear();
+    // Bodies are rendered at the transforms (the last published state), until they are stepped again.
+    m_scene->m_Registry->clear<RenderTransformComponent>();
+    for (b2World* world : m_shards.GetWorlds())
+        for (b2Body* body = world->GetBodyList(); body; body = body->GetNext())
+            trackBody(body, false);
+}
+void PhysicsSystem::stopThread() {
+    m_threadRunning = false;
+    if (m_thread.joinable())
+        m_thread.join();
+}
+
+void PhysicsSystem::threadLoop() {
+    using clock = std::chrono::steady_clock;
+    auto next_step = clock::now();
+    while (m_threadRunning) {
+        const auto step_time = std::chrono::duration_cast<clock::duration>(std::chrono::duration<float>(m_RefreshRate));
+        next_step += step_time;
+
+        StateBuffer& back = m_states.Back();
+        {
+            auto lock = LockWorld();
+            runCommands();
+
+            // Migrated bodies are handed over like created ones. Published states are matched by entity, not by body.
+            std::vector<CreatedBody> migrated;
+            stepShards(*m_threadPool, m_RefreshRate, migrated, &back.bodies);
+            if (!migrated.empty()) {
+                for (auto&& m : migrated)
+                    m_threadBodies[m.ent] = m.body;
+                std::lock_guard<std::mutex> lock(m_fromThreadMutex);
+                m_createdBodies.insert(m_createdBodies.end(), migrated.begin(), migrated.end());
+            }
+        }
+        back.time = clock::now();
+        back.commands_applied = m_commandsApplied;
+
+        if (!m_stepContacts.empty()) {
+            std::lock_guard<std::mutex> lock(m_fromThreadMutex);
+            m_contacts.insert(m_contacts.end(), m_stepContacts.begin(), m_stepContacts.end());
+            m_stepContacts.clear();
+        }
+
+        // Publish the state.
+        m_states.Publish();
+
+        // Don't try to catch up, if we are way behind (for ex. after breakpoint).
+        if (clock::now() > next_step + step_time * 5)
+            next_step = clock::now();
+        std::this_thread::sleep_until(next_step);
+    }
+}
+
+void PhysicsSystem::syncFromThread() {
+    auto& reg = *m_scene->m_Registry;
+
+    std::vector<CreatedBody> created;
+    std::vector<ContactEvent> contacts;
+    {
+        std::lock_guard<std::mutex> lock(m_fromThreadMutex);
+        created.swap(m_createdBodies);
+        contacts.swap(m_contacts);
+    }
+    std::vector<b2Body*> old_bodies;
+    for (auto&& [ent, body, user_data, old_body] : created) {
+        if (old_body)
+            old_bodies.push_back(old_body);
+        if (!reg.valid(ent) || !reg.all_of<RigidBodyComponent>(ent))
+            continue;
+        auto& rig = reg.get<RigidBodyComponent>(ent);
+        if (rig.body_def.userData.pointer == user_data)
+            rig.p_body = body;
+    }
+    // Nothing points to the bodies replaced by migration anymore.
+    if (!old_bodies.empty()) {
+        Enqueue([old_bodies = std::move(old_bodies)](b2World&) {
+            for (b2Body* body : old_bodies)
+                body->GetWorld()->DestroyBody(body);
+        });
+    }
+
+    // Teleports are sent to the physics thread as commands.
+    for (entt::entity ent : m_teleports) {
+        if (!reg.valid(ent) || !reg.all_of<TransformComponent, RigidBodyComponent>(ent))
+            continue;
+        auto& trans = reg.get<TransformComponent>(ent);
+        Enqueue(ent, [pos = Utils::to_b2Vec2(trans.position)](b2Body& body) {
+            body.SetTransform(pos, body.GetAngle());
+            body.SetAwake(true);
+        });
+        m_pendingTeleports[ent] = m_commandsEnqueued;
+    }
+    m_teleports.clear();
+
+    // Take the latest published state, if there is any.
+    bool fresh = m_states.Acquire();
+    const StateBuffer& front = m_states.Front();
+
+    // Physics thread is already somewhere in the next step.
+    float alpha = 1.0f;
+    if (m_Interpolate)
+        alpha = glm::clamp(std::chrono::duration<float>(std::chrono::steady_clock::now() - front.time).count() / m_RefreshRate, 0.0f, 1.0f);
+
+    for (auto&& state : front.bodies) {
+        if (!reg.valid(state.ent) || !reg.all_of<TransformComponent>(state.ent))
+            continue;
+        // Keep teleported transform until the state catches up with it.
+        auto teleport = m_pendingTeleports.find(state.ent);
+        if (teleport != m_pendingTeleports.end()) {
+            if (front.commands_applied < teleport->second)
+                continue;
+            m_pendingTeleports.erase(teleport);
+        }
+        // Transform holds the published state (as after FixedUpdate() in the single threaded mode).
+        if (fresh) {
+            reg.patch<TransformComponent>(state.ent, [&state](TransformComponent& trans) {
+                trans.position = Utils::to_vec2(state.position);
+                trans.rotation = glm::degrees(state.angle);
+            });
+        }
+        setRenderTransform(state.ent, state.prev_position, state.prev_angle, state.position, state.angle, alpha);
+    }
+
+    dispatchContacts(contacts);
+}
+// Call the contact callback on the script of `ent`, if it has any. `other` is the second entity in contact.
+inline void call_on_scripts(Scene* scene, entt::entity ent, entt::entity other, const ContactEvent& event) {
+    auto& reg = *scene->m_Registry;
+    if (auto native = reg.try_get<NativeScriptComponent>(ent); native && native->script_instance) {
+        NativeScript* script = native->script_instance;
+        Entity e = scene->ToEntity(other);
+        switch (event.type) {
+            case ContactEventType::begin:      script->OnContactBegin(e, event); break;
+            case ContactEventType::end:        script->OnContactEnd(e, event); break;
+            case ContactEventType::pre_solve:  script->OnContactPreSolve(e, event); break;
+            case ContactEventType::post_solve: script->OnContactPostSolve(e, event); break;
+        }
+    }
+    // Solve events are too frequent to be passed to LUA.
+    if (event.type != ContactEventType::begin && event.type != ContactEventType::end)
+        return;
+    if (auto lua = reg.try_get<LuaScriptComponent>(ent)) {
+        for (auto&& [name, script] : lua->scripts) {
+            if (event.type == ContactEventType::begin)
+                script->OnContactBegin(other);
+            else
+                script->OnContactEnd(other);
+        }
+    }
+}
+
+void PhysicsSystem::dispatchContacts(const std::vector<ContactEvent>& contacts) {
+    if (contacts.empty())
+        return;
+    m_contactSignal.publish(contacts);
+
+    auto& reg = *m_scene->m_Registry;
+    for (auto&& event : contacts) {
+        // Handlers could have destroyed the entities meanwhile.
+        if (!reg.valid(event.a) || !reg.valid(event.b))
+            continue;
+        call_on_scripts(m_scene, event.a, event.b, event);
+        if (reg.valid(event.a) && reg.valid(event.b))
+            call_on_scripts(m_scene, event.b, event.a, event);
+    }
 }
 #pragma endregion
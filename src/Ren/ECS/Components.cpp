@@ -13,11 +13,12 @@
 namespace Ren
 {
     glm::vec2 SpriteComponent::GetSize() {
+        // Texture resource already knows its size, so there is no need to query the texture.
+        auto res = GetTextureResource();
+        if (!res)
+            return glm::vec2(0.0f);
         // Scale size of the texture in pixels to match size in units (as defined by SpriteComponent::m_PixelPerIUnit property).
-        int w, h;
-        SDL_QueryTexture(GetTexture(), nullptr, nullptr, &w, &h);
-        glm::vec2 size = glm::vec2(w, h) / glm::vec2(m_PixelsPerUnit);
-        return size;
+        return glm::vec2(res->size) / glm::vec2(m_PixelsPerUnit);
     }
 
     void NativeScriptComponent::Unbind() {
@@ -25,14 +26,9 @@ namespace Ren
             delete script_instance;
     }
 
-    LuaScriptComponent::LuaScriptComponent() {
-        lua = CreateRef<sol::state>();
-        // Load standard libraries for basic functionality.
-        lua->open_libraries();
-    }
     void LuaScriptComponent::Attach(std::string name, std::filesystem::path script_path) {
         REN_ASSERT(scripts.count(name) == 0, "Script with name " + name + " is already attached to LuaScriptComponent.");
-        scripts[name] = CreateRef<LuaScript>(name, lua.get(), script_path);
+        scripts[name] = CreateRef<LuaScript>(name, script_path);
     }
 
     void LuaScriptComponent::Detach(std::string name) {
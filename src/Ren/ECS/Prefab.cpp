@@ -0,0 +1,28 @@
+/**
+ * @file Ren/ECS/Prefab.cpp
+ * @brief Implementation of prefab loading.
+ */
+#include "Ren/ECS/Prefab.hpp"
+#include "Ren/Core/AssetManager.hpp"
+#include "Ren/ECS/Serialization/YAMLConversions.hpp"
+
+using namespace Ren;
+
+Prefab Prefab::Load(std::filesystem::path path) {
+    YAML::Node node = YAML::LoadFile(AssetManager::GetPrefab(path).string());
+
+    Prefab prefab;
+    prefab.name = node["Name"] ? node["Name"].as<std::string>() : path.stem().string();
+    for (auto&& tag : node["Tags"])
+        prefab.tags.push_back(tag.as<std::string>());
+
+    // Components use the same format as in serialized scenes.
+    if (node["Transform"])
+        prefab.transform = node["Transform"].as<TransformComponent>();
+    if (node["Sprite"])
+        prefab.sprite = node["Sprite"].as<SpriteComponent>();
+    if (node["RigidBody"])
+        prefab.rigid_body = node["RigidBody"].as<RigidBodyComponent>();
+
+    return prefab;
+}
@@ -5,9 +5,12 @@
 
 #include <vector>
 #include <algorithm>    // std::find
+#include <cmath>        // std::fmod
 #include <ren_utils/logging.hpp>
 
 #include "Ren/ECS/Scene.hpp"
+#include "Ren/ECS/Prefab.hpp"
+#include "Ren/ECS/CommandBuffer.hpp"
 
 namespace Ren
 {
@@ -40,9 +43,11 @@ namespace Ren
         AddSystem<PhysicsSystem>();
     }
     Scene::~Scene() {
+        m_commandBuffers.clear();
         m_sysManager.Clear();
         m_textureCache->clear();
         m_Registry->clear();
+        ShapeLibrary::ReleaseUnused();
     }
 
     Entity Scene::CreateEntity(const TransformComponent& transform_comp, const TagList& tag_list) {
@@ -52,6 +57,101 @@ namespace Ren
             AddTag(ent, tag);
         return ent;
     };
+    std::vector<entt::entity> Scene::Instantiate(const Prefab& prefab, std::size_t count, const TransformComponent* transforms) {
+        std::vector<entt::entity> entities(count);
+        if (count == 0)
+            return entities;
+
+        // Create all entities and their components at once, so that each storage is touched only once.
+        m_Registry->create(entities.begin(), entities.end());
+        if (transforms)
+            m_Registry->insert<TransformComponent>(entities.begin(), entities.end(), transforms);
+        else
+            m_Registry->insert<TransformComponent>(entities.begin(), entities.end(), prefab.transform);
+
+        if (prefab.sprite) {
+            // Load the texture only once. Instances then share the texture handle.
+            SpriteComponent sprite = *prefab.sprite;
+            if (!sprite.GetTextureResource())
+                LoadTexture(&sprite);
+            m_Registry->insert<SpriteComponent>(entities.begin(), entities.end(), sprite);
+        }
+
+        // New entities cannot have any tags yet, so there is no need to check for duplicates.
+        for (auto&& tag : prefab.tags) {
+            auto& tagged = m_tagToEntities[tag];
+            tagged.insert(tagged.end(), entities.begin(), entities.end());
+            for (auto&& ent : entities)
+                m_entityToTags[ent].push_back(tag);
+        }
+
+        if (prefab.rigid_body) {
+            REN_ASSERT(prefab.rigid_body->p_body == nullptr, "Prefab rigid body must not be initialized.");
+            // Fixtures hold references to the shapes, so all instances share the same shape prototypes.
+            m_Registry->insert<RigidBodyComponent>(entities.begin(), entities.end(), *prefab.rigid_body);
+            if (auto physics = GetSystem<PhysicsSystem>())
+                for (auto&& ent : entities)
+                    physics->InitPhysicsBody(ent);
+        }
+
+        return entities;
+    }
+    void Scene::DestroyEntity(Entity ent) {
+        // Release physics body, so that the physics world doesn't reference destroyed entity.
+        auto physics = GetSystem<PhysicsSystem>();
+        if (physics && ent.HasAll<RigidBodyComponent>() && ent.Get<RigidBodyComponent>().Initialized())
+            physics->CleanupPhysicsBody(ent.id);
+
+        // Remove entity from the tag maps.
+        auto tags_it = m_entityToTags.find(ent.id);
+        if (tags_it != m_entityToTags.end()) {
+            for (auto&& tag : tags_it->second)
+                m_tagToEntities[tag].remove(ent.id);
+            m_entityToTags.erase(tags_it);
+        }
+
+        m_Registry->destroy(ent.id);
+    }
+
+    EntityCommandBuffer& Scene::GetCommandBuffer() {
+        std::lock_guard<std::mutex> lock(m_commandBuffersMutex);
+        auto id = std::this_thread::get_id();
+        for (auto&& [thread_id, buffer] : m_commandBuffers)
+            if (thread_id == id)
+                return *buffer;
+        m_commandBuffers.push_back({ id, CreateRef<EntityCommandBuffer>() });
+        return *m_commandBuffers.back().second;
+    }
+    void Scene::PlaybackCommandBuffers() {
+        // Don't hold the lock during playback, so that component callbacks can record new commands.
+        // Buffers are played back in the order of their creation, which is not deterministic across runs.
+        std::vector<Ref<EntityCommandBuffer>> buffers;
+        {
+            std::lock_guard<std::mutex> lock(m_commandBuffersMutex);
+            for (auto&& [thread_id, buffer] : m_commandBuffers)
+                if (!buffer->Empty())
+                    buffers.push_back(buffer);
+        }
+        for (auto&& buffer : buffers)
+            buffer->Playback(this);
+    }
+    void Scene::Update(float dt) {
+        // Apply changes made outside of the update first (events, layers, ...).
+        PlaybackCommandBuffers();
+
+        m_fixedAccumulator += dt;
+        for (int32_t step = 0; m_fixedAccumulator >= m_FixedTimeStep; step++) {
+            if (step == m_MaxFixedSteps) {
+                m_fixedAccumulator = std::fmod(m_fixedAccumulator, m_FixedTimeStep);
+                break;
+            }
+            m_sysManager.FixedUpdate(m_FixedTimeStep, [this]{ PlaybackCommandBuffers(); });
+            m_fixedAccumulator -= m_FixedTimeStep;
+        }
+
+        m_sysManager.Update(dt, [this]{ PlaybackCommandBuffers(); });
+    }
+
     void Scene::AddTag(Entity ent, std::string tag) {
         if (HasTag(ent, tag))
             return;
@@ -113,4 +213,15 @@ namespace Ren
         }
         return {};
     }
+
+    void Scene::ReleaseUnusedTextures() {
+        std::vector<entt::id_type> unused;
+        for (auto [id, res] : *m_textureCache) {
+            // The cache and the handle `res` itself are the only owners.
+            if (res.use_count() <= 2)
+                unused.push_back(id);
+        }
+        for (auto&& id : unused)
+            m_textureCache->erase(id);
+    }
 } // namespace Ren
@@ -10,11 +10,12 @@ using namespace Ren;
 template<>
 void Ren::setup_component<TransformComponent>(Entity e, const TransformComponent& t) {
     // All entities have transform component added by default when created.
-    auto& trans = e.Get<TransformComponent>();
-    trans.position = t.position;
-    trans.scale = t.scale;
-    trans.rotation = t.rotation;
-    trans.layer = t.layer;
+    e.Patch<TransformComponent>([&t](TransformComponent& trans) {
+        trans.position = t.position;
+        trans.scale = t.scale;
+        trans.rotation = t.rotation;
+        trans.layer = t.layer;
+    });
 }
 
 template<>
@@ -2,6 +2,9 @@
  * @file Ren/ECS/Serialization/SceneSerializer.cpp
  * @brief Implementation of scene serialization
  */
+#include <map>
+#include <ren_utils/logging.hpp>
+
 #include "Ren/ECS/Serialization/SceneSerializer.hpp"
 #include "Ren/Core/AssetManager.hpp"
 
@@ -12,6 +15,7 @@ void SceneSerializer::Serialize(Ref<Scene> scene, std::filesystem::path path) {
     YAML::Node node;
 
     node["SceneName"] = scene->m_Name;
+    node["CollisionLayers"] = scene->m_CollisionLayers;
 
     scene->m_Registry->each([&](auto ent) {
         Entity e{ ent, scene.get() };
@@ -32,12 +36,63 @@ Ref<Scene> SceneSerializer::Deserialze(std::filesystem::path path, SDL_Renderer*
     Ref<Scene> scene = CreateRef<Scene>(renderer, input);
 
     scene->m_Name = node["SceneName"].as<std::string>();
-    for (auto&& ent : node["Entities"]) {
+    if (node["CollisionLayers"])
+        scene->m_CollisionLayers = node["CollisionLayers"].as<CollisionLayers>();
+    DeserializeEntities(node["Entities"], scene.get());
+
+    return scene;
+}
+
+std::vector<entt::entity> SceneSerializer::DeserializeEntities(const YAML::Node& entities, Scene* scene) {
+    std::vector<entt::entity> created;
+    created.reserve(entities.size());
+    for (auto&& ent : entities) {
         Entity e = scene->CreateEntity();
         // Add components to entity.
         EntitySerializer::Deserialize(ent, e);
+        created.push_back(e.id);
     }
+    return created;
+}
 
-    return scene;
+void SceneSerializer::SerializeChunks(Ref<Scene> scene, std::filesystem::path dir, float chunk_size) {
+    REN_ASSERT(chunk_size > 0.0f, "Chunk size must be positive.");
+    std::filesystem::create_directories(dir);
+
+    // Sort entities into chunks by their position.
+    std::map<std::pair<int, int>, YAML::Node> chunks;
+    std::size_t skipped = 0;
+    scene->m_Registry->each([&](auto ent) {
+        Entity e{ ent, scene.get() };
+        if (!e.HasAll<TransformComponent>()) {
+            skipped++;
+            return;
+        }
+        glm::ivec2 coord = glm::ivec2(glm::floor(e.Get<TransformComponent>().position / chunk_size));
+        chunks[{ coord.x, coord.y }]["Entities"].push_back(EntitySerializer::Serialize(e));
+    });
+    if (skipped > 0)
+        LOG_W(std::to_string(skipped) + " entities without TransformComponent were not written into the chunks of '" + dir.string() + "'.");
+
+    YAML::Node index;
+    index["SceneName"] = scene->m_Name;
+    index["ChunkSize"] = chunk_size;
+    index["CollisionLayers"] = scene->m_CollisionLayers;
+    for (auto&& [coord, node] : chunks) {
+        std::string file_name = "chunk_" + std::to_string(coord.first) + "_" + std::to_string(coord.second) + ".ren";
+        std::ofstream file(dir / file_name);
+        file << node;
+        file.close();
+
+        YAML::Node chunk_info;
+        chunk_info["coord"] = glm::ivec2(coord.first, coord.second);
+        chunk_info["file"] = file_name;
+        chunk_info["entities"] = node["Entities"].size();
+        index["Chunks"].push_back(chunk_info);
+    }
+
+    std::ofstream file(dir / "world.yaml");
+    file << index;
+    file.close();
 }
 
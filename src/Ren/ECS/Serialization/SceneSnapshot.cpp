@@ -0,0 +1,404 @@
+/**
+ * @file Ren/ECS/Serialization/SceneSnapshot.cpp
+ * @brief Implementation of binary scene snapshots.
+ */
+#include <cstring>
+#include <fstream>
+#include <type_traits>
+#include <ren_utils/logging.hpp>
+
+#include "Ren/ECS/Serialization/SceneSnapshot.hpp"
+#include "Ren/Scripting/LuaScript.hpp"
+
+using namespace Ren;
+
+#pragma region Archives
+namespace {
+    // Written at the start of snapshot files.
+    constexpr uint32_t SNAPSHOT_MAGIC = 0x534E4552; // "RENS"
+    constexpr uint32_t SNAPSHOT_VERSION = 4;
+
+    class OutputArchive;
+    class InputArchive;
+
+    // Per-component archivers. Defined below the archives.
+    void write_component(OutputArchive& ar, const TransformComponent& t);
+    void write_component(OutputArchive& ar, const SpriteComponent& s);
+    void write_component(OutputArchive& ar, const RigidBodyComponent& r);
+    void write_component(OutputArchive& ar, const LuaScriptComponent& l);
+    void read_component(InputArchive& ar, TransformComponent& t);
+    void read_component(InputArchive& ar, SpriteComponent& s);
+    void read_component(InputArchive& ar, RigidBodyComponent& r);
+    void read_component(InputArchive& ar, LuaScriptComponent& l);
+
+    /// Appends raw bytes to the buffer. Implements archive interface of entt::snapshot.
+    class OutputArchive {
+    public:
+        OutputArchive(std::vector<uint8_t>& data) : m_data(data) {}
+
+        template<typename T>
+        void Write(const T& value) {
+            static_assert(std::is_trivially_copyable_v<T>, "Only trivially copyable types can be written directly.");
+            std::size_t pos = m_data.size();
+            m_data.resize(pos + sizeof(T));
+            std::memcpy(m_data.data() + pos, &value, sizeof(T));
+        }
+        void Write(const std::string& str) {
+            Write(uint32_t(str.size()));
+            m_data.insert(m_data.end(), str.begin(), str.end());
+        }
+
+        void operator()(std::underlying_type_t<entt::entity> count) { Write(count); }
+        void operator()(entt::entity ent) { Write(ent); }
+        template<typename TComponent>
+        void operator()(entt::entity ent, const TComponent& comp) {
+            Write(ent);
+            write_component(*this, comp);
+        }
+
+    private:
+        std::vector<uint8_t>& m_data;
+    };
+
+    /// Reads raw bytes from the buffer. Implements archive interface of entt::snapshot_loader.
+    class InputArchive {
+    public:
+        InputArchive(const std::vector<uint8_t>& data) : m_data(data) {}
+
+        template<typename T>
+        void Read(T& value) {
+            static_assert(std::is_trivially_copyable_v<T>, "Only trivially copyable types can be read directly.");
+            REN_ASSERT(m_pos + sizeof(T) <= m_data.size(), "Snapshot is corrupted.");
+            std::memcpy(&value, m_data.data() + m_pos, sizeof(T));
+            m_pos += sizeof(T);
+        }
+        void Read(std::string& str) {
+            uint32_t size = 0;
+            Read(size);
+            REN_ASSERT(m_pos + size <= m_data.size(), "Snapshot is corrupted.");
+            str.assign(reinterpret_cast<const char*>(m_data.data() + m_pos), size);
+            m_pos += size;
+        }
+        template<typename T>
+        T Read() { T value{}; Read(value); return value; }
+
+        void operator()(std::underlying_type_t<entt::entity>& count) { Read(count); }
+        void operator()(entt::entity& ent) { Read(ent); }
+        template<typename TComponent>
+        void operator()(entt::entity& ent, TComponent& comp) {
+            Read(ent);
+            read_component(*this, comp);
+        }
+
+    private:
+        const std::vector<uint8_t>& m_data;
+        std::size_t m_pos{ 0 };
+    };
+}
+#pragma endregion
+
+#pragma region Components
+namespace {
+    void write_component(OutputArchive& ar, const TransformComponent& t) { ar.Write(t); }
+    void read_component(InputArchive& ar, TransformComponent& t) { ar.Read(t); }
+
+    void write_component(OutputArchive& ar, const SpriteComponent& s) {
+        ar.Write(s.img_path.string());
+        ar.Write(s.m_Color);
+        ar.Write(s.m_PixelsPerUnit);
+    }
+    void read_component(InputArchive& ar, SpriteComponent& s) {
+        s.img_path = ar.Read<std::string>();
+        ar.Read(s.m_Color);
+        ar.Read(s.m_PixelsPerUnit);
+        // Texture is taken from the texture cache when the component is emplaced.
+        s.texture_handle = {};
+    }
+
+    void write_shape(OutputArchive& ar, const b2Shape* shape) {
+        ar.Write(int32_t(shape->m_type));
+        ar.Write(shape->m_radius);
+        switch (shape->m_type) {
+            case b2Shape::e_circle:
+                ar.Write(static_cast<const b2CircleShape*>(shape)->m_p);
+                break;
+            case b2Shape::e_polygon: {
+                auto polygon = static_cast<const b2PolygonShape*>(shape);
+                ar.Write(polygon->m_centroid);
+                ar.Write(polygon->m_count);
+                for (int32 i = 0; i < polygon->m_count; i++) {
+                    ar.Write(polygon->m_vertices[i]);
+                    ar.Write(polygon->m_normals[i]);
+                }
+                } break;
+            default:
+                break;
+        }
+    }
+    SharedShape read_shape(InputArchive& ar) {
+        auto type = b2Shape::Type(ar.Read<int32_t>());
+        float radius = ar.Read<float>();
+        switch (type) {
+            case b2Shape::e_circle: {
+                b2CircleShape circle;
+                circle.m_radius = radius;
+                ar.Read(circle.m_p);
+                return ShapeLibrary::Intern(circle);
+            }
+            case b2Shape::e_polygon: {
+                b2PolygonShape polygon;
+                polygon.m_radius = radius;
+                ar.Read(polygon.m_centroid);
+                ar.Read(polygon.m_count);
+                for (int32 i = 0; i < polygon.m_count; i++) {
+                    ar.Read(polygon.m_vertices[i]);
+                    ar.Read(polygon.m_normals[i]);
+                }
+                return ShapeLibrary::Intern(polygon);
+            }
+            default:
+                return {};
+        }
+    }
+
+    void write_component(OutputArchive& ar, const RigidBodyComponent& r) {
+        // Store the live state of the body, so that it is recreated exactly where it was.
+        b2BodyDef def = r.body_def;
+        if (r.p_body) {
+            def.position = r.p_body->GetPosition();
+            def.angle = r.p_body->GetAngle();
+            def.linearVelocity = r.p_body->GetLinearVelocity();
+            def.angularVelocity = r.p_body->GetAngularVelocity();
+            def.awake = r.p_body->IsAwake();
+            def.enabled = r.p_body->IsEnabled();
+        }
+        ar.Write(int32_t(def.type));
+        ar.Write(def.position);
+        ar.Write(def.angle);
+        ar.Write(def.linearVelocity);
+        ar.Write(def.angularVelocity);
+        ar.Write(def.linearDamping);
+        ar.Write(def.angularDamping);
+        ar.Write(def.allowSleep);
+        ar.Write(def.awake);
+        ar.Write(def.fixedRotation);
+        ar.Write(def.bullet);
+        ar.Write(def.enabled);
+        ar.Write(def.gravityScale);
+        ar.Write(r.static_geometry);
+        ar.Write(r.shard);
+
+        // Only fixtures with supported shapes are stored.
+        uint32_t count = 0;
+        for (auto&& [shape, fixture_def, layer] : r.fixtures)
+            if (shape && (shape->m_type == b2Shape::e_circle || shape->m_type == b2Shape::e_polygon))
+                count++;
+        ar.Write(count);
+        for (auto&& [shape, fixture_def, layer] : r.fixtures) {
+            if (!shape || (shape->m_type != b2Shape::e_circle && shape->m_type != b2Shape::e_polygon))
+                continue;
+            write_shape(ar, shape.get());
+            ar.Write(fixture_def.friction);
+            ar.Write(fixture_def.restitution);
+            ar.Write(fixture_def.restitutionThreshold);
+            ar.Write(fixture_def.density);
+            ar.Write(fixture_def.isSensor);
+            ar.Write(fixture_def.filter);
+            ar.Write(layer);
+        }
+    }
+    void read_component(InputArchive& ar, RigidBodyComponent& r) {
+        r = RigidBodyComponent();
+        b2BodyDef& def = r.body_def;
+        def.type = b2BodyType(ar.Read<int32_t>());
+        ar.Read(def.position);
+        ar.Read(def.angle);
+        ar.Read(def.linearVelocity);
+        ar.Read(def.angularVelocity);
+        ar.Read(def.linearDamping);
+        ar.Read(def.angularDamping);
+        ar.Read(def.allowSleep);
+        ar.Read(def.awake);
+        ar.Read(def.fixedRotation);
+        ar.Read(def.bullet);
+        ar.Read(def.enabled);
+        ar.Read(def.gravityScale);
+        ar.Read(r.static_geometry);
+        ar.Read(r.shard);
+
+        uint32_t count = ar.Read<uint32_t>();
+        r.fixtures.reserve(count);
+        for (uint32_t i = 0; i < count; i++) {
+            SharedShape shape = read_shape(ar);
+            b2FixtureDef fixture_def;
+            ar.Read(fixture_def.friction);
+            ar.Read(fixture_def.restitution);
+            ar.Read(fixture_def.restitutionThreshold);
+            ar.Read(fixture_def.density);
+            ar.Read(fixture_def.isSensor);
+            ar.Read(fixture_def.filter);
+            r.fixtures.push_back({ shape, fixture_def, ar.Read<int32_t>() });
+        }
+    }
+
+    void write_component(OutputArchive& ar, const LuaScriptComponent& l) {
+        ar.Write(uint32_t(l.scripts.size()));
+        for (auto&& [name, script] : l.scripts) {
+            ar.Write(name);
+            ar.Write(script->GetScriptPath());
+            ar.Write(uint32_t(script->m_Parameters.size()));
+            // Values are read from LUA, so that changes made by the script are captured.
+            for (auto&& param : script->m_Parameters) {
+                ar.Write(param.m_Name);
+                ar.Write(int32_t(param.m_Type));
+                std::visit([&ar](const auto& value) { ar.Write(value); }, param.GetValue());
+            }
+        }
+    }
+    void read_component(InputArchive& ar, LuaScriptComponent& l) {
+        // The loader reuses one instance for all entities, so start with an empty component.
+        // Lua state and environment are set by LuaScriptSystem, when the scripts are initialized.
+        l = LuaScriptComponent();
+        uint32_t script_count = ar.Read<uint32_t>();
+        for (uint32_t s = 0; s < script_count; s++) {
+            auto name = ar.Read<std::string>();
+            auto path = ar.Read<std::string>();
+            l.Attach(name, path);
+            LuaScript* script = l.scripts[name].get();
+
+            uint32_t param_count = ar.Read<uint32_t>();
+            for (uint32_t p = 0; p < param_count; p++) {
+                auto param_name = ar.Read<std::string>();
+                auto type = LuaParamType(ar.Read<int32_t>());
+                LuaParamValue value;
+                switch (type) {
+                    case LuaParamType::number:  value = ar.Read<float>(); break;
+                    case LuaParamType::string:  value = ar.Read<std::string>(); break;
+                    case LuaParamType::boolean: value = ar.Read<bool>(); break;
+                    case LuaParamType::vec2:    value = ar.Read<glm::vec2>(); break;
+                    case LuaParamType::vec3:    value = ar.Read<glm::vec3>(); break;
+                    case LuaParamType::color:   value = ar.Read<glm::ivec3>(); break;
+                }
+                script->m_Parameters.push_back(LuaParam(script, param_name, std::move(value)));
+            }
+        }
+    }
+}
+#pragma endregion
+
+void SceneSnapshot::Take(Scene* scene) {
+    m_data.clear();
+    OutputArchive ar(m_data);
+
+    // Body state is read directly, so the physics thread must not step meanwhile.
+    std::unique_lock<std::mutex> world_lock;
+    if (auto physics = scene->GetSystem<PhysicsSystem>())
+        world_lock = physics->LockWorld();
+
+    entt::snapshot{ *scene->m_Registry }
+        .entities(ar)
+        .component<TransformComponent, SpriteComponent, RigidBodyComponent, LuaScriptComponent>(ar);
+
+    // Tags are stored in the scene, not in the registry.
+    uint32_t count = 0;
+    for (auto&& [ent, tags] : scene->m_entityToTags)
+        if (!tags.empty() && scene->m_Registry->valid(ent))
+            count++;
+    ar.Write(count);
+    for (auto&& [ent, tags] : scene->m_entityToTags) {
+        if (tags.empty() || !scene->m_Registry->valid(ent))
+            continue;
+        ar.Write(ent);
+        ar.Write(uint32_t(tags.size()));
+        for (auto&& tag : tags)
+            ar.Write(tag);
+    }
+}
+
+void SceneSnapshot::Restore(Scene* scene) const {
+    REN_ASSERT(!m_data.empty(), "Snapshot is empty.");
+    auto& reg = *scene->m_Registry;
+    auto physics = scene->GetSystem<PhysicsSystem>();
+    auto lua = scene->GetSystem<LuaScriptSystem>();
+    auto native = scene->GetSystem<NativeScriptSystem>();
+
+    // Release everything living outside of the registry. Native scripts are deleted with their components by clear().
+    if (native)
+        for (auto&& ent : reg.view<NativeScriptComponent>())
+            native->DestroyScript(ent);
+    if (lua)
+        for (auto&& [ent, lsc] : reg.view<LuaScriptComponent>().each())
+            for (auto&& [name, script] : lsc.scripts)
+                lua->DestroyScript(ent, script);
+    if (physics)
+        for (auto&& [ent, rig] : reg.view<RigidBodyComponent>().each())
+            if (rig.Initialized())
+                physics->CleanupPhysicsBody(ent);
+    scene->m_tagToEntities.clear();
+    scene->m_entityToTags.clear();
+    reg.clear();
+
+    InputArchive ar(m_data);
+    entt::snapshot_loader{ reg }
+        .entities(ar)
+        .component<TransformComponent, SpriteComponent, RigidBodyComponent, LuaScriptComponent>(ar);
+
+    uint32_t count = ar.Read<uint32_t>();
+    for (uint32_t i = 0; i < count; i++) {
+        auto ent = ar.Read<entt::entity>();
+        uint32_t tag_count = ar.Read<uint32_t>();
+        for (uint32_t t = 0; t < tag_count; t++)
+            scene->AddTag(ent, ar.Read<std::string>());
+    }
+
+    // Bodies are created from the stored body definitions, which hold the state of the bodies at the time of the snapshot
+    // (the stored transform may lag behind in threaded mode). Transforms are moved to them.
+    if (physics)
+        for (auto&& ent : reg.view<RigidBodyComponent>())
+            physics->InitPhysicsBody(ent, true);
+    if (lua)
+        for (auto&& [ent, lsc] : reg.view<LuaScriptComponent>().each())
+            for (auto&& [name, script] : lsc.scripts)
+                lua->InitScript(ent, script);
+}
+
+void SceneSnapshot::SaveToFile(std::filesystem::path path) const {
+    std::ofstream file(path, std::ios::binary | std::ios::trunc);
+    if (!file) {
+        LOG_E("Failed to open snapshot file '" + path.string() + "'.");
+        return;
+    }
+
+    uint64_t size = m_data.size();
+    file.write(reinterpret_cast<const char*>(&SNAPSHOT_MAGIC), sizeof(SNAPSHOT_MAGIC));
+    file.write(reinterpret_cast<const char*>(&SNAPSHOT_VERSION), sizeof(SNAPSHOT_VERSION));
+    file.write(reinterpret_cast<const char*>(&size), sizeof(size));
+    file.write(reinterpret_cast<const char*>(m_data.data()), m_data.size());
+}
+
+bool SceneSnapshot::LoadFromFile(std::filesystem::path path) {
+    std::ifstream file(path, std::ios::binary);
+    if (!file) {
+        LOG_E("Failed to open snapshot file '" + path.string() + "'.");
+        return false;
+    }
+
+    uint32_t magic = 0, version = 0;
+    uint64_t size = 0;
+    file.read(reinterpret_cast<char*>(&magic), sizeof(magic));
+    file.read(reinterpret_cast<char*>(&version), sizeof(version));
+    file.read(reinterpret_cast<char*>(&size), sizeof(size));
+    if (!file || magic != SNAPSHOT_MAGIC || version != SNAPSHOT_VERSION) {
+        LOG_E("File '" + path.string() + "' is not a valid snapshot.");
+        return false;
+    }
+
+    m_data.resize(size);
+    file.read(reinterpret_cast<char*>(m_data.data()), size);
+    if (!file) {
+        LOG_E("Snapshot file '" + path.string() + "' is truncated.");
+        m_data.clear();
+        return false;
+    }
+    return true;
+}
@@ -0,0 +1,166 @@
+/**
+ * @file Ren/ECS/Serialization/WorldStreamer.cpp
+ * @brief Implementation of world streaming.
+ */
+#include <algorithm>
+#include <limits>
+#include <chrono>
+#include <ren_utils/logging.hpp>
+
+#include "Ren/ECS/Serialization/WorldStreamer.hpp"
+#include "Ren/ECS/Serialization/SceneSerializer.hpp"
+#include "Ren/Core/AssetManager.hpp"
+#include "Ren/Scripting/LuaScript.hpp"
+
+using namespace Ren;
+
+WorldStreamer::WorldStreamer(Scene* scene, std::filesystem::path world_dir)
+    : m_scene(scene)
+{
+    REN_ASSERT(scene != nullptr, "Invalid scene.");
+
+    // World index is written by SceneSerializer::SerializeChunks().
+    std::filesystem::path dir = AssetManager::GetScene(world_dir);
+    YAML::Node index = YAML::LoadFile((dir / "world.yaml").string());
+
+    m_chunkSize = index["ChunkSize"].as<float>();
+    // Fixtures in the chunks reference the layers by index.
+    if (index["CollisionLayers"])
+        m_scene->m_CollisionLayers = index["CollisionLayers"].as<CollisionLayers>();
+    for (auto&& chunk_info : index["Chunks"]) {
+        Chunk chunk;
+        chunk.coord = chunk_info["coord"].as<glm::ivec2>();
+        chunk.file = dir / chunk_info["file"].as<std::string>();
+        chunk.bytes = std::filesystem::file_size(chunk.file);
+        m_chunks[key(chunk.coord)] = std::move(chunk);
+    }
+}
+WorldStreamer::~WorldStreamer() {
+    for (auto&& [k, chunk] : m_chunks)
+        if (chunk.pending.valid())
+            chunk.pending.wait();
+}
+
+void WorldStreamer::Update(const std::vector<glm::vec2>& focus_points) {
+    std::vector<std::pair<float, Chunk*>> resident;
+    bool evicted = false;
+
+    for (auto&& [k, chunk] : m_chunks) {
+        float dist = distance(chunk, focus_points);
+
+        switch (chunk.state) {
+        case ChunkState::unloaded:
+            // Don't start loading chunks, that would exceed the budget. Only the chunks with focus point inside are always loaded.
+            if (dist > m_LoadDistance || (dist > 0.0f && m_residentBytes + m_loadingBytes + chunk.bytes > m_MemoryBudget))
+                break;
+            // Parsing of the file is the slow part, so do it in the background.
+            chunk.pending = std::async(std::launch::async, [path = chunk.file]{ return YAML::LoadFile(path.string()); });
+            chunk.state = ChunkState::loading;
+            m_loadingBytes += chunk.bytes;
+            break;
+        case ChunkState::loading: {
+            if (chunk.pending.wait_for(std::chrono::seconds(0)) != std::future_status::ready)
+                break;
+            YAML::Node node;
+            try {
+                node = chunk.pending.get();
+            } catch (const std::exception& e) {
+                LOG_E("Failed to load chunk '" + chunk.file.string() + "'. Error: " + std::string(e.what()));
+            }
+            m_loadingBytes -= chunk.bytes;
+            // Entities, textures and bodies have to be created on the main thread.
+            if (dist <= m_UnloadDistance)
+                instantiate(chunk, node);
+            else
+                chunk.state = ChunkState::unloaded;
+            } break;
+        case ChunkState::loaded:
+            if (dist > m_UnloadDistance) {
+                evict(chunk);
+                evicted = true;
+            }
+            break;
+        }
+
+        if (chunk.state == ChunkState::loaded)
+            resident.push_back({ dist, &chunk });
+    }
+
+    // Evict the furthest chunks until we are within the budget.
+    if (m_residentBytes > m_MemoryBudget) {
+        std::sort(resident.begin(), resident.end(), [](const auto& a, const auto& b) { return a.first > b.first; });
+        for (auto&& [dist, chunk] : resident) {
+            if (m_residentBytes <= m_MemoryBudget || dist <= 0.0f)
+                break;
+            evict(*chunk);
+            evicted = true;
+        }
+    }
+
+    if (evicted) {
+        m_scene->ReleaseUnusedTextures();
+        ShapeLibrary::ReleaseUnused();
+    }
+}
+
+void WorldStreamer::UnloadAll() {
+    for (auto&& [k, chunk] : m_chunks)
+        if (chunk.state == ChunkState::loaded)
+            evict(chunk);
+    m_scene->ReleaseUnusedTextures();
+    ShapeLibrary::ReleaseUnused();
+}
+
+bool WorldStreamer::IsLoaded(ChunkCoord coord) const {
+    auto it = m_chunks.find(key(coord));
+    return it != m_chunks.end() && it->second.state == ChunkState::loaded;
+}
+
+float WorldStreamer::distance(const Chunk& chunk, const std::vector<glm::vec2>& focus_points) const {
+    glm::vec2 min = glm::vec2(chunk.coord) * m_chunkSize;
+    glm::vec2 max = min + glm::vec2(m_chunkSize);
+
+    float closest = std::numeric_limits<float>::max();
+    for (auto&& p : focus_points)
+        closest = std::min(closest, glm::distance(p, glm::clamp(p, min, max)));
+    return closest;
+}
+
+void WorldStreamer::instantiate(Chunk& chunk, const YAML::Node& node) {
+    if (node["Entities"])
+        chunk.entities = SceneSerializer::DeserializeEntities(node["Entities"], m_scene);
+
+    // Initialize new entities the same way Scene::Init() does.
+    auto physics = m_scene->GetSystem<PhysicsSystem>();
+    auto lua = m_scene->GetSystem<LuaScriptSystem>();
+    for (auto&& ent : chunk.entities) {
+        Entity e = m_scene->ToEntity(ent);
+        if (physics && e.HasAll<RigidBodyComponent>())
+            physics->InitPhysicsBody(ent);
+        if (lua && e.HasAll<LuaScriptComponent>())
+            for (auto&& [name, script] : e.Get<LuaScriptComponent>().scripts)
+                lua->InitScript(ent, script);
+    }
+
+    chunk.state = ChunkState::loaded;
+    m_residentBytes += chunk.bytes;
+}
+
+void WorldStreamer::evict(Chunk& chunk) {
+    auto lua = m_scene->GetSystem<LuaScriptSystem>();
+    for (auto&& ent : chunk.entities) {
+        Entity e = m_scene->ToEntity(ent);
+        // Entity could have been destroyed by the game in the meantime.
+        if (!m_scene->EntityValid(e))
+            continue;
+        if (lua && e.HasAll<LuaScriptComponent>())
+            for (auto&& [name, script] : e.Get<LuaScriptComponent>().scripts)
+                lua->DestroyScript(ent, script);
+        // Releases physics body and tags as well.
+        m_scene->DestroyEntity(e);
+    }
+
+    chunk.entities.clear();
+    chunk.state = ChunkState::unloaded;
+    m_residentBytes -= chunk.bytes;
+}
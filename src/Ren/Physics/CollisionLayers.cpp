@@ -0,0 +1,43 @@
+/**
+ * @file Ren/Physics/CollisionLayers.cpp
+ * @brief Implementation of named collision layers.
+ */
+#include <algorithm>
+
+#include "Ren/Physics/CollisionLayers.hpp"
+#include "Ren/Core/Core.hpp"
+
+using namespace Ren;
+
+CollisionLayers::CollisionLayers() {
+    Clear();
+}
+
+int32_t CollisionLayers::Add(const std::string& name) {
+    if (int32_t layer = Find(name); layer >= 0)
+        return layer;
+    if (Count() >= MAX_LAYERS)
+        return -1;
+    m_names.push_back(name);
+    return Count() - 1;
+}
+int32_t CollisionLayers::Find(const std::string& name) const {
+    auto it = std::find(m_names.begin(), m_names.end(), name);
+    return it != m_names.end() ? int32_t(it - m_names.begin()) : -1;
+}
+void CollisionLayers::Clear() {
+    m_names = { DEFAULT_LAYER };
+    m_masks.fill(0xFFFF);
+}
+
+void CollisionLayers::SetCollides(int32_t a, int32_t b, bool collides) {
+    REN_ASSERT(a >= 0 && a < MAX_LAYERS && b >= 0 && b < MAX_LAYERS, "Invalid collision layer.");
+    if (collides) {
+        m_masks[a] |= uint16(1 << b);
+        m_masks[b] |= uint16(1 << a);
+    }
+    else {
+        m_masks[a] &= uint16(~(1 << b));
+        m_masks[b] &= uint16(~(1 << a));
+    }
+}
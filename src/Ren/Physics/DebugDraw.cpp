@@ -0,0 +1,183 @@
+/**
+ * @file Ren/Physics/DebugDraw.cpp
+ * @brief Implementation of Box2D debug drawing into a geometry batch.
+ */
+#define _USE_MATH_DEFINES
+#include <cmath>
+#include <algorithm>
+
+#include "Ren/Physics/DebugDraw.hpp"
+#include "Ren/Physics/Physics.hpp"
+#include "Ren/Renderer/Renderer.hpp"
+
+using namespace Ren;
+
+// Same colors as b2World::DebugDraw() uses.
+static b2Color body_color(const b2Body* body) {
+    if (body->GetType() == b2_staticBody)
+        return b2Color(0.5f, 0.9f, 0.5f);
+    if (body->GetType() == b2_kinematicBody)
+        return b2Color(0.5f, 0.5f, 0.9f);
+    if (!body->IsAwake())
+        return b2Color(0.6f, 0.6f, 0.6f);
+    return b2Color(0.9f, 0.7f, 0.7f);
+}
+
+void PhysicsDebugDraw::Draw(b2World& world, const glm::vec2& view_min, const glm::vec2& view_max) {
+    m_drawnChains.clear();
+    if (auto camera = Renderer::GetCamera())
+        m_pixelsPerUnit = float(camera->GetUnitScale().x);
+
+    b2AABB view;
+    view.lowerBound = Utils::to_b2Vec2(view_min);
+    view.upperBound = Utils::to_b2Vec2(view_max);
+    uint32 flags = GetFlags();
+
+    // Only fixtures in the view are reported by the broad-phase, so we don't have to walk all the bodies.
+    // Note: Disabled bodies are not in the broad-phase, so they are not drawn.
+    if (flags & (e_shapeBit | e_aabbBit | e_centerOfMassBit)) {
+        struct Query : b2QueryCallback {
+            PhysicsDebugDraw* draw;
+            uint32 flags;
+            Query(PhysicsDebugDraw* draw, uint32 flags) : draw(draw), flags(flags) {}
+
+            bool ReportFixture(b2Fixture* fixture) override {
+                if (fixture->GetType() == b2Shape::e_chain) {
+                    auto& drawn = draw->m_drawnChains;
+                    if (std::find(drawn.begin(), drawn.end(), fixture) != drawn.end())
+                        return true;
+                    drawn.push_back(fixture);
+                }
+                const b2Body* body = fixture->GetBody();
+                if (flags & e_shapeBit)
+                    draw->drawFixture(fixture, body->GetTransform(), body_color(body));
+                if (flags & e_aabbBit) {
+                    b2Color color(0.9f, 0.3f, 0.9f);
+                    for (int32 child = 0; child < fixture->GetShape()->GetChildCount(); child++) {
+                        const b2AABB& aabb = fixture->GetAABB(child);
+                        b2Vec2 vs[4] = { aabb.lowerBound, { aabb.upperBound.x, aabb.lowerBound.y }, aabb.upperBound, { aabb.lowerBound.x, aabb.upperBound.y } };
+                        draw->DrawPolygon(vs, 4, color);
+                    }
+                }
+                // Draw center of mass only once per body.
+                if ((flags & e_centerOfMassBit) && fixture == body->GetFixtureList()) {
+                    b2Transform xf = body->GetTransform();
+                    xf.p = body->GetWorldCenter();
+                    draw->DrawTransform(xf);
+                }
+                return true;
+            }
+        } query(this, flags);
+        world.QueryAABB(&query, view);
+    }
+
+    if (flags & e_jointBit) {
+        for (b2Joint* joint = world.GetJointList(); joint; joint = joint->GetNext()) {
+            // Joint is drawn as lines between the bodies and the anchors.
+            b2AABB box;
+            box.lowerBound = b2Min(joint->GetAnchorA(), joint->GetAnchorB());
+            box.upperBound = b2Max(joint->GetAnchorA(), joint->GetAnchorB());
+            for (b2Body* body : { joint->GetBodyA(), joint->GetBodyB() }) {
+                box.lowerBound = b2Min(box.lowerBound, body->GetPosition());
+                box.upperBound = b2Max(box.upperBound, body->GetPosition());
+            }
+            if (b2TestOverlap(box, view))
+                joint->Draw(this);
+        }
+    }
+}
+
+void PhysicsDebugDraw::drawFixture(const b2Fixture* fixture, const b2Transform& xf, const b2Color& color) {
+    switch (fixture->GetType()) {
+    case b2Shape::e_circle: {
+        const b2CircleShape* circle = (const b2CircleShape*)fixture->GetShape();
+        DrawSolidCircle(b2Mul(xf, circle->m_p), circle->m_radius, b2Mul(xf.q, b2Vec2(1.0f, 0.0f)), color);
+        } break;
+    case b2Shape::e_edge: {
+        const b2EdgeShape* edge = (const b2EdgeShape*)fixture->GetShape();
+        b2Vec2 v1 = b2Mul(xf, edge->m_vertex1);
+        b2Vec2 v2 = b2Mul(xf, edge->m_vertex2);
+        DrawSegment(v1, v2, color);
+        if (!edge->m_oneSided) {
+            DrawPoint(v1, 4.0f, color);
+            DrawPoint(v2, 4.0f, color);
+        }
+        } break;
+    case b2Shape::e_chain: {
+        const b2ChainShape* chain = (const b2ChainShape*)fixture->GetShape();
+        b2Vec2 v1 = b2Mul(xf, chain->m_vertices[0]);
+        for (int32 i = 1; i < chain->m_count; i++) {
+            b2Vec2 v2 = b2Mul(xf, chain->m_vertices[i]);
+            DrawSegment(v1, v2, color);
+            v1 = v2;
+        }
+        } break;
+    case b2Shape::e_polygon: {
+        const b2PolygonShape* poly = (const b2PolygonShape*)fixture->GetShape();
+        b2Vec2 vertices[b2_maxPolygonVertices];
+        for (int32 i = 0; i < poly->m_count; i++)
+            vertices[i] = b2Mul(xf, poly->m_vertices[i]);
+        DrawSolidPolygon(vertices, poly->m_count, color);
+        } break;
+    default:
+        break;
+    }
+}
+
+#pragma region b2Draw interface
+
+void PhysicsDebugDraw::DrawPolygon(const b2Vec2* vertices, int32 vertexCount, const b2Color& color) {
+    Color4 c = toColor(color);
+    for (int32 i = 0; i < vertexCount; i++)
+        m_batch.AddLine(Utils::to_vec2(vertices[i]), Utils::to_vec2(vertices[(i + 1) % vertexCount]), c);
+}
+void PhysicsDebugDraw::DrawSolidPolygon(const b2Vec2* vertices, int32 vertexCount, const b2Color& color) {
+    // Polygons are convex, so triangle fan is enough.
+    Color4 fill = toColor(color, m_FillAlpha / 255.0f);
+    for (int32 i = 1; i + 1 < vertexCount; i++)
+        m_batch.AddTriangle(Utils::to_vec2(vertices[0]), Utils::to_vec2(vertices[i]), Utils::to_vec2(vertices[i + 1]), fill);
+    DrawPolygon(vertices, vertexCount, color);
+}
+void PhysicsDebugDraw::DrawCircle(const b2Vec2& center, float radius, const b2Color& color) {
+    Color4 c = toColor(color);
+    glm::vec2 pos = Utils::to_vec2(center);
+    float step = 2.0f * float(M_PI) / float(m_CircleSegments);
+    glm::vec2 prev = pos + glm::vec2(radius, 0.0f);
+    for (int32 i = 1; i <= m_CircleSegments; i++) {
+        glm::vec2 next = pos + glm::vec2(std::cos(step * i), std::sin(step * i)) * radius;
+        m_batch.AddLine(prev, next, c);
+        prev = next;
+    }
+}
+void PhysicsDebugDraw::DrawSolidCircle(const b2Vec2& center, float radius, const b2Vec2& axis, const b2Color& color) {
+    Color4 fill = toColor(color, m_FillAlpha / 255.0f);
+    glm::vec2 pos = Utils::to_vec2(center);
+    float step = 2.0f * float(M_PI) / float(m_CircleSegments);
+    glm::vec2 prev = pos + glm::vec2(radius, 0.0f);
+    for (int32 i = 1; i <= m_CircleSegments; i++) {
+        glm::vec2 next = pos + glm::vec2(std::cos(step * i), std::sin(step * i)) * radius;
+        m_batch.AddTriangle(pos, prev, next, fill);
+        prev = next;
+    }
+    DrawCircle(center, radius, color);
+    // Show rotation of the circle.
+    m_batch.AddLine(pos, pos + Utils::to_vec2(axis) * radius, toColor(color));
+}
+void PhysicsDebugDraw::DrawSegment(const b2Vec2& p1, const b2Vec2& p2, const b2Color& color) {
+    m_batch.AddLine(Utils::to_vec2(p1), Utils::to_vec2(p2), toColor(color));
+}
+void PhysicsDebugDraw::DrawTransform(const b2Transform& xf) {
+    const float axis_scale = 0.4f;
+    glm::vec2 p = Utils::to_vec2(xf.p);
+    m_batch.AddLine(p, p + Utils::to_vec2(xf.q.GetXAxis()) * axis_scale, Colors4::Red);
+    m_batch.AddLine(p, p + Utils::to_vec2(xf.q.GetYAxis()) * axis_scale, Colors4::Green);
+}
+void PhysicsDebugDraw::DrawPoint(const b2Vec2& p, float size, const b2Color& color) {
+    glm::vec2 pos = Utils::to_vec2(p);
+    glm::vec2 half(size * 0.5f / m_pixelsPerUnit);
+    Color4 c = toColor(color);
+    m_batch.AddTriangle(pos - half, { pos.x + half.x, pos.y - half.y }, pos + half, c);
+    m_batch.AddTriangle(pos - half, pos + half, { pos.x - half.x, pos.y + half.y }, c);
+}
+
+#pragma endregion
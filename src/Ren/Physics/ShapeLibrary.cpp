@@ -0,0 +1,261 @@
+/**
+ * @file Ren/Physics/ShapeLibrary.cpp
+ * @brief Implementation of interned Box2D shapes and pooled fixture lists.
+ */
+#include <algorithm>
+#include <array>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "Ren/Physics/ShapeLibrary.hpp"
+#include "Ren/Core/Core.hpp"
+
+using namespace Ren;
+
+#pragma region Shapes
+
+struct SharedShape::Entry {
+    std::atomic<uint32_t> refs{ 0 };
+    std::unique_ptr<b2Shape> shape;
+};
+
+namespace {
+    std::mutex s_shapesMutex;
+    // Shapes by the bytes of their definition.
+    std::unordered_map<std::string, std::unique_ptr<SharedShape::Entry>> s_shapes;
+
+    template<typename T>
+    void append(std::string& key, const T& value) { key.append(reinterpret_cast<const char*>(&value), sizeof(T)); }
+    void append(std::string& key, const b2Vec2* vertices, int32 count) { key.append(reinterpret_cast<const char*>(vertices), sizeof(b2Vec2) * count); }
+
+    // Bytes, which define the shape. Shapes with equal keys are equal.
+    std::string shape_key(const b2Shape& shape) {
+        std::string key;
+        append(key, shape.m_type);
+        append(key, shape.m_radius);
+        switch (shape.m_type) {
+            case b2Shape::e_circle:
+                append(key, static_cast<const b2CircleShape&>(shape).m_p);
+                break;
+            case b2Shape::e_edge: {
+                auto& edge = static_cast<const b2EdgeShape&>(shape);
+                append(key, edge.m_vertex0);
+                append(key, edge.m_vertex1);
+                append(key, edge.m_vertex2);
+                append(key, edge.m_vertex3);
+                append(key, edge.m_oneSided);
+                } break;
+            case b2Shape::e_polygon: {
+                auto& polygon = static_cast<const b2PolygonShape&>(shape);
+                append(key, polygon.m_count);
+                append(key, polygon.m_centroid);
+                append(key, polygon.m_vertices, polygon.m_count);
+                append(key, polygon.m_normals, polygon.m_count);
+                } break;
+            case b2Shape::e_chain: {
+                auto& chain = static_cast<const b2ChainShape&>(shape);
+                append(key, chain.m_count);
+                append(key, chain.m_vertices, chain.m_count);
+                append(key, chain.m_prevVertex);
+                append(key, chain.m_nextVertex);
+                } break;
+            default:
+                break;
+        }
+        return key;
+    }
+
+    std::unique_ptr<b2Shape> clone_shape(const b2Shape& shape) {
+        switch (shape.m_type) {
+            case b2Shape::e_circle:  return std::make_unique<b2CircleShape>(static_cast<const b2CircleShape&>(shape));
+            case b2Shape::e_edge:    return std::make_unique<b2EdgeShape>(static_cast<const b2EdgeShape&>(shape));
+            case b2Shape::e_polygon: return std::make_unique<b2PolygonShape>(static_cast<const b2PolygonShape&>(shape));
+            case b2Shape::e_chain: {
+                // Chain owns its vertices, so it can't be copied directly.
+                auto& src = static_cast<const b2ChainShape&>(shape);
+                auto chain = std::make_unique<b2ChainShape>();
+                chain->CreateChain(src.m_vertices, src.m_count, src.m_prevVertex, src.m_nextVertex);
+                chain->m_radius = src.m_radius;
+                return chain;
+            }
+            default:
+                return nullptr;
+        }
+    }
+}
+
+SharedShape::SharedShape(Entry* entry) : m_entry(entry) {
+    m_entry->refs.fetch_add(1, std::memory_order_relaxed);
+}
+SharedShape::SharedShape(const SharedShape& other) : m_entry(other.m_entry) {
+    if (m_entry)
+        m_entry->refs.fetch_add(1, std::memory_order_relaxed);
+}
+SharedShape::~SharedShape() {
+    if (m_entry)
+        m_entry->refs.fetch_sub(1, std::memory_order_acq_rel);
+}
+const b2Shape* SharedShape::get() const {
+    return m_entry ? m_entry->shape.get() : nullptr;
+}
+
+SharedShape ShapeLibrary::Intern(const b2Shape& shape) {
+    std::string key = shape_key(shape);
+    std::lock_guard<std::mutex> lock(s_shapesMutex);
+    auto& entry = s_shapes[key];
+    if (!entry) {
+        entry = std::make_unique<SharedShape::Entry>();
+        entry->shape = clone_shape(shape);
+        REN_ASSERT(entry->shape, "Shape type " + std::to_string(shape.m_type) + " is not supported by ShapeLibrary.");
+    }
+    return SharedShape(entry.get());
+}
+SharedShape ShapeLibrary::Box(float hx, float hy, const b2Vec2& center, float angle) {
+    b2PolygonShape box;
+    box.SetAsBox(hx, hy, center, angle);
+    return Intern(box);
+}
+SharedShape ShapeLibrary::Circle(float radius, const b2Vec2& center) {
+    b2CircleShape circle;
+    circle.m_radius = radius;
+    circle.m_p = center;
+    return Intern(circle);
+}
+SharedShape ShapeLibrary::Polygon(const b2Vec2* points, int32 count) {
+    b2PolygonShape polygon;
+    polygon.Set(points, count);
+    return Intern(polygon);
+}
+void ShapeLibrary::ReleaseUnused() {
+    // New handles are created only under the lock, so zero reference count can't change meanwhile.
+    std::lock_guard<std::mutex> lock(s_shapesMutex);
+    for (auto it = s_shapes.begin(); it != s_shapes.end();) {
+        if (it->second->refs.load(std::memory_order_acquire) == 0)
+            it = s_shapes.erase(it);
+        else
+            it++;
+    }
+}
+std::size_t ShapeLibrary::Size() {
+    std::lock_guard<std::mutex> lock(s_shapesMutex);
+    return s_shapes.size();
+}
+
+#pragma endregion
+#pragma region Fixtures
+
+// Header of a pooled block. Fixtures are stored right after it.
+struct alignas(alignof(std::max_align_t)) FixtureList::Block {
+    std::atomic<uint32_t> refs{ 1 };
+    uint32_t count{ 0 };
+    uint32_t capacity{ 0 };
+
+    Block(uint32_t capacity) : capacity(capacity) {}
+    inline Fixture* data() { return reinterpret_cast<Fixture*>(this + 1); }
+};
+
+namespace {
+    // Blocks have power of two capacities. Released blocks are kept in free lists and reused.
+    constexpr std::size_t SIZE_CLASSES = 32;
+    std::mutex s_poolMutex;
+    std::array<std::vector<void*>, SIZE_CLASSES> s_freeBlocks;
+    std::size_t s_poolBytes{ 0 };
+
+    inline uint32_t size_class(std::size_t capacity) {
+        uint32_t c = 0;
+        while ((std::size_t(1) << c) < capacity)
+            c++;
+        return c;
+    }
+    inline std::size_t block_bytes(uint32_t size_class) {
+        return sizeof(FixtureList::Block) + (std::size_t(1) << size_class) * sizeof(Fixture);
+    }
+
+    FixtureList::Block* allocate_block(std::size_t capacity) {
+        uint32_t c = size_class(capacity);
+        REN_ASSERT(c < SIZE_CLASSES, "Too many fixtures.");
+        void* memory = nullptr;
+        {
+            std::lock_guard<std::mutex> lock(s_poolMutex);
+            if (!s_freeBlocks[c].empty()) {
+                memory = s_freeBlocks[c].back();
+                s_freeBlocks[c].pop_back();
+            }
+            else
+                s_poolBytes += block_bytes(c);
+        }
+        if (!memory)
+            memory = ::operator new(block_bytes(c));
+        return new (memory) FixtureList::Block(uint32_t(1) << c);
+    }
+    void release_block(FixtureList::Block* block) {
+        for (uint32_t i = 0; i < block->count; i++)
+            block->data()[i].~Fixture();
+        uint32_t c = size_class(block->capacity);
+        block->~Block();
+
+        std::lock_guard<std::mutex> lock(s_poolMutex);
+        s_freeBlocks[c].push_back(block);
+    }
+}
+
+FixtureList::FixtureList(const FixtureList& other) : m_block(other.m_block) {
+    if (m_block)
+        m_block->refs.fetch_add(1, std::memory_order_relaxed);
+}
+FixtureList::~FixtureList() {
+    clear();
+}
+
+void FixtureList::makeUnique(std::size_t capacity) {
+    if (m_block && m_block->refs.load(std::memory_order_acquire) == 1 && capacity <= m_block->capacity)
+        return;
+
+    Block* block = allocate_block(std::max<std::size_t>(capacity, size()));
+    for (const Fixture& fixture : *this)
+        new (block->data() + block->count++) Fixture(fixture);
+    clear();
+    m_block = block;
+}
+void FixtureList::push_back(const Fixture& fixture) {
+    // Fixture may be from this list, which could be reallocated.
+    Fixture copy = fixture;
+    std::size_t count = size();
+    makeUnique(count + 1);
+    new (m_block->data() + count) Fixture(std::move(copy));
+    m_block->count++;
+}
+void FixtureList::SetLayer(int32_t index, int32_t layer) {
+    REN_ASSERT(index < int32_t(size()), "Fixture index out of range.");
+    if (empty())
+        return;
+    makeUnique(size());
+    for (uint32_t i = 0; i < m_block->count; i++)
+        if (index < 0 || int32_t(i) == index)
+            m_block->data()[i].layer = layer;
+}
+void FixtureList::reserve(std::size_t capacity) {
+    if (!m_block || capacity > m_block->capacity)
+        makeUnique(capacity);
+}
+void FixtureList::clear() {
+    if (m_block && m_block->refs.fetch_sub(1, std::memory_order_acq_rel) == 1)
+        release_block(m_block);
+    m_block = nullptr;
+}
+std::size_t FixtureList::size() const {
+    return m_block ? m_block->count : 0;
+}
+const Fixture* FixtureList::begin() const {
+    return m_block ? m_block->data() : nullptr;
+}
+std::size_t FixtureList::PoolBytes() {
+    std::lock_guard<std::mutex> lock(s_poolMutex);
+    return s_poolBytes;
+}
+
+#pragma endregion
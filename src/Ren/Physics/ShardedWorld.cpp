@@ -0,0 +1,212 @@
+/**
+ * @file Ren/Physics/ShardedWorld.cpp
+ * @brief Implementation of physics world split into shards stepped in parallel.
+ */
+#include "Ren/Physics/ShardedWorld.hpp"
+#include "Ren/Physics/StaticGeometry.hpp"
+
+using namespace Ren;
+
+ShardedWorld::ShardedWorld(const StaticGeometry& static_geometry, const b2Vec2& gravity)
+    : m_staticGeometry(static_geometry), m_gravity(gravity)
+{}
+
+uint32_t ShardedWorld::Add(std::optional<b2AABB> region) {
+    uint32_t index = uint32_t(m_shards.size());
+    Shard& shard = m_shards.emplace_back();
+    shard.world = CreateRef<b2World>(m_gravity);
+    shard.listener = CreateRef<ContactRecorder>(this, index);
+    shard.world->SetContactListener(shard.listener.get());
+    shard.region = region;
+    m_worlds.push_back(shard.world.get());
+    return index;
+}
+void ShardedWorld::Clear() {
+    m_shards.clear();
+    m_worlds.clear();
+    m_awake.clear();
+}
+uint32_t ShardedWorld::ShardAt(const b2Vec2& position) const {
+    for (uint32_t i = 1; i < m_shards.size(); i++)
+        if (m_shards[i].region && b2TestOverlap(*m_shards[i].region, b2AABB{ position, position }))
+            return i;
+    return 0;
+}
+
+void ShardedWorld::Step(ThreadPool& pool, float dt, int32_t velocity_iterations, int32_t position_iterations) {
+    // Worlds don't share any state, so each of them can be stepped on a different thread.
+    // The only exception are the statistics counters of Box2D (b2_toiCalls, b2_gjkCalls and the others in b2_distance.cpp
+    // and b2_time_of_impact.cpp). They are plain globals incremented by every step, so the shards race on them. Nothing
+    // reads them except profiling code and a lost increment only skews the statistics, so the race is accepted.
+    pool.ParallelFor(m_shards.size(), [&](std::size_t i) {
+        m_shards[i].world->Step(dt, velocity_iterations, position_iterations);
+    });
+}
+void ShardedWorld::StepTracked(ThreadPool& pool, float dt, int32_t velocity_iterations, int32_t position_iterations, std::vector<BodyState>& states) {
+    // Remember state before the step for interpolation. Only awake bodies can move.
+    // Bodies replaced by migration are disabled until they are destroyed, so they are skipped.
+    states.clear();
+    m_awake.clear();
+    for (b2World* world : m_worlds) {
+        for (b2Body* body = world->GetBodyList(); body; body = body->GetNext()) {
+            if (body->GetType() == b2_staticBody || !body->IsAwake() || !body->IsEnabled())
+                continue;
+            states.push_back({ Utils::body_entity(body), body->GetPosition(), body->GetAngle(), body->GetPosition(), body->GetAngle() });
+            m_awake.push_back(body);
+        }
+    }
+
+    Step(pool, dt, velocity_iterations, position_iterations);
+
+    // Bodies are not created nor destroyed during the step, so the order is the same. Bodies, which fell asleep
+    // in this step, are published for the last time. Bodies woken up by the step are published without interpolation.
+    std::size_t awake = 0, awake_count = m_awake.size();
+    for (b2World* world : m_worlds) {
+        for (b2Body* body = world->GetBodyList(); body; body = body->GetNext()) {
+            if (awake < awake_count && m_awake[awake] == body) {
+                auto& state = states[awake++];
+                state.position = body->GetPosition();
+                state.angle = body->GetAngle();
+                // It won't be published again, so the reader has to end at the final state.
+                if (!body->IsAwake()) {
+                    state.prev_position = state.position;
+                    state.prev_angle = state.angle;
+                }
+            }
+            else if (body->GetType() != b2_staticBody && body->IsAwake() && body->IsEnabled())
+                states.push_back({ Utils::body_entity(body), body->GetPosition(), body->GetAngle(), body->GetPosition(), body->GetAngle() });
+        }
+    }
+}
+
+void ShardedWorld::Migrate(bool keep_old, std::vector<Migration>& migrated) {
+    if (m_shards.size() < 2)
+        return;
+
+    // Shards and their bodies are walked in order, so the result doesn't depend on how the shards were stepped.
+    // Only shard 0 and the shards with region take part in migration.
+    std::vector<std::pair<b2Body*, uint32_t>> moving;
+    std::vector<b2Fixture*> fixtures;
+    for (uint32_t s = 0; s < m_shards.size(); s++) {
+        if (s != 0 && !m_shards[s].region)
+            continue;
+        moving.clear();
+        for (b2Body* body = m_shards[s].world->GetBodyList(); body; body = body->GetNext()) {
+            // Joints can't cross worlds, so jointed bodies stay where they are.
+            if (body->GetType() == b2_staticBody || !body->IsAwake() || !body->IsEnabled() || body->GetJointList())
+                continue;
+            uint32_t target = ShardAt(body->GetPosition());
+            if (target != s)
+                moving.push_back({ body, target });
+        }
+
+        for (auto&& [body, target] : moving) {
+            b2BodyDef def;
+            def.type = body->GetType();
+            def.position = body->GetPosition();
+            def.angle = body->GetAngle();
+            def.linearVelocity = body->GetLinearVelocity();
+            def.angularVelocity = body->GetAngularVelocity();
+            def.linearDamping = body->GetLinearDamping();
+            def.angularDamping = body->GetAngularDamping();
+            def.allowSleep = body->IsSleepingAllowed();
+            def.fixedRotation = body->IsFixedRotation();
+            def.bullet = body->IsBullet();
+            def.gravityScale = body->GetGravityScale();
+            def.userData = body->GetUserData();
+            b2Body* clone = m_shards[target].world->CreateBody(&def);
+
+            // Fixtures are prepended by CreateFixture(), so create them in reverse to keep the order.
+            fixtures.clear();
+            for (b2Fixture* fixture = body->GetFixtureList(); fixture; fixture = fixture->GetNext())
+                fixtures.push_back(fixture);
+            for (auto it = fixtures.rbegin(); it != fixtures.rend(); ++it) {
+                b2Fixture* fixture = *it;
+                b2FixtureDef fixture_def;
+                fixture_def.shape = fixture->GetShape();
+                fixture_def.friction = fixture->GetFriction();
+                fixture_def.restitution = fixture->GetRestitution();
+                fixture_def.restitutionThreshold = fixture->GetRestitutionThreshold();
+                fixture_def.density = fixture->GetDensity();
+                fixture_def.isSensor = fixture->IsSensor();
+                fixture_def.filter = fixture->GetFilterData();
+                fixture_def.userData = fixture->GetUserData();
+                clone->CreateFixture(&fixture_def);
+            }
+
+            b2Body* old_body = nullptr;
+            if (keep_old) {
+                body->SetEnabled(false);
+                old_body = body;
+            }
+            else
+                m_shards[s].world->DestroyBody(body);
+            migrated.push_back({ clone, old_body });
+        }
+    }
+}
+void ShardedWorld::CollectContacts(std::vector<ContactEvent>& out) {
+    for (auto&& shard : m_shards) {
+        out.insert(out.end(), shard.contacts.begin(), shard.contacts.end());
+        shard.contacts.clear();
+    }
+}
+
+void ShardedWorld::recordContact(uint32_t shard, ContactEventType type, b2Contact* contact, const b2ContactImpulse* impulse) {
+    b2Fixture* fix_a = contact->GetFixtureA();
+    b2Fixture* fix_b = contact->GetFixtureB();
+
+    ContactEvent& event = m_shards[shard].contacts.emplace_back();
+    event.type = type;
+    event.a = Utils::body_entity(fix_a->GetBody());
+    event.b = Utils::body_entity(fix_b->GetBody());
+    event.sensor = fix_a->IsSensor() || fix_b->IsSensor();
+
+    if (type != ContactEventType::end) {
+        b2WorldManifold manifold;
+        contact->GetWorldManifold(&manifold);
+        event.normal = manifold.normal;
+        event.point_count = contact->GetManifold()->pointCount;
+        for (int32_t i = 0; i < event.point_count; i++)
+            event.points[i] = manifold.points[i];
+    }
+
+    // Merged static geometry has no entity, so find the merged entity at the contact point (or under the other fixture).
+    // Geometry is modified only under the world lock, which is held during the step (shards only read it).
+    const auto find_tile = [&](b2Fixture* other, int32 child) {
+        b2AABB box = other->GetAABB(child);
+        if (event.point_count > 0) {
+            box.lowerBound = event.points[0] - b2Vec2(b2_linearSlop, b2_linearSlop);
+            box.upperBound = event.points[0] + b2Vec2(b2_linearSlop, b2_linearSlop);
+        }
+        entt::entity found = entt::null;
+        m_staticGeometry.Query(box, [&found](entt::entity ent) { found = ent; return false; });
+        return found;
+    };
+    if (event.a == entt::null && !m_staticGeometry.Empty())
+        event.a = find_tile(fix_b, contact->GetChildIndexB());
+    if (event.b == entt::null && !m_staticGeometry.Empty())
+        event.b = find_tile(fix_a, contact->GetChildIndexA());
+    if (impulse) {
+        for (int32_t i = 0; i < impulse->count; i++) {
+            event.normal_impulses[i] = impulse->normalImpulses[i];
+            event.tangent_impulses[i] = impulse->tangentImpulses[i];
+        }
+    }
+}
+
+// Callbacks only record the events. They are dispatched after the step (see PhysicsSystem::dispatchContacts()).
+void ShardedWorld::ContactRecorder::BeginContact(b2Contact* contact) {
+    m_world->recordContact(m_shard, ContactEventType::begin, contact);
+}
+void ShardedWorld::ContactRecorder::EndContact(b2Contact* contact) {
+    m_world->recordContact(m_shard, ContactEventType::end, contact);
+}
+void ShardedWorld::ContactRecorder::PreSolve(b2Contact* contact, const b2Manifold* oldManifold) {
+    if (m_world->m_RecordSolveEvents)
+        m_world->recordContact(m_shard, ContactEventType::pre_solve, contact);
+}
+void ShardedWorld::ContactRecorder::PostSolve(b2Contact* contact, const b2ContactImpulse* impulse) {
+    if (m_world->m_RecordSolveEvents)
+        m_world->recordContact(m_shard, ContactEventType::post_solve, contact, impulse);
+}
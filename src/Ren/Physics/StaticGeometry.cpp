@@ -0,0 +1,209 @@
+/**
+ * @file Ren/Physics/StaticGeometry.cpp
+ * @brief Implementation of static geometry merged from tiles.
+ */
+#include <algorithm>
+#include <cmath>
+
+#include "Ren/Physics/StaticGeometry.hpp"
+#include "Ren/Physics/Physics.hpp"
+
+using namespace Ren;
+
+// Merge touching boxes with the same extent on the other axis. First along x (into strips) and then along y.
+static void merge_boxes(std::vector<b2AABB>& boxes) {
+    const float eps = 1e-4f;
+    std::vector<b2AABB> merged;
+    for (int32 axis : { 0, 1 }) {
+        int32 other = 1 - axis;
+        std::sort(boxes.begin(), boxes.end(), [axis, other](const b2AABB& a, const b2AABB& b) {
+            if (a.lowerBound(other) != b.lowerBound(other)) return a.lowerBound(other) < b.lowerBound(other);
+            if (a.upperBound(other) != b.upperBound(other)) return a.upperBound(other) < b.upperBound(other);
+            return a.lowerBound(axis) < b.lowerBound(axis);
+        });
+        merged.clear();
+        for (auto&& box : boxes) {
+            if (!merged.empty()) {
+                b2AABB& last = merged.back();
+                if (std::abs(last.lowerBound(other) - box.lowerBound(other)) <= eps &&
+                    std::abs(last.upperBound(other) - box.upperBound(other)) <= eps &&
+                    box.lowerBound(axis) <= last.upperBound(axis) + eps) {
+                    last.upperBound(axis) = std::max(last.upperBound(axis), box.upperBound(axis));
+                    continue;
+                }
+            }
+            merged.push_back(box);
+        }
+        boxes.swap(merged);
+    }
+}
+// Bytes of the fixture definition, which make the material of the fixture (groups are per shard).
+static std::string material_key(const b2FixtureDef& def, uint32_t shard) {
+    std::string key;
+    const auto append = [&key](const auto& value) { key.append(reinterpret_cast<const char*>(&value), sizeof(value)); };
+    append(shard);
+    append(def.friction);
+    append(def.restitution);
+    append(def.restitutionThreshold);
+    append(def.density);
+    append(def.isSensor);
+    append(def.filter.categoryBits);
+    append(def.filter.maskBits);
+    append(def.filter.groupIndex);
+    return key;
+}
+// Local box of the shape, if it is an axis-aligned box.
+static bool axis_aligned_box(const b2Shape* shape, b2AABB& box) {
+    const float eps = 1e-4f;
+    if (!shape || shape->m_type != b2Shape::e_polygon)
+        return false;
+    auto polygon = static_cast<const b2PolygonShape*>(shape);
+    if (polygon->m_count != 4)
+        return false;
+    box = { polygon->m_vertices[0], polygon->m_vertices[0] };
+    for (int32 i = 1; i < 4; i++) {
+        box.lowerBound = b2Min(box.lowerBound, polygon->m_vertices[i]);
+        box.upperBound = b2Max(box.upperBound, polygon->m_vertices[i]);
+    }
+    for (int32 i = 0; i < 4; i++) {
+        const b2Vec2& v = polygon->m_vertices[i];
+        bool corner_x = std::abs(v.x - box.lowerBound.x) <= eps || std::abs(v.x - box.upperBound.x) <= eps;
+        bool corner_y = std::abs(v.y - box.lowerBound.y) <= eps || std::abs(v.y - box.upperBound.y) <= eps;
+        if (!corner_x || !corner_y)
+            return false;
+    }
+    return true;
+}
+
+bool StaticGeometry::Add(entt::entity ent, const b2BodyDef& body_def, const std::vector<b2FixtureDef>& fixtures, uint32_t shard) {
+    if (body_def.type != b2_staticBody || body_def.angle != 0.0f || fixtures.empty())
+        return false;
+
+    // Every fixture must be an axis-aligned box.
+    std::vector<b2AABB> boxes;
+    for (auto&& def : fixtures) {
+        b2AABB box;
+        if (!axis_aligned_box(def.shape, box))
+            return false;
+        box.lowerBound += body_def.position;
+        box.upperBound += body_def.position;
+        boxes.push_back(box);
+    }
+
+    Tile tile;
+    for (std::size_t i = 0; i < fixtures.size(); i++) {
+        auto [it, inserted] = m_groupIds.try_emplace(material_key(fixtures[i], shard), uint32_t(m_groups.size()));
+        if (inserted)
+            m_groups.push_back({ fixtures[i], shard, {}, false });
+        tile.boxes.push_back({ it->second, boxes[i] });
+    }
+    for (auto&& [group, box] : tile.boxes) {
+        tile.proxies.push_back(m_index.CreateProxy(box, reinterpret_cast<void*>(Utils::to_user_data(ent))));
+        auto& static_group = m_groups[group];
+        if (static_group.tiles.empty() || static_group.tiles.back() != ent)
+            static_group.tiles.push_back(ent);
+        static_group.dirty = true;
+    }
+    m_tiles[ent] = std::move(tile);
+    m_dirty = true;
+    return true;
+}
+void StaticGeometry::Remove(entt::entity ent) {
+    auto it = m_tiles.find(ent);
+    if (it == m_tiles.end())
+        return;
+    for (int32_t proxy : it->second.proxies)
+        m_index.DestroyProxy(proxy);
+    for (auto&& [group, box] : it->second.boxes) {
+        auto& tiles = m_groups[group].tiles;
+        tiles.erase(std::remove(tiles.begin(), tiles.end(), ent), tiles.end());
+        m_groups[group].dirty = true;
+    }
+    m_tiles.erase(it);
+    m_dirty = true;
+}
+void StaticGeometry::Clear() {
+    for (auto&& [ent, tile] : m_tiles)
+        for (int32_t proxy : tile.proxies)
+            m_index.DestroyProxy(proxy);
+    m_tiles.clear();
+    m_groups.clear();
+    m_groupIds.clear();
+    m_bodies.clear();
+    m_dirty = false;
+}
+
+std::vector<StaticGeometry::GroupUpdate> StaticGeometry::Rebuild() {
+    std::vector<GroupUpdate> updates;
+    if (!m_dirty)
+        return updates;
+    m_dirty = false;
+
+    for (uint32_t g = 0; g < m_groups.size(); g++) {
+        auto& group = m_groups[g];
+        if (!group.dirty)
+            continue;
+        group.dirty = false;
+
+        GroupUpdate& update = updates.emplace_back();
+        update.group = g;
+        update.shard = group.shard;
+        update.def = group.def;
+        for (auto&& ent : group.tiles)
+            for (auto&& [tile_group, box] : m_tiles.at(ent).boxes)
+                if (tile_group == g)
+                    update.boxes.push_back(box);
+        merge_boxes(update.boxes);
+    }
+    return updates;
+}
+void StaticGeometry::Apply(b2World& world, const GroupUpdate& update) {
+    // Group body is replaced as a whole. It has no entity, contacts are resolved through the index.
+    uint32_t g = update.group;
+    if (m_bodies.size() <= g)
+        m_bodies.resize(g + 1, nullptr);
+    if (m_bodies[g])
+        world.DestroyBody(m_bodies[g]);
+    m_bodies[g] = nullptr;
+    if (update.boxes.empty())
+        return;
+
+    b2BodyDef body_def;
+    b2Body* body = world.CreateBody(&body_def);
+    b2PolygonShape shape;
+    b2FixtureDef fixture_def = update.def;
+    fixture_def.shape = &shape;
+    for (auto&& box : update.boxes) {
+        shape.SetAsBox(box.GetExtents().x, box.GetExtents().y, box.GetCenter(), 0.0f);
+        body->CreateFixture(&fixture_def);
+    }
+    m_bodies[g] = body;
+}
+
+void StaticGeometry::Query(const b2AABB& aabb, const std::function<bool(entt::entity)>& func) const {
+    // Proxies are fattened by the tree, so the exact boxes are checked as well.
+    struct Callback {
+        const StaticGeometry* geometry;
+        const b2AABB& aabb;
+        const std::function<bool(entt::entity)>& func;
+        bool QueryCallback(int32 proxy) {
+            entt::entity ent = Utils::to_entity(reinterpret_cast<uintptr_t>(geometry->m_index.GetUserData(proxy)));
+            auto tile = geometry->m_tiles.find(ent);
+            if (tile == geometry->m_tiles.end())
+                return true;
+            for (auto&& [group, box] : tile->second.boxes)
+                if (b2TestOverlap(box, aabb))
+                    return func(ent);
+            return true;
+        }
+    } callback{ this, aabb, func };
+    m_index.Query(&callback, aabb);
+}
+uint16_t StaticGeometry::GetCategoryBits(entt::entity ent) const {
+    uint16_t bits = 0;
+    auto it = m_tiles.find(ent);
+    if (it != m_tiles.end())
+        for (auto&& [group, box] : it->second.boxes)
+            bits |= m_groups[group].def.filter.categoryBits;
+    return bits;
+}
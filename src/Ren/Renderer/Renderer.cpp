@@ -128,6 +128,49 @@ struct LineRenderCommand {
     }
 };
 
+struct GeometryBatchRenderCommand {
+    GeometryBatch* batch;
+    int32_t layer;
+    inline int32_t GetLayer() const { return layer; }
+    void Render(SDL_Renderer* renderer) {
+        auto& out = batch->pixel_vertices;
+        out.clear();
+        out.reserve(batch->triangles.size() + batch->lines.size() * 3);
+
+        for (auto&& v : batch->triangles) {
+            glm::vec2 p = Renderer::ToPixels({ v.position.x, v.position.y });
+            out.push_back({ { p.x, p.y }, v.color, { 0.0f, 0.0f } });
+        }
+        // SDL_RenderGeometry only renders triangles, so every line is expanded to 1 pixel wide quad.
+        for (std::size_t i = 0; i + 1 < batch->lines.size(); i += 2) {
+            const auto& a = batch->lines[i];
+            const auto& b = batch->lines[i + 1];
+            glm::vec2 pa = Renderer::ToPixels(a.pos), pb = Renderer::ToPixels(b.pos);
+            glm::vec2 dir = pb - pa;
+            float len = glm::length(dir);
+            if (len < 1e-3f)
+                continue;
+            glm::vec2 n = glm::vec2(-dir.y, dir.x) * (0.5f / len);
+            SDL_Vertex q[4] = {
+                { { pa.x + n.x, pa.y + n.y }, a.color, { 0.0f, 0.0f } },
+                { { pa.x - n.x, pa.y - n.y }, a.color, { 0.0f, 0.0f } },
+                { { pb.x - n.x, pb.y - n.y }, b.color, { 0.0f, 0.0f } },
+                { { pb.x + n.x, pb.y + n.y }, b.color, { 0.0f, 0.0f } },
+            };
+            out.insert(out.end(), { q[0], q[1], q[2], q[0], q[2], q[3] });
+        }
+        if (out.empty())
+            return;
+
+        // Fills are usually translucent.
+        SDL_BlendMode old_mode;
+        SDL_GetRenderDrawBlendMode(renderer, &old_mode);
+        SDL_SetRenderDrawBlendMode(renderer, SDL_BLENDMODE_BLEND);
+        SDL_RenderGeometry(renderer, nullptr, out.data(), (int)out.size(), nullptr, 0);
+        SDL_SetRenderDrawBlendMode(renderer, old_mode);
+    }
+};
+
 #pragma endregion
 #pragma region Submission wrappers.
 
@@ -149,6 +192,10 @@ void Renderer::DrawCircle(const glm::vec2& pos, float radius, const Ren::Color4&
 void Renderer::DrawLine(const glm::vec2& p1, const glm::vec2& p2, const Ren::Color4& color) {
     SubmitCommand(LineRenderCommand{ p1, p2, color, m_activeRenderLayer });
 }
+void Renderer::DrawBatch(GeometryBatch* batch) {
+    if (batch && !batch->Empty())
+        SubmitCommand(GeometryBatchRenderCommand{ batch, m_activeRenderLayer });
+}
 
 #pragma endregion
 
@@ -0,0 +1,107 @@
+/**
+ * @file LuaAllocator.cpp
+ * @brief Implementation of pooled memory allocator for lua states.
+ */
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+
+#include "Ren/Scripting/LuaAllocator.hpp"
+
+using namespace Ren;
+
+LuaAllocator::~LuaAllocator() {
+    for (char* page : m_pages)
+        std::free(page);
+}
+
+Ref<sol::state> LuaAllocator::CreateState() {
+    LuaAllocator* allocator = new LuaAllocator();
+    // State has to be closed before its allocator is destroyed.
+    return Ref<sol::state>(new sol::state(sol::default_at_panic, &LuaAllocator::Alloc, allocator), [allocator](sol::state* lua) {
+        delete lua;
+        delete allocator;
+    });
+}
+LuaAllocator* LuaAllocator::Get(lua_State* L) {
+    void* ud = nullptr;
+    return lua_getallocf(L, &ud) == &LuaAllocator::Alloc ? static_cast<LuaAllocator*>(ud) : nullptr;
+}
+
+void* LuaAllocator::Alloc(void* ud, void* ptr, std::size_t osize, std::size_t nsize) {
+    LuaAllocator* allocator = static_cast<LuaAllocator*>(ud);
+    // When `ptr` is NULL, `osize` is the type of the new object, not a size.
+    if (!ptr)
+        osize = 0;
+
+    void* res = nullptr;
+    if (nsize == 0)
+        allocator->deallocate(ptr, osize);
+    else if (!ptr)
+        res = allocator->allocate(nsize);
+    else
+        res = allocator->reallocate(ptr, osize, nsize);
+
+    // Failed allocation keeps the old block.
+    if (res || nsize == 0) {
+        Stats& stats = allocator->m_stats;
+        stats.used = stats.used - osize + nsize;
+        stats.peak = std::max(stats.peak, stats.used);
+    }
+    return res;
+}
+
+void* LuaAllocator::allocate(std::size_t size) {
+    m_stats.allocations++;
+    if (size > MAX_POOLED)
+        return std::malloc(size);
+
+    std::size_t cls = size_class(size);
+    if (FreeBlock* block = m_free[cls]) {
+        m_free[cls] = block->next;
+        return block;
+    }
+
+    // Carve a new block from the page. Rest of the full page is too small to matter.
+    std::size_t block_size = (cls + 1) * CLASS_SIZE;
+    if (std::size_t(m_pageEnd - m_pageBegin) < block_size) {
+        char* page = static_cast<char*>(std::malloc(PAGE_SIZE));
+        if (!page)
+            return nullptr;
+        m_pages.push_back(page);
+        m_stats.pooled += PAGE_SIZE;
+        m_pageBegin = page;
+        m_pageEnd = page + PAGE_SIZE;
+    }
+    void* block = m_pageBegin;
+    m_pageBegin += block_size;
+    return block;
+}
+void LuaAllocator::deallocate(void* ptr, std::size_t size) {
+    if (!ptr)
+        return;
+    if (size > MAX_POOLED) {
+        std::free(ptr);
+        return;
+    }
+    std::size_t cls = size_class(size);
+    FreeBlock* block = static_cast<FreeBlock*>(ptr);
+    block->next = m_free[cls];
+    m_free[cls] = block;
+}
+void* LuaAllocator::reallocate(void* ptr, std::size_t osize, std::size_t nsize) {
+    if (osize > MAX_POOLED && nsize > MAX_POOLED) {
+        m_stats.allocations++;
+        return std::realloc(ptr, nsize);
+    }
+    // Block of the same size class is big enough.
+    if (osize <= MAX_POOLED && nsize <= MAX_POOLED && size_class(osize) == size_class(nsize))
+        return ptr;
+
+    void* res = allocate(nsize);
+    if (!res)
+        return nullptr;
+    std::memcpy(res, ptr, std::min(osize, nsize));
+    deallocate(ptr, osize);
+    return res;
+}
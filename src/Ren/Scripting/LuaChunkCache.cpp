@@ -0,0 +1,103 @@
+/**
+ * @file LuaChunkCache.cpp
+ * @brief Implementation of the cache of compiled Lua chunks.
+ */
+#include <fstream>
+#include <iterator>
+#include <ren_utils/logging.hpp>
+
+#include "Ren/Scripting/LuaChunkCache.hpp"
+
+using namespace Ren;
+namespace fs = std::filesystem;
+
+// Path of the precompiled file (script.lua -> script.luac).
+static fs::path luac_path(const fs::path& path) {
+    fs::path res = path;
+    res += "c";
+    return res;
+}
+
+sol::load_result LuaChunkCache::Load(sol::state_view lua, const fs::path& path) {
+    const std::string key = path.lexically_normal().string();
+    const std::string chunk_name = "@" + key;
+
+    // Use .luac, if it is up to date (or if there is no source).
+    std::error_code ec, luac_ec;
+    auto time = fs::last_write_time(path, ec);
+    const fs::path luac = luac_path(path);
+    auto luac_time = fs::last_write_time(luac, luac_ec);
+    const bool use_luac = !luac_ec && (ec || luac_time >= time);
+    if (use_luac)
+        time = luac_time;
+    // Modification time has coarse resolution on some file systems (and it can be preserved by copying), so a file
+    // rewritten right after it was loaded could keep it. Size of the file catches most of such changes.
+    std::error_code size_ec;
+    const std::uintmax_t size = fs::file_size(use_luac ? luac : path, size_ec);
+
+    {
+        std::lock_guard<std::mutex> lock(ms_mutex);
+        auto it = ms_entries.find(key);
+        if (it != ms_entries.end() && it->second.time == time && it->second.size == size && !size_ec)
+            return lua.load(it->second.bytecode, chunk_name, sol::load_mode::binary);
+    }
+
+    std::string bytecode;
+    if (use_luac) {
+        std::ifstream file(luac, std::ios::binary);
+        bytecode.assign(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+        sol::load_result chunk = lua.load(bytecode, chunk_name, sol::load_mode::binary);
+        if (!chunk.valid())
+            return chunk;
+        std::lock_guard<std::mutex> lock(ms_mutex);
+        ms_entries[key] = { time, size, std::move(bytecode) };
+        return chunk;
+    }
+
+    sol::load_result chunk = lua.load_file(key, sol::load_mode::text);
+    if (!chunk.valid())
+        return chunk;
+    bytecode = std::string(chunk.get<sol::protected_function>().dump().as_string_view());
+    std::lock_guard<std::mutex> lock(ms_mutex);
+    ms_entries[key] = { time, size, std::move(bytecode) };
+    return chunk;
+}
+
+bool LuaChunkCache::Precompile(const fs::path& path) {
+    // Compiling doesn't need any libraries, so use an empty state.
+    sol::state lua;
+    sol::load_result chunk = lua.load_file(path.string(), sol::load_mode::text);
+    if (!chunk.valid()) {
+        sol::error err = chunk;
+        LOG_E("Failed to precompile '" + path.string() + "': " + err.what());
+        return false;
+    }
+    auto bytecode = chunk.get<sol::protected_function>().dump();
+    std::ofstream file(luac_path(path), std::ios::binary | std::ios::trunc);
+    auto data = bytecode.as_string_view();
+    file.write(data.data(), std::streamsize(data.size()));
+    if (!file) {
+        LOG_E("Failed to write '" + luac_path(path).string() + "'.");
+        return false;
+    }
+    return true;
+}
+
+std::size_t LuaChunkCache::PrecompileDir(const fs::path& dir) {
+    std::size_t count = 0;
+    std::error_code ec;
+    for (auto&& entry : fs::recursive_directory_iterator(dir, ec))
+        if (entry.is_regular_file() && entry.path().extension() == ".lua" && Precompile(entry.path()))
+            count++;
+    return count;
+}
+
+void LuaChunkCache::Clear() {
+    std::lock_guard<std::mutex> lock(ms_mutex);
+    ms_entries.clear();
+}
+
+std::size_t LuaChunkCache::Size() {
+    std::lock_guard<std::mutex> lock(ms_mutex);
+    return ms_entries.size();
+}
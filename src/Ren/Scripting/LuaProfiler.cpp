@@ -0,0 +1,143 @@
+/**
+ * @file LuaProfiler.cpp
+ * @brief Implementation of sampling profiler and instruction limits of lua states.
+ */
+#include <algorithm>
+#include <cstdio>
+#include <fstream>
+#include <tuple>
+#include <vector>
+
+#include "Ren/Scripting/LuaProfiler.hpp"
+
+using namespace Ren;
+
+// Address is the key of the profiler in the registry of its lua state.
+static const char s_registryKey = 0;
+
+void LuaProfiler::Report::Merge(const Report& other) {
+    auto merge = [](auto& into, const auto& from) {
+        for (auto&& [key, entry] : from) {
+            Entry& e = into[key];
+            e.ms += entry.ms;
+            e.count += entry.count;
+        }
+    };
+    merge(functions, other.functions);
+    merge(scripts, other.scripts);
+    merge(entities, other.entities);
+}
+bool LuaProfiler::Report::Export(const std::filesystem::path& path) const {
+    std::ofstream file(path);
+    if (!file)
+        return false;
+
+    std::vector<std::tuple<const char*, std::string, Entry>> rows;
+    for (auto&& [name, entry] : functions)
+        rows.emplace_back("function", name, entry);
+    for (auto&& [name, entry] : scripts)
+        rows.emplace_back("script", name, entry);
+    for (auto&& [ent, entry] : entities)
+        rows.emplace_back("entity", std::to_string(entt::to_integral(ent)), entry);
+    std::sort(rows.begin(), rows.end(), [](const auto& a, const auto& b) { return std::get<2>(a).ms > std::get<2>(b).ms; });
+
+    file << "kind,name,ms,count\n";
+    for (auto&& [kind, name, entry] : rows)
+        file << kind << ",\"" << name << "\"," << entry.ms << "," << entry.count << "\n";
+    return bool(file);
+}
+
+LuaProfiler::LuaProfiler(lua_State* L)
+    : m_L(L)
+{
+    lua_pushlightuserdata(m_L, this);
+    lua_rawsetp(m_L, LUA_REGISTRYINDEX, &s_registryKey);
+}
+LuaProfiler::~LuaProfiler() {
+    lua_sethook(m_L, nullptr, 0, 0);
+    lua_pushnil(m_L);
+    lua_rawsetp(m_L, LUA_REGISTRYINDEX, &s_registryKey);
+}
+
+void LuaProfiler::SetSampling(bool sampling, uint32_t instructions) {
+    m_sampling = sampling;
+    m_sampleInstructions = std::max<uint32_t>(instructions, 1);
+    m_lastSample = Clock::now();
+    updateHook();
+}
+
+void LuaProfiler::BeginCall(uint32_t instruction_limit) {
+    m_lastSample = Clock::now();
+    m_executed = 0;
+    // Setting the hook also restarts its count, which is needed for a precise limit.
+    if (instruction_limit > 0 || m_limit > 0) {
+        m_limit = instruction_limit;
+        updateHook();
+    }
+}
+void LuaProfiler::EndCall() {
+    if (m_limit > 0) {
+        m_limit = 0;
+        updateHook();
+    }
+}
+bool LuaProfiler::PrepareThread(lua_State* co, uint32_t instruction_limit) {
+    bool started = m_limit == 0 && instruction_limit > 0;
+    if (started)
+        BeginCall(instruction_limit);
+    // Setting the hook also restarts its count, so the instructions the coroutine ran before are not counted.
+    lua_sethook(co, lua_gethook(m_L), lua_gethookmask(m_L), lua_gethookcount(m_L));
+    return started;
+}
+void LuaProfiler::AddScriptCall(const std::string& script, entt::entity ent, double ms) {
+    Entry& s = m_report.scripts[script];
+    s.ms += ms;
+    s.count++;
+    Entry& e = m_report.entities[ent];
+    e.ms += ms;
+    e.count++;
+}
+
+LuaProfiler* LuaProfiler::Get(lua_State* L) {
+    // Registry is shared by all coroutines of the state.
+    lua_rawgetp(L, LUA_REGISTRYINDEX, &s_registryKey);
+    LuaProfiler* profiler = static_cast<LuaProfiler*>(lua_touserdata(L, -1));
+    lua_pop(L, 1);
+    return profiler;
+}
+
+void LuaProfiler::updateHook() {
+    uint32_t count = m_sampling ? m_sampleInstructions : 0;
+    if (m_limit > 0)
+        count = count > 0 ? std::min(count, m_limit) : m_limit;
+    if (count > 0)
+        lua_sethook(m_L, &LuaProfiler::hook, LUA_MASKCOUNT, int(count));
+    else
+        lua_sethook(m_L, nullptr, 0, 0);
+}
+
+void LuaProfiler::hook(lua_State* L, lua_Debug* ar) {
+    LuaProfiler* profiler = Get(L);
+    if (!profiler)
+        return;
+
+    // Check the limit first, lua_error() doesn't return.
+    if (profiler->m_limit > 0) {
+        profiler->m_executed += uint64_t(lua_gethookcount(L));
+        if (profiler->m_executed >= profiler->m_limit)
+            luaL_error(L, "instruction budget of %d exceeded", int(profiler->m_limit));
+    }
+    if (!profiler->m_sampling)
+        return;
+
+    Clock::time_point now = Clock::now();
+    double ms = std::chrono::duration<double, std::milli>(now - profiler->m_lastSample).count();
+    profiler->m_lastSample = now;
+
+    char key[LUA_IDSIZE + 128];
+    lua_getinfo(L, "Sn", ar);
+    std::snprintf(key, sizeof(key), "%s:%d %s", ar->short_src, ar->linedefined, ar->name ? ar->name : "?");
+    Entry& entry = profiler->m_report.functions[key];
+    entry.ms += ms;
+    entry.count++;
+}
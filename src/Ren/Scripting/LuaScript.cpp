@@ -3,10 +3,15 @@
  * @brief Implementation of LuaScript
  */
 #include <exception>
+#include <mutex>
 #include <stdexcept>
+#include <tuple>
+#include <vector>
 #include <ren_utils/logging.hpp>
 
 #include "Ren/Scripting/LuaScript.hpp"
+#include "Ren/Scripting/LuaVector.hpp"
+#include "Ren/Scripting/LuaChunkCache.hpp"
 #include "Ren/Core/Core.hpp"
 #include "Ren/Core/AssetManager.hpp"
 #include "Ren/ECS/Components.hpp"
@@ -21,6 +26,9 @@ struct LuaInterface {
     static bool KeyHeld(KeyInterface* p_input, int key) {    return p_input->KeyHeld(Key(key)); }
     static void Log(int level, std::string message, std::string file, int line)
     {
+        // Scripts may log from several threads (see LuaScriptSystem::SetParallel()).
+        static std::mutex mutex;
+        std::lock_guard<std::mutex> lock(mutex);
         // TODO: Maybe somehow tag that this is from LUA?
         if (level >= 0 && level <= 4)
             ren_utils::LogEmitter::Log(ren_utils::LogLevel(level), message, file, line);
@@ -34,27 +42,38 @@ public:
     const char* what() const noexcept override { return type_name.c_str(); }
 };
 
-LuaScript::LuaScript(std::string name, sol::state* lua_state, std::filesystem::path script_path)
+// Run the file loaded through LuaChunkCache. Errors are thrown as sol::error (same as sol::state::script_file()).
+static void run_file(sol::state& lua, const std::filesystem::path& path, const sol::environment* env = nullptr) {
+    sol::load_result chunk = LuaChunkCache::Load(lua, path);
+    if (!chunk.valid()) {
+        sol::error err = chunk;
+        throw err;
+    }
+    sol::protected_function func = chunk;
+    if (env)
+        sol::set_environment(*env, func);
+    sol::protected_function_result result = func();
+    if (!result.valid()) {
+        sol::error err = result;
+        throw err;
+    }
+}
+
+LuaScript::LuaScript(std::string name, std::filesystem::path script_path)
     : NAME(name)
-    , m_lua(lua_state)
     , m_scriptPath(script_path)
 {}
 
 void LuaScript::init() {
-    REN_ASSERT(m_input != nullptr, "Did you call this from LuaScriptSystem::InitScript?");
+    REN_ASSERT(m_input != nullptr && m_lua != nullptr && m_env.valid(), "Did you call this from LuaScriptSystem::InitScript?");
     REN_ASSERT(m_entity.id != Entity{}.id, "Entity must be set.");
 
-    // Check if this is first init on this component.
-    auto lua_int_set = (*m_lua)["_lua_int_set"];
-    if (!lua_int_set.valid())
-        first_init();
-
     // Check if table already exists.
-    auto table_check = (*m_lua)[NAME];
+    auto table_check = m_env.raw_get<sol::object>(NAME);
     REN_ASSERT(!table_check.valid(), "LuaScript with given name is already bound to this entity.");
 
-    // Create metatable instance for this script.
-    (*m_lua)[NAME] = m_lua->create_table_with(
+    // Create metatable instance for this script. It lives in the environment of the entity.
+    m_instance = m_lua->create_table_with(
             "host", this,
             PARAM, m_lua->create_table_with(),
             "API_RegParam", [this](const std::string& name){
@@ -63,136 +82,352 @@ void LuaScript::init() {
                         return;
                     m_Parameters.push_back(LuaParam(this, name));
                 } catch (const UnsupportedTypeException& e) {
-                    LOG_W("Script '" + NAME + "' has a parameter '" + name + "' of unsupported type '" + e.what() + "'. Supported types are number, string and boolean.");
+                    LOG_W("Script '" + NAME + "' has a parameter '" + name + "' of unsupported type '" + e.what() + "'. Supported types are number, string, boolean, Vec2, Vec3 and Color.");
                     return;
                 }
             });
+    m_env[NAME] = m_instance;
+    // Methods shared by all instances (StartCoroutine(), ...) and instruction budget of its coroutines. Defined in scheduler.lua
+    (*m_lua)["C_SetupInstance"](m_instance, m_budget.instructions);
 
     // Setup NAME.PARAM array to automatically inform C++ about new parameters. Defined in core.lua
-    (*m_lua)["C_SetupParam"](NAME, PARAM);
+    (*m_lua)["C_SetupParam"](m_instance, PARAM);
 
-    // Execute script file provided.
-    m_lua->script_file(AssetManager::GetScript(m_scriptPath).string());
+    // Execute script file provided. Its globals end up in the environment of the entity.
+    // The file is compiled only once, other instances load the cached bytecode.
+    run_file(*m_lua, AssetManager::GetScript(m_scriptPath), &m_env);
+
+    // Resolve methods once, so that they are not looked up by name on every call.
+    auto method = [this](const std::string& name) {
+        sol::object obj = m_instance[name];
+        return obj.is<sol::function>() ? obj.as<sol::protected_function>() : sol::protected_function{};
+    };
+    m_onInit = method(ON_INIT);
+    m_onDestroy = method(ON_DESTROY);
+    m_onUpdate = method(ON_UPDATE);
+    m_onFixedUpdate = method(ON_FIXED_UPDATE);
+    m_onContactBegin = method(ON_CONTACT_BEGIN);
+    m_onContactEnd = method(ON_CONTACT_END);
 
     // Set default values for parameters
-    for (auto i : m_Parameters)
-        i.setFromData();
+    sol::table params = m_instance[PARAM];
+    for (auto& param : m_Parameters)
+        param.bind(params);
 }
 
-void LuaScript::first_init() {
-    m_lua->set("_lua_int_set", true);
+void LuaScript::register_bindings(sol::state& lua, KeyInterface* input) {
+    // Load standard libraries for basic functionality.
+    lua.open_libraries();
 
-    // Set functions provided for all scripts on this component.
+    // Set functions provided for all scripts of the scene.
     // FIXME: Should we implement custom KeyInterface and only update it when key is pressed?
-    m_lua->set("REN_INPUT", m_input);
-    m_lua->set_function("API_KeyPressed", LuaInterface::KeyPressed);
-    m_lua->set_function("API_KeyHeld", LuaInterface::KeyHeld);
-    m_lua->set_function("API_Log", LuaInterface::Log);
+    lua.set("REN_INPUT", input);
+    lua.set_function("API_KeyPressed", LuaInterface::KeyPressed);
+    lua.set_function("API_KeyHeld", LuaInterface::KeyHeld);
+    lua.set_function("API_Log", LuaInterface::Log);
+    // Used by require() to load modules through LuaChunkCache (see core.lua).
+    lua.set_function("API_LoadChunk", [](const std::string& path, sol::this_state s) {
+        sol::state_view lua(s);
+        sol::load_result chunk = LuaChunkCache::Load(lua, path);
+        if (!chunk.valid()) {
+            sol::error err = chunk;
+            return sol::make_object(lua, std::string(err.what()));
+        }
+        return sol::make_object(lua, chunk.get<sol::protected_function>());
+    });
+    // Used by the scheduler to apply the hook of LuaProfiler to coroutines it resumes (see scheduler.lua).
+    lua.set_function("API_PrepareCoroutine", [](sol::thread co, uint32_t instructions, sol::this_state s) {
+        LuaProfiler* profiler = LuaProfiler::Get(s);
+        return profiler ? profiler->PrepareThread(co.thread_state(), instructions) : false;
+    });
+    lua.set_function("API_FinishCoroutine", [](sol::this_state s) {
+        if (LuaProfiler* profiler = LuaProfiler::Get(s))
+            profiler->EndCall();
+    });
 
     // Create transform component type.
-    auto lua_vec2 = m_lua->new_usertype<glm::vec2>("glmvec2", sol::constructors<glm::vec2(), glm::vec2(float), glm::vec2(float, float)>(),
-            "x", &glm::vec2::x,
-            "y", &glm::vec2::y,
-            "size", sol::property(&glm::vec2::length));
-    auto lua_ivec2 = m_lua->new_usertype<glm::ivec2>("glmivec2", sol::constructors<glm::ivec2(), glm::ivec2(int), glm::ivec2(int, int)>(),
+    // Vector members of the components are returned as references (views), so the in-place methods
+    // (set, add, mul) modify the component without creating new objects.
+    LuaVector::Register(lua);
+    auto lua_ivec2 = lua.new_usertype<glm::ivec2>("glmivec2", sol::constructors<glm::ivec2(), glm::ivec2(int), glm::ivec2(int, int)>(),
             "x", &glm::ivec2::x,
             "y", &glm::ivec2::y,
-            "size", sol::property(&glm::ivec2::length));
-    auto lua_tr = m_lua->new_usertype<TransformComponent>("TransformComponent", sol::constructors<TransformComponent()>(),
+            "size", sol::property(&glm::ivec2::length),
+            "set", [](glm::ivec2& v, int x, int y) { v = { x, y }; });
+    // Color in range 0-255 (for ex. Sprite color or script parameter).
+    auto lua_color = lua.new_usertype<glm::ivec3>("Color", sol::constructors<glm::ivec3(), glm::ivec3(int), glm::ivec3(int, int, int)>(),
+            "r", sol::property([](const glm::ivec3& c) { return c.x; }, [](glm::ivec3& c, int v) { c.x = v; }),
+            "g", sol::property([](const glm::ivec3& c) { return c.y; }, [](glm::ivec3& c, int v) { c.y = v; }),
+            "b", sol::property([](const glm::ivec3& c) { return c.z; }, [](glm::ivec3& c, int v) { c.z = v; }));
+    // Get* and Set* methods pass the components as numbers, so that reading or writing a vector doesn't allocate anything.
+    auto lua_tr = lua.new_usertype<TransformComponent>("TransformComponent", sol::constructors<TransformComponent()>(),
             "position", &Ren::TransformComponent::position,
             "scale", &Ren::TransformComponent::scale,
             "rotation", &Ren::TransformComponent::rotation,
             "layer", &Ren::TransformComponent::layer,
-            "dirty", &Ren::TransformComponent::dirty);
-    auto lua_sc = m_lua->new_usertype<SpriteComponent>("SpriteComponent", sol::constructors<SpriteComponent()>(),
+            "GetPosition", [](const TransformComponent& t) { return std::make_tuple(t.position.x, t.position.y); },
+            "SetPosition", [](TransformComponent& t, float x, float y) { t.position = { x, y }; },
+            "Move", [](TransformComponent& t, float dx, float dy) { t.position += glm::vec2(dx, dy); },
+            "GetScale", [](const TransformComponent& t) { return std::make_tuple(t.scale.x, t.scale.y); },
+            "SetScale", [](TransformComponent& t, float x, float y) { t.scale = { x, y }; });
+    auto lua_sc = lua.new_usertype<SpriteComponent>("SpriteComponent", sol::constructors<SpriteComponent()>(),
             "color", &SpriteComponent::m_Color,
-            "ppu", &SpriteComponent::m_PixelsPerUnit);
+            "ppu", &SpriteComponent::m_PixelsPerUnit,
+            "GetColor", [](const SpriteComponent& s) { return std::make_tuple(s.m_Color.r, s.m_Color.g, s.m_Color.b); },
+            "SetColor", [](SpriteComponent& s, int r, int g, int b) { s.m_Color = { r, g, b }; },
+            "GetPPU", [](const SpriteComponent& s) { return std::make_tuple(s.m_PixelsPerUnit.x, s.m_PixelsPerUnit.y); },
+            "SetPPU", [](SpriteComponent& s, int x, int y) { s.m_PixelsPerUnit = { x, y }; });
 
-    m_lua->set("LUA_PATH", "?;?.lua;"
+    lua.set("LUA_PATH", "?;?.lua;"
             + AssetManager::GetLuaCoreDir().string() + "/?.lua;"
             + AssetManager::GetLuaCoreDir().string() + "/?;"
             + AssetManager::GetScriptDir().string() + "/?.lua;"
             + AssetManager::GetScriptDir().string() + "/?;");
 
+    run_file(lua, AssetManager::GetLuaCore("core.lua"));
+}
+
+sol::environment LuaScript::create_environment(sol::state& lua, Entity ent) {
+    // Globals of the state are visible, new globals stay in the environment.
+    sol::environment env(lua, sol::create, lua.globals());
+
     // Create component references in lua
-    (*m_lua)["Components"] = m_lua->create_table_with(
-        "Transform", std::ref(m_entity.Get<TransformComponent>()),
-        "Sprite", std::ref(m_entity.Get<SpriteComponent>())
+    env["Components"] = lua.create_table_with(
+        "Transform", std::ref(ent.Get<TransformComponent>()),
+        "Sprite", std::ref(ent.Get<SpriteComponent>())
     );
 
-    m_lua->script_file(AssetManager::GetLuaCore("core.lua").string());
+    // Collision layers of the entity's fixtures. Layers are referenced by their names (see Scene::m_CollisionLayers)
+    // and fixtures by their index starting at 1 (nil means all fixtures).
+    env["Physics"] = lua.create_table_with(
+        // Changes of the layers are deferred in parallel updates (see LuaScriptSystem::Defer()).
+        "SetLayer", [ent](const std::string& name, sol::optional<int> fixture) {
+            ent.p_scene->GetSystem<LuaScriptSystem>()->Defer([ent, name, fixture = fixture ? *fixture - 1 : -1]() mutable {
+                auto physics = ent.p_scene->GetSystem<PhysicsSystem>();
+                int32_t layer = ent.p_scene->m_CollisionLayers.Find(name);
+                if (!physics || !ent.HasAll<RigidBodyComponent>() || layer < 0) {
+                    LOG_W("Can't set collision layer '" + name + "'.");
+                    return;
+                }
+                physics->SetFixtureLayer(ent, fixture, layer);
+            });
+        },
+        // Move the entity together with its body. Deferred in parallel updates, the transform changes after all scripts
+        // are updated then.
+        "Teleport", [ent](float x, float y) {
+            ent.p_scene->GetSystem<LuaScriptSystem>()->Defer([ent, pos = glm::vec2(x, y)]() {
+                if (auto physics = ent.p_scene->GetSystem<PhysicsSystem>())
+                    physics->Teleport(ent.id, pos);
+                else
+                    ent.p_scene->m_Registry->patch<TransformComponent>(ent.id, [&pos](TransformComponent& trans) { trans.position = pos; });
+            });
+        },
+        "GetLayer", [ent](sol::optional<int> fixture) mutable -> std::string {
+            if (!ent.HasAll<RigidBodyComponent>())
+                return "";
+            auto& fixtures = ent.Get<RigidBodyComponent>().fixtures;
+            std::size_t index = fixture ? std::size_t(*fixture - 1) : 0;
+            if (index >= fixtures.size() || fixtures[index].layer < 0)
+                return "";
+            return ent.p_scene->m_CollisionLayers.GetName(fixtures[index].layer);
+        },
+        "SetLayersCollide", [ent](const std::string& a, const std::string& b, bool collide) {
+            ent.p_scene->GetSystem<LuaScriptSystem>()->Defer([ent, a, b, collide]() {
+                auto& layers = ent.p_scene->m_CollisionLayers;
+                int32_t la = layers.Find(a), lb = layers.Find(b);
+                if (la < 0 || lb < 0) {
+                    LOG_W("Unknown collision layer '" + (la < 0 ? a : b) + "'.");
+                    return;
+                }
+                layers.SetCollides(la, lb, collide);
+                if (auto physics = ent.p_scene->GetSystem<PhysicsSystem>())
+                    physics->ApplyCollisionLayers();
+            });
+        },
+        // Mask of the named layers for the queries below.
+        "Mask", [ent](sol::variadic_args names) {
+            int mask = 0;
+            for (std::string name : names)
+                if (int32_t layer = ent.p_scene->m_CollisionLayers.Find(name); layer >= 0)
+                    mask |= 1 << layer;
+            return mask;
+        },
+        // Queries are passed in one flat array and the results are returned the same way, so that there is a single
+        // call per batch. Entity of the script is ignored by the queries.
+        // Rays are { x1, y1, x2, y2, ... }. Returns entities (-1, if nothing was hit) and fractions of the rays
+        // at the hits (1, if nothing was hit).
+        "RaycastBatch", [ent](sol::table rays, sol::optional<int> mask) {
+            std::vector<RaycastQuery> queries(rays.size() / 4);
+            for (std::size_t i = 0; i < queries.size(); i++) {
+                auto& query = queries[i];
+                query.from = { rays.raw_get<float>(i * 4 + 1), rays.raw_get<float>(i * 4 + 2) };
+                query.to = { rays.raw_get<float>(i * 4 + 3), rays.raw_get<float>(i * 4 + 4) };
+                query.mask = uint16_t(mask.value_or(0xFFFF));
+                query.ignore = ent.id;
+            }
+            std::vector<RaycastHit> hits(queries.size());
+            if (auto physics = ent.p_scene->GetSystem<PhysicsSystem>())
+                physics->RaycastBatch(queries.data(), queries.size(), hits.data());
+
+            std::vector<int64_t> entities(hits.size());
+            std::vector<float> fractions(hits.size());
+            for (std::size_t i = 0; i < hits.size(); i++) {
+                entities[i] = (hits[i].hit && hits[i].ent != entt::null) ? int64_t(entt::to_integral(hits[i].ent)) : -1;
+                fractions[i] = hits[i].hit ? hits[i].fraction : 1.0f;
+            }
+            return std::make_tuple(sol::as_table(std::move(entities)), sol::as_table(std::move(fractions)));
+        },
+        // Boxes are { min_x, min_y, max_x, max_y, ... }. Returns number of entities found by each box (at most
+        // `max_results`) and the found entities of all boxes one after another.
+        "OverlapBatch", [ent](sol::table boxes, int max_results, sol::optional<int> mask) {
+            std::vector<OverlapQuery> queries(boxes.size() / 4);
+            for (std::size_t i = 0; i < queries.size(); i++) {
+                auto& query = queries[i];
+                query.aabb.lowerBound = { boxes.raw_get<float>(i * 4 + 1), boxes.raw_get<float>(i * 4 + 2) };
+                query.aabb.upperBound = { boxes.raw_get<float>(i * 4 + 3), boxes.raw_get<float>(i * 4 + 4) };
+                query.mask = uint16_t(mask.value_or(0xFFFF));
+                query.ignore = ent.id;
+            }
+            std::size_t max = std::size_t(std::max(max_results, 0));
+            std::vector<entt::entity> results(queries.size() * max);
+            std::vector<uint32_t> counts(queries.size(), 0);
+            if (auto physics = ent.p_scene->GetSystem<PhysicsSystem>())
+                physics->OverlapBatch(queries.data(), queries.size(), results.data(), max, counts.data());
+
+            std::vector<int64_t> entities;
+            for (std::size_t i = 0; i < queries.size(); i++)
+                for (uint32_t j = 0; j < counts[i]; j++)
+                    entities.push_back(int64_t(entt::to_integral(results[i * max + j])));
+            return std::make_tuple(sol::as_table(std::move(counts)), sol::as_table(std::move(entities)));
+        }
+    );
+
+    // Transform and Sprite wrappers of the entity. Defined in ecs.lua
+    lua["C_SetupEntity"](env, entt::to_integral(ent.id));
+    return env;
 }
 
 void LuaScript::destroy() {
-    // For now there is nothing to do.
-    // There we could free up any resources and stuff that we created in LuaScript::init()
+    // Coroutines of the script must not be resumed anymore (see scheduler.lua).
+    if (m_instance.valid())
+        m_instance["StopCoroutines"](m_instance);
+    // Remove the instance table, so that the environment doesn't keep it alive.
+    if (m_env.valid())
+        m_env[NAME] = sol::lua_nil;
+    m_onInit = m_onDestroy = m_onUpdate = m_onFixedUpdate = m_onContactBegin = m_onContactEnd = sol::protected_function{};
+    m_instance = sol::table{};
+    for (auto& param : m_Parameters)
+        param.m_table = sol::table{};
 }
 
-// Call "method" on metatable named 'instance_name'.
+// Call cached method of the instance table. Errors are logged, so that a failing script doesn't stop the others.
 template<typename... Args>
-inline void lua_method(sol::state* lua, const std::string& instance_name, const std::string& method_name, Args... args) {
-    sol::table t = (*lua)[instance_name];
-    auto method = t[method_name];
-    if (method.valid())
-        method.call(t, args...);
+inline void lua_method(const std::string& instance_name, const sol::protected_function& method, const sol::table& instance, Args... args) {
+    if (!method.valid())
+        return;
+    sol::protected_function_result result = method(instance, args...);
+    if (!result.valid()) {
+        sol::error err = result;
+        LOG_E("Script '" + instance_name + "': " + err.what());
+    }
 }
 
-void LuaScript::OnInit() {           lua_method(m_lua, NAME, ON_INIT); }
-void LuaScript::OnDestroy() {        lua_method(m_lua, NAME, ON_DESTROY); }
-void LuaScript::OnUpdate(float dt) { lua_method(m_lua, NAME, ON_UPDATE, dt); }
+void LuaScript::OnInit() {           lua_method(NAME, m_onInit, m_instance); }
+void LuaScript::OnDestroy() {        lua_method(NAME, m_onDestroy, m_instance); }
+void LuaScript::OnUpdate(float dt) { lua_method(NAME, m_onUpdate, m_instance, dt); }
+void LuaScript::OnFixedUpdate(float dt) { lua_method(NAME, m_onFixedUpdate, m_instance, dt); }
+void LuaScript::OnContactBegin(entt::entity other) { lua_method(NAME, m_onContactBegin, m_instance, entt::to_integral(other)); }
+void LuaScript::OnContactEnd(entt::entity other) {   lua_method(NAME, m_onContactEnd, m_instance, entt::to_integral(other)); }
 
 LuaParam::LuaParam(LuaScript* p_script, const std::string& name)
     : m_Name(name)
     , m_Script(p_script)
+    , m_table(p_script->m_instance[p_script->PARAM])
 {
-    std::string s = "_lua_temp = type(" + m_Script->NAME + "." + m_Script->PARAM + "." + name + ")";
-    m_Script->m_lua->script(s);
-    std::string type = m_Script->m_lua->get<std::string>("_lua_temp");
+    sol::object value = m_table.raw_get<sol::object>(name);
 
     // Parse the type info enumartion value.
-    if (type == "number") {
-        m_Type = LuaParamType::number;
-        Get<float>();
-    }
-    else if (type == "string") {
-        m_Type = LuaParamType::string;
-        Get<std::string>();
+    switch (value.get_type()) {
+        case sol::type::number:  m_Type = LuaParamType::number; break;
+        case sol::type::string:  m_Type = LuaParamType::string; break;
+        case sol::type::boolean: m_Type = LuaParamType::boolean; break;
+        case sol::type::userdata:
+            if (value.is<glm::vec2>())
+                m_Type = LuaParamType::vec2;
+            else if (value.is<glm::vec3>())
+                m_Type = LuaParamType::vec3;
+            else if (value.is<glm::ivec3>())
+                m_Type = LuaParamType::color;
+            else
+                throw UnsupportedTypeException("userdata");
+            break;
+        default:
+            throw UnsupportedTypeException(sol::type_name(value.lua_state(), value.get_type()));
     }
-    else if (type == "boolean") {
-        m_Type = LuaParamType::boolean;
-        Get<bool>();
-    }
-    else
-        throw UnsupportedTypeException(type);
+    read();
 }
 
-void LuaParam::setFromData() {
-    if (!m_cachedData)
-        return;
+LuaParam::LuaParam(LuaScript* p_script, const std::string& name, LuaParamValue value)
+    : m_Name(name)
+    , m_Type(LuaParamType(value.index()))
+    , m_Script(p_script)
+    , m_value(value)
+    , m_initValue(std::move(value))
+{}
+
+void LuaParam::bind(const sol::table& table) {
+    m_table = table;
+    if (m_initValue)
+        SetValue(*m_initValue);
+}
 
+void LuaParam::read() {
+    if (!m_table.valid())
+        return;
     switch (m_Type) {
-        case LuaParamType::number: Set(std::any_cast<float>(*m_cachedData)); break;
-        case LuaParamType::string: Set(std::any_cast<std::string>(*m_cachedData)); break;
-        case LuaParamType::boolean: Set(std::any_cast<bool>(*m_cachedData)); break;
+        case LuaParamType::number:  m_value = m_table.get<float>(m_Name); break;
+        case LuaParamType::string:  m_value = m_table.get<std::string>(m_Name); break;
+        case LuaParamType::boolean: m_value = m_table.get<bool>(m_Name); break;
+        case LuaParamType::vec2:    m_value = m_table.get<glm::vec2>(m_Name); break;
+        case LuaParamType::vec3:    m_value = m_table.get<glm::vec3>(m_Name); break;
+        case LuaParamType::color:   m_value = m_table.get<glm::ivec3>(m_Name); break;
     }
 }
 
 template<typename T> T LuaParam::Get() {
-    T val = (*m_Script->m_lua)[m_Script->NAME][m_Script->PARAM][m_Name];
-    m_data = val;
-    return val;
+    if (m_table.valid())
+        m_value = m_table.get<T>(m_Name);
+    return std::get<T>(m_value);
 }
 
 template<typename T> void LuaParam::Set(T val) {
-    (*m_Script->m_lua)[m_Script->NAME][m_Script->PARAM][m_Name] = val;
+    m_value = val;
+    if (m_table.valid())
+        m_table[m_Name] = val;
 }
 
 template<> int LuaParam::Get<int>() { return (int)Get<float>(); }
 template float LuaParam::Get<float>();
 template std::string LuaParam::Get<std::string>();
 template bool LuaParam::Get<bool>();
+template glm::vec2 LuaParam::Get<glm::vec2>();
+template glm::vec3 LuaParam::Get<glm::vec3>();
+template glm::ivec3 LuaParam::Get<glm::ivec3>();
 template<> void LuaParam::Set<int>(int v) { Set((float)v); }
 template void LuaParam::Set<float>(float);
 template void LuaParam::Set<std::string>(std::string);
 template<> void LuaParam::Set<const char*>(const char* value) { Set(std::string(value)); }
 template void LuaParam::Set<bool>(bool);
+template void LuaParam::Set<glm::vec2>(glm::vec2);
+template void LuaParam::Set<glm::vec3>(glm::vec3);
+template void LuaParam::Set<glm::ivec3>(glm::ivec3);
+
+LuaParamValue LuaParam::GetValue() {
+    read();
+    return m_value;
+}
+
+void LuaParam::SetValue(const LuaParamValue& value) {
+    REN_ASSERT(value.index() == std::size_t(m_Type), "Value of LuaParam '" + m_Name + "' has wrong type.");
+    std::visit([this](const auto& v) { Set(v); }, value);
+}
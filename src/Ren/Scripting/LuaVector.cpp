@@ -0,0 +1,188 @@
+/**
+ * @file LuaVector.cpp
+ * @brief Implementation of native vector types for Lua.
+ */
+#include <algorithm>
+#include <cstdio>
+#include <string>
+#include <glm/glm.hpp>
+
+#include "Ren/Scripting/LuaVector.hpp"
+
+using namespace Ren;
+
+template<int N>
+using vec = glm::vec<N, float, glm::defaultp>;
+
+// Vector `i` (starting at 0) of the flat array.
+template<int N>
+static vec<N> read_vec(const sol::table& t, std::size_t i) {
+    vec<N> v;
+    for (int c = 0; c < N; c++)
+        v[c] = t.raw_get<float>(i * N + c + 1);
+    return v;
+}
+template<int N>
+static void write_vec(sol::table& t, std::size_t i, const vec<N>& v) {
+    for (int c = 0; c < N; c++)
+        t.raw_set(i * N + c + 1, v[c]);
+}
+
+// Vector from a table vector (VecGen, Vec4, ...) with x, y, z fields or from an array { x, y, z }. Missing components are 0.
+template<int N>
+static vec<N> from_table(const sol::table& t) {
+    static const char* names[] = { "x", "y", "z" };
+    vec<N> v;
+    for (int c = 0; c < N; c++) {
+        sol::optional<float> value = t.raw_get<sol::optional<float>>(names[c]);
+        if (!value)
+            value = t.raw_get<sol::optional<float>>(c + 1);
+        v[c] = value.value_or(0.0f);
+    }
+    return v;
+}
+
+template<int N>
+static std::string to_string(const vec<N>& v) {
+    std::string res = "(";
+    char buf[32];
+    for (int c = 0; c < N; c++) {
+        std::snprintf(buf, sizeof(buf), "%g", v[c]);
+        res += buf;
+        if (c != N - 1)
+            res += ", ";
+    }
+    return res + ")";
+}
+
+template<int N, typename Constructors>
+static void register_vec(sol::state& lua, const char* name, Constructors constructors) {
+    using V = vec<N>;
+    auto type = lua.new_usertype<V>(name, constructors);
+    type["x"] = &V::x;
+    type["y"] = &V::y;
+    if constexpr (N >= 3)
+        type["z"] = &V::z;
+    // Number of components (used by the generic functions of vector.lua).
+    type["size"] = sol::property([](const V&) { return N; });
+
+    // Components by index (v[1], v[2], ...) like the array vectors. Other unknown keys read as nil and can't be written.
+    type[sol::meta_function::index] = [](const V& a, sol::stack_object key, sol::this_state s) {
+        sol::optional<int> i = key.as<sol::optional<int>>();
+        if (i && *i >= 1 && *i <= N)
+            return sol::make_object(s, a[*i - 1]);
+        return sol::make_object(s, sol::lua_nil);
+    };
+    type[sol::meta_function::new_index] = [](V& a, sol::stack_object key, float value) {
+        sol::optional<int> i = key.as<sol::optional<int>>();
+        if (i && *i >= 1 && *i <= N)
+            a[*i - 1] = value;
+    };
+
+    // Value operators. The other operand can also be a table vector (see from_table()), the result is always native.
+    using T = const sol::table&;
+    type[sol::meta_function::addition] = sol::overload(
+        [](const V& a, const V& b) { return a + b; },
+        [](const V& a, T b) { return a + from_table<N>(b); },
+        [](T a, const V& b) { return from_table<N>(a) + b; }
+    );
+    type[sol::meta_function::subtraction] = sol::overload(
+        [](const V& a, const V& b) { return a - b; },
+        [](const V& a, T b) { return a - from_table<N>(b); },
+        [](T a, const V& b) { return from_table<N>(a) - b; }
+    );
+    type[sol::meta_function::multiplication] = sol::overload(
+        [](const V& a, const V& b) { return a * b; },
+        [](const V& a, float b) { return a * b; },
+        [](float a, const V& b) { return a * b; },
+        [](const V& a, T b) { return a * from_table<N>(b); },
+        [](T a, const V& b) { return from_table<N>(a) * b; }
+    );
+    type[sol::meta_function::division] = sol::overload(
+        [](const V& a, const V& b) { return a / b; },
+        [](const V& a, float b) { return a / b; },
+        [](const V& a, T b) { return a / from_table<N>(b); },
+        [](T a, const V& b) { return from_table<N>(a) / b; }
+    );
+    type[sol::meta_function::unary_minus] = [](const V& a) { return -a; };
+    // Lua calls __eq only for two userdata, so comparison with a table is always false. Use equals() for that.
+    type[sol::meta_function::equal_to] = [](const V& a, const V& b) { return a == b; };
+    type[sol::meta_function::length] = [](const V& a) { return glm::length(a); };
+    type[sol::meta_function::to_string] = [](const V& a) { return to_string<N>(a); };
+    type[sol::meta_function::concatenation] = sol::overload(
+        [](const std::string& a, const V& b) { return a + to_string<N>(b); },
+        [](const V& a, const std::string& b) { return to_string<N>(a) + b; },
+        [](const V& a, const V& b) { return to_string<N>(a) + ", " + to_string<N>(b); }
+    );
+
+    // Methods returning new values.
+    type["copy"] = [](const V& a) { return a; };
+    type["length"] = [](const V& a) { return glm::length(a); };
+    type["normalize"] = [](const V& a) { float l = glm::length(a); return l > 0.0f ? a / l : a; };
+    type["dot"] = sol::overload(
+        [](const V& a, const V& b) { return glm::dot(a, b); },
+        [](const V& a, T b) { return glm::dot(a, from_table<N>(b)); }
+    );
+    type["distance"] = sol::overload(
+        [](const V& a, const V& b) { return glm::distance(a, b); },
+        [](const V& a, T b) { return glm::distance(a, from_table<N>(b)); }
+    );
+    type["lerp"] = sol::overload(
+        [](const V& a, const V& b, float t) { return glm::mix(a, b, t); },
+        [](const V& a, T b, float t) { return glm::mix(a, from_table<N>(b), t); }
+    );
+    type["equals"] = sol::overload(
+        [](const V& a, const V& b) { return a == b; },
+        [](const V& a, T b) { return a == from_table<N>(b); }
+    );
+    // Can be called both as Vec2:new_from(v) and Vec2.new_from(v). Table vectors are converted.
+    type["new_from"] = sol::overload(
+        [](const V& a) { return a; },
+        [](T a) { return from_table<N>(a); },
+        [](T, const V& a) { return a; },
+        [](T, T a) { return from_table<N>(a); }
+    );
+
+    // In-place methods.
+    if constexpr (N == 2)
+        type["set"] = sol::overload([](V& a, float x, float y) { a = { x, y }; }, [](V& a, const V& b) { a = b; }, [](V& a, T b) { a = from_table<N>(b); });
+    else
+        type["set"] = sol::overload([](V& a, float x, float y, float z) { a = { x, y, z }; }, [](V& a, const V& b) { a = b; }, [](V& a, T b) { a = from_table<N>(b); });
+    if constexpr (N == 2)
+        type["add"] = sol::overload([](V& a, float x, float y) { a += V(x, y); }, [](V& a, const V& b) { a += b; }, [](V& a, T b) { a += from_table<N>(b); });
+    else
+        type["add"] = sol::overload([](V& a, float x, float y, float z) { a += V(x, y, z); }, [](V& a, const V& b) { a += b; }, [](V& a, T b) { a += from_table<N>(b); });
+    type["mul"] = sol::overload([](V& a, float s) { a *= s; }, [](V& a, const V& b) { a *= b; }, [](V& a, T b) { a *= from_table<N>(b); });
+
+    // Batch helpers on flat arrays.
+    type["normalize_all"] = [](sol::table a) {
+        std::size_t count = a.size() / N;
+        for (std::size_t i = 0; i < count; i++) {
+            V v = read_vec<N>(a, i);
+            float l = glm::length(v);
+            if (l > 0.0f)
+                write_vec<N>(a, i, v / l);
+        }
+    };
+    type["lerp_all"] = [](sol::table a, sol::table b, float t, sol::optional<sol::table> out, sol::this_state s) {
+        std::size_t count = std::min(a.size(), b.size()) / N;
+        sol::table res = out ? *out : sol::state_view(s).create_table(int(count * N), 0);
+        for (std::size_t i = 0; i < count; i++)
+            write_vec<N>(res, i, glm::mix(read_vec<N>(a, i), read_vec<N>(b, i), t));
+        return res;
+    };
+    type["distance_all"] = [](sol::table a, sol::table b, sol::optional<sol::table> out, sol::this_state s) {
+        std::size_t count = std::min(a.size(), b.size()) / N;
+        sol::table res = out ? *out : sol::state_view(s).create_table(int(count), 0);
+        for (std::size_t i = 0; i < count; i++)
+            res.raw_set(i + 1, glm::distance(read_vec<N>(a, i), read_vec<N>(b, i)));
+        return res;
+    };
+}
+
+void LuaVector::Register(sol::state& lua) {
+    register_vec<2>(lua, "Vec2", sol::constructors<glm::vec2(), glm::vec2(float), glm::vec2(float, float)>());
+    register_vec<3>(lua, "Vec3", sol::constructors<glm::vec3(), glm::vec3(float), glm::vec3(float, float, float)>());
+    // Older name of Vec2.
+    lua["glmvec2"] = lua["Vec2"];
+}
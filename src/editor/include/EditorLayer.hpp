@@ -64,6 +64,11 @@ public:
                 if (ImGui::MenuItem("Close"))
                     m_scene->Unload();
                 ImGui::Separator();
+                if (ImGui::MenuItem("Precompile scripts")) {
+                    std::size_t count = Ren::LuaChunkCache::PrecompileDir(Ren::AssetManager::GetScriptDir());
+                    LOG_I("Precompiled " + std::to_string(count) + " scripts.");
+                }
+                ImGui::Separator();
                 if (ImGui::MenuItem("Undo", "Ctrl+Z")) {}
                 if (ImGui::MenuItem("Redo", "Ctrl+R")) {}
                 ImGui::Separator();
@@ -79,6 +84,8 @@ public:
         ImGui::Begin("Info");
         ImGui::LabelText("Scene accept input", "%s", m_scene->m_AcceptInput ? "yes" : "no");
         m_fpsCounter.DrawPlot();
+        if (m_scene->GetLoadState() && ImGui::CollapsingHeader("Lua"))
+            drawLuaStats(m_scene->Get());
         ImGui::End();
 
         ImGui::Begin("Scene view");
@@ -109,6 +116,11 @@ public:
         ImGui::Begin("Entity details");
         ImGui::End();
 
+        ImGui::Begin("Lua profiler");
+        if (m_scene->GetLoadState())
+            drawLuaProfiler(m_scene->Get());
+        ImGui::End();
+
         ImGui::Begin("Settings");
         {
             std::string play_label = strfmt("%s scene", m_scene->m_EditMode ? "Play" : "Stop");
@@ -117,6 +129,9 @@ public:
 
             if (ImGui::Button("Reset camera"))
                 m_scene->ResetCamera();
+
+            if (m_scene->GetLoadState() && ImGui::CollapsingHeader("Collision layers"))
+                drawCollisionMatrix(m_scene->Get());
         }
         ImGui::End();
     }
@@ -125,4 +140,103 @@ public:
         if (m_scene->GetLoadState())
             m_scene->Render();
     }
+
+private:
+    // Memory and GC time of the lua states of the scene.
+    void drawLuaStats(Ren::Scene& scene) {
+        auto lua = scene.GetSystem<Ren::LuaScriptSystem>();
+        if (!lua)
+            return;
+        float budget = lua->GetGCBudget();
+        if (ImGui::SliderFloat("GC budget (ms)", &budget, 0.0f, 4.0f))
+            lua->SetGCBudget(budget);
+        for (std::size_t i = 0; i < lua->GetStateCount(); i++) {
+            auto stats = lua->GetStateStats(i);
+            ImGui::Text("State %zu: %.2f MB (peak %.2f MB, pool %.2f MB), GC %.3f ms", i,
+                        stats.memory.used / (1024.0f * 1024.0f), stats.memory.peak / (1024.0f * 1024.0f),
+                        stats.memory.pooled / (1024.0f * 1024.0f), stats.gc_ms);
+        }
+    }
+
+    // Controls of the profiler and the slowest functions, scripts and entities.
+    void drawLuaProfiler(Ren::Scene& scene) {
+        auto lua = scene.GetSystem<Ren::LuaScriptSystem>();
+        if (!lua)
+            return;
+        bool profiling = lua->IsProfiling();
+        if (ImGui::Checkbox("Profile", &profiling))
+            lua->SetProfiling(profiling);
+        ImGui::SameLine();
+        if (ImGui::Button("Reset"))
+            lua->ResetProfile();
+        ImGui::SameLine();
+        if (ImGui::Button("Export..")) {
+            nfdchar_t* save_path;
+            if (NFD_SaveDialog("csv", NULL, &save_path) == NFD_OKAY) {
+                if (!lua->GetProfile().Export((const char*)save_path))
+                    LOG_E(std::string("Can't write Lua profile to '") + save_path + "'.");
+                free(save_path);
+            }
+        }
+
+        auto report = lua->GetProfile();
+        auto table = [](const char* name, std::vector<std::pair<std::string, Ren::LuaProfiler::Entry>> rows, const char* count_label) {
+            std::sort(rows.begin(), rows.end(), [](const auto& a, const auto& b) { return a.second.ms > b.second.ms; });
+            if (!ImGui::CollapsingHeader(name, ImGuiTreeNodeFlags_DefaultOpen) || !ImGui::BeginTable(name, 3, ImGuiTableFlags_RowBg))
+                return;
+            ImGui::TableSetupColumn("Name");
+            ImGui::TableSetupColumn("ms");
+            ImGui::TableSetupColumn(count_label);
+            ImGui::TableHeadersRow();
+            for (std::size_t i = 0; i < std::min<std::size_t>(rows.size(), 20); i++) {
+                ImGui::TableNextRow();
+                ImGui::TableNextColumn();
+                ImGui::TextUnformatted(rows[i].first.c_str());
+                ImGui::TableNextColumn();
+                ImGui::Text("%.2f", rows[i].second.ms);
+                ImGui::TableNextColumn();
+                ImGui::Text("%llu", (unsigned long long)rows[i].second.count);
+            }
+            ImGui::EndTable();
+        };
+        table("Functions", { report.functions.begin(), report.functions.end() }, "samples");
+        table("Scripts", { report.scripts.begin(), report.scripts.end() }, "calls");
+        std::vector<std::pair<std::string, Ren::LuaProfiler::Entry>> entities;
+        for (auto&& [ent, entry] : report.entities)
+            entities.push_back({ "Entity " + std::to_string(entt::to_integral(ent)), entry });
+        table("Entities", std::move(entities), "calls");
+    }
+
+    // Triangle of checkboxes, whether the layers collide (the matrix is symmetric).
+    void drawCollisionMatrix(Ren::Scene& scene) {
+        auto& layers = scene.m_CollisionLayers;
+        static char new_layer[64] = "";
+        ImGui::InputText("##new_layer", new_layer, sizeof(new_layer));
+        ImGui::SameLine();
+        if (ImGui::Button("Add layer") && new_layer[0]) {
+            if (layers.Add(new_layer) < 0)
+                LOG_W("There can be at most " + std::to_string(Ren::CollisionLayers::MAX_LAYERS) + " collision layers.");
+            new_layer[0] = '\0';
+        }
+
+        bool changed = false;
+        for (int32_t a = 0; a < layers.Count(); a++) {
+            for (int32_t b = layers.Count() - 1; b >= a; b--) {
+                bool collides = layers.Collides(a, b);
+                ImGui::PushID(a * Ren::CollisionLayers::MAX_LAYERS + b);
+                if (ImGui::Checkbox("##collides", &collides)) {
+                    layers.SetCollides(a, b, collides);
+                    changed = true;
+                }
+                if (ImGui::IsItemHovered())
+                    ImGui::SetTooltip("%s - %s", layers.GetName(a).c_str(), layers.GetName(b).c_str());
+                ImGui::PopID();
+                ImGui::SameLine();
+            }
+            ImGui::TextUnformatted(layers.GetName(a).c_str());
+        }
+        if (changed)
+            if (auto physics = scene.GetSystem<Ren::PhysicsSystem>())
+                physics->ApplyCollisionLayers();
+    }
 };
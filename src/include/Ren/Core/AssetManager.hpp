@@ -21,6 +21,7 @@ namespace Ren {
         inline static Path m_ScenePath{ "scenes" };
         inline static Path m_ImagePath{ "images" };
         inline static Path m_LuaCorePath{ "lua_core" };
+        inline static Path m_PrefabDir{ "prefabs" };
 
         /// Get full asset path.
         /// @param rel_path Path relative to asset root.
@@ -55,6 +56,12 @@ namespace Ren {
         static Path GetLuaCore(Path core_path) { return m_AssetRoot / m_LuaCorePath / core_path; }
         /// Get full directory path to core lua scripts.
         static Path GetLuaCoreDir() { return m_AssetRoot / m_LuaCorePath; }
+
+        /// Get full prefab path
+        /// @param prefab_path Prefab path relative to m_PrefabDir
+        static Path GetPrefab(Path prefab_path) { return m_AssetRoot / m_PrefabDir / prefab_path; }
+        /// Get full prefab directory path
+        static Path GetPrefabDir() { return m_AssetRoot / m_PrefabDir; }
     };
 }
 
@@ -39,7 +39,7 @@ namespace Ren {
         Class which acts as a Core of the whole game.
         It does several things:
             - Initialize and destroys subsystems ( SDL, ImGui, ...)
-            - Manages user defined layers. (OnUpdate(), OnEvent(), OnRender(), ...)
+            - Manages user defined layers. (OnUpdate(), OnFixedUpdate(), OnEvent(), OnRender(), ...)
             - Manages main game loop.
                 - Polls events
                 - Updates all layers
@@ -51,6 +51,11 @@ namespace Ren {
         bool         m_Run{ true };
         glm::ivec4   m_ClearColor{ 0x0, 0x0, 0x0, 0xff };
         KeyInterface m_Input;
+        // Time of a single fixed update in seconds.
+        float        m_FixedTimeStep{ 1.0f / 60.0f };
+        // Maximum number of fixed updates per frame. The rest of the time is dropped, so that one long frame doesn't make
+        // the next frames even longer.
+        int32_t      m_MaxFixedSteps{ 5 };
 
         // Create game core with default settings.
         GameCore(glm::ivec2 window_size) : GameCore(GameDefinition{ {WINDOWPOS_UNDEFINED, window_size} }) {}
@@ -74,7 +79,6 @@ namespace Ren {
 
         virtual void OnInit() {}
         virtual void OnUpdate(float dt) {}
-        // FIXME: Not implemented yet.
         virtual void OnFixedUpdate(float dt) {}
         virtual void OnRender(SDL_Renderer* renderer) {}
         virtual void OnImGui(Ren::ImGuiContext& context) {}
@@ -84,12 +88,15 @@ namespace Ren {
         inline const SDLContext& GetContext() { return m_context; }
         inline glm::ivec2 GetWindowSize() { return m_context.definition.window_size; }
         inline SDL_Renderer* GetRenderer() { return m_context.renderer; }
+        // Fraction of the fixed step, that was accumulated, but not simulated yet. Use it to interpolate between fixed states.
+        inline float GetFixedAlpha() const { return m_fixedAccumulator / m_FixedTimeStep; }
 
     private:
         bool            m_initialized{ false };
         SDLContext      m_context;
         GameDefinition  m_gameDefinition;
         uint64_t        m_lastFrameTicks{ 0 };
+        float           m_fixedAccumulator{ 0.0f };
         LayerStack      m_layerStack{};
 
         // Dear ImGui context.
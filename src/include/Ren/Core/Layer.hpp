@@ -29,6 +29,8 @@ namespace Ren {
         virtual void OnDestroy() {}
         virtual void OnEvent(Ren::Event& e) {}
         virtual void OnUpdate(float dt) {}
+        // Called with constant dt (see GameCore::m_FixedTimeStep) before OnUpdate, possibly several times per frame.
+        virtual void OnFixedUpdate(float dt) {}
         virtual void OnRender(SDL_Renderer* renderer) {}
         virtual void OnImGui(Ren::ImGuiContext& context) {}
 
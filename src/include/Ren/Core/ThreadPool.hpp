@@ -0,0 +1,60 @@
+/**
+ * @file Ren/Core/ThreadPool.hpp
+ * @brief Declaration of thread pool used for data parallel work.
+ */
+#pragma once
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace Ren {
+    /// Fixed set of worker threads for splitting work into independent items (for ex. stepping physics shards).
+    class ThreadPool {
+    public:
+        /// @param thread_count Number of worker threads. The calling thread works as well, so 0 means everything runs on it.
+        ThreadPool(std::size_t thread_count = std::max(1u, std::thread::hardware_concurrency()) - 1);
+        ~ThreadPool();
+        ThreadPool(const ThreadPool&) = delete;
+        ThreadPool& operator=(const ThreadPool&) = delete;
+
+        /// Call `func(i)` for every i in [0, count) and wait until all calls finish. Items may run in any order and on any
+        /// thread, including the calling one. Jobs from different threads are run one after another.
+        /// Calls from inside of another ParallelFor() of the same pool run all items on the calling thread.
+        /// If an item throws, items not started yet are skipped and the first exception is rethrown on the calling
+        /// thread once all running items finish.
+        void ParallelFor(std::size_t count, const std::function<void(std::size_t)>& func);
+        /// Number of threads working on ParallelFor() (workers and the calling thread).
+        inline std::size_t GetConcurrency() const { return m_workers.size() + 1; }
+
+        /// Pool shared by the engine systems.
+        static ThreadPool& Global();
+
+    private:
+        std::vector<std::thread> m_workers;
+        // Held by the thread running a job.
+        std::mutex m_jobMutex;
+        std::mutex m_mutex;
+        std::condition_variable m_wake;
+        std::condition_variable m_done;
+        bool m_stop{ false };
+
+        // Current job. Generation changes with every job, so that the workers don't run the same job twice.
+        const std::function<void(std::size_t)>* m_func{ nullptr };
+        std::size_t m_count{ 0 };
+        std::atomic<std::size_t> m_next{ 0 };
+        std::size_t m_busy{ 0 };
+        uint64_t m_generation{ 0 };
+        // First exception thrown by an item of the current job.
+        std::exception_ptr m_error;
+
+        void workerLoop();
+        // Take items of the current job until there are none.
+        void work(const std::function<void(std::size_t)>& func, std::size_t count);
+    };
+}
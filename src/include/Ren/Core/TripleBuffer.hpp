@@ -0,0 +1,49 @@
+/**
+ * @file Ren/Core/TripleBuffer.hpp
+ * @brief Declaration of lock-free triple buffer for passing state between two threads.
+ */
+#pragma once
+#include <array>
+#include <atomic>
+#include <cstdint>
+
+namespace Ren {
+    /// Three buffers shared by a single producer and a single consumer thread. Producer writes the back buffer, consumer
+    /// reads the front buffer and they swap them through the middle one, so that neither of them waits.
+    /// The consumer always gets the latest published buffer, older ones are skipped.
+    template <typename T>
+    class TripleBuffer {
+    public:
+        /// Buffer written by the producer.
+        inline T& Back() { return m_buffers[m_back]; }
+        /// Hand the back buffer over to the consumer. Producer writes another buffer from now on.
+        inline void Publish() { m_back = m_middle.exchange(m_back | NEW_STATE, std::memory_order_acq_rel) & STATE_INDEX; }
+
+        /// Take the latest published buffer as the front one, if there is any.
+        /// @returns True, if the front buffer changed (it wasn't read yet).
+        inline bool Acquire() {
+            if (!(m_middle.load(std::memory_order_acquire) & NEW_STATE))
+                return false;
+            m_front = m_middle.exchange(m_front, std::memory_order_acq_rel) & STATE_INDEX;
+            return true;
+        }
+        /// Buffer read by the consumer.
+        inline const T& Front() const { return m_buffers[m_front]; }
+
+        /// Call `func(buffer)` on all buffers. Only while neither of the threads uses them.
+        template <typename Func>
+        inline void ForEach(Func func) {
+            for (auto&& buffer : m_buffers)
+                func(buffer);
+        }
+
+    private:
+        static constexpr uint8_t NEW_STATE = 0x4;
+        static constexpr uint8_t STATE_INDEX = 0x3;
+        std::array<T, 3> m_buffers{};
+        uint8_t m_back{ 0 };
+        uint8_t m_front{ 1 };
+        // Index of the middle buffer. NEW_STATE bit is set, when it holds a buffer, that wasn't read yet.
+        std::atomic<uint8_t> m_middle{ 2 };
+    };
+}
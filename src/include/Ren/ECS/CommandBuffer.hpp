@@ -0,0 +1,123 @@
+/**
+ * @file Ren/ECS/CommandBuffer.hpp
+ * @brief Declaration of entity command buffer.
+ *
+ * Command buffer records structural changes of the scene (creating/destroying entities, adding/removing components) and
+ * applies them later in one batch. This makes it safe to change the scene while iterating over it (systems, scripts, contact callbacks, ...).
+ */
+#pragma once
+#include <vector>
+#include <string>
+#include <functional>
+#include <entt/entt.hpp>
+
+#include "Ren/Core/Core.hpp"
+#include "Scene.hpp"
+
+namespace Ren {
+    /// Entity created by command buffer. It becomes a real entity when the buffer is played back.
+    struct DeferredEntity {
+        uint32_t index;
+    };
+
+    /// Records structural changes to be applied at the sync points of Scene::Update().
+    ///     - Note: Single buffer is NOT thread-safe. Use Scene::GetCommandBuffer() to get buffer of the current thread.
+    ///     - Note: Commands are applied grouped by their kind in this order: creations, emplaces, removals, tags, destructions.
+    ///     - Note: Emplacing RigidBodyComponent creates its body in the PhysicsSystem (if the entity has a transform) and
+    ///             removing it destroys the body. Replaced component gets a new body. Other components are emplaced as they
+    ///             are, systems see them only through the registry signals.
+    class EntityCommandBuffer {
+    public:
+        /// Target of a command. Either an existing entity or entity created by this buffer.
+        struct Target {
+            entt::entity entity{ entt::null };
+            int32_t deferred{ -1 };
+
+            Target(entt::entity ent) : entity(ent) {}
+            Target(const Entity& ent) : entity(ent.id) {}
+            Target(DeferredEntity ent) : deferred(int32_t(ent.index)) {}
+        };
+
+        /// Create entity with default components (same as Scene::CreateEntity()).
+        DeferredEntity Create(const TransformComponent& transform_comp = {}, const TagList& tag_list = {});
+        /// Destroy entity.
+        void Destroy(Target target);
+
+        /// Add (or replace) component. Args are arguments needed for construction.
+        template<typename TComponent, typename... Args>
+        void Emplace(Target target, Args&&... args) {
+            m_commands.emplaces.push_back({ entt::type_hash<TComponent>::value(), target,
+                [comp = TComponent(std::forward<Args>(args)...)](entt::registry& reg, entt::entity ent) {
+                    reg.emplace_or_replace<TComponent>(ent, comp);
+                }});
+        }
+        /// Remove component.
+        template<typename TComponent>
+        void Remove(Target target) { m_commands.removes.push_back({ entt::type_hash<TComponent>::value(), target, &removeRange<TComponent> }); }
+
+        /// Add tag to entity.
+        void AddTag(Target target, std::string tag) { m_commands.tags.push_back({ target, std::move(tag), true }); }
+        /// Remove tag from entity.
+        void RemTag(Target target, std::string tag) { m_commands.tags.push_back({ target, std::move(tag), false }); }
+
+        /// Returns true if there are no recorded commands.
+        bool Empty() const;
+        /// Apply all recorded commands on the scene and clear the buffer. Called by the Scene at sync points.
+        /// Commands recorded during the playback (for ex. by on_construct handlers) are applied in the following rounds
+        /// of the same playback. After MAX_PLAYBACK_ROUNDS rounds the rest is left for the next sync point.
+        void Playback(Scene* scene);
+        /// Discard all recorded commands.
+        void Clear();
+
+        static constexpr uint32_t MAX_PLAYBACK_ROUNDS = 16;
+
+    private:
+        using RemoveFunc = void(*)(entt::registry&, const entt::entity*, std::size_t);
+
+        struct CreateCommand {
+            TransformComponent transform;
+            TagList tags;
+        };
+        struct EmplaceCommand {
+            entt::id_type type;
+            Target target;
+            std::function<void(entt::registry&, entt::entity)> emplace;
+        };
+        struct RemoveCommand {
+            entt::id_type type;
+            Target target;
+            RemoveFunc remove;
+        };
+        struct TagCommand {
+            Target target;
+            std::string tag;
+            bool add;
+        };
+
+        struct Commands {
+            std::vector<CreateCommand> creates;
+            std::vector<EmplaceCommand> emplaces;
+            std::vector<RemoveCommand> removes;
+            std::vector<TagCommand> tags;
+            std::vector<Target> destroys;
+
+            bool Empty() const;
+            void Clear();
+        };
+
+        Commands m_commands;
+        // Commands being played back. Swapped with m_commands, so that the recording can continue and the memory is reused.
+        Commands m_playing;
+        // Entities created during the playback of m_playing. Used to resolve deferred targets.
+        std::vector<entt::entity> m_created;
+        bool m_inPlayback{ false };
+
+        template<typename TComponent>
+        static void removeRange(entt::registry& reg, const entt::entity* first, std::size_t count) { reg.remove<TComponent>(first, first + count); }
+
+        // Apply commands of a single round.
+        void playback(Scene* scene, Commands& commands);
+        // Convert target to the real entity.
+        inline entt::entity resolve(const Target& target) const { return target.deferred >= 0 ? m_created[target.deferred] : target.entity; }
+    };
+} // namespace Ren
@@ -10,13 +10,35 @@ extern "C" {
 }
 #include <box2d/box2d.h>
 #include <entt/entt.hpp>
+#include <sol/sol.hpp>
+#include <algorithm>
+#include <cstdint>
 #include <optional>
+#include <vector>
+#include <unordered_map>
+#include <array>
+#include <atomic>
+#include <mutex>
+#include <thread>
+#include <chrono>
+#include <functional>
+#include <string>
 
 #include "Ren/Core/Core.hpp"
 #include "Ren/Core/Input.hpp"
+#include "Ren/Core/ThreadPool.hpp"
+#include "Ren/Core/TripleBuffer.hpp"
+#include "Ren/Physics/Physics.hpp"
+#include "Ren/Physics/DebugDraw.hpp"
+#include "Ren/Physics/StaticGeometry.hpp"
+#include "Ren/Physics/ShardedWorld.hpp"
+#include "Ren/Scripting/LuaAllocator.hpp"
+#include "Ren/Scripting/LuaProfiler.hpp"
 
 namespace Ren {
     class Scene;
+    struct RigidBodyComponent;
+    struct Fixture;
 
     /*
         Base class for all component systems.
@@ -32,6 +54,8 @@ namespace Ren {
         virtual void Init() {}
         virtual void Destroy() {}
         virtual void Update(float dt) {}
+        // Called with constant dt (see Scene::m_FixedTimeStep), possibly several times per frame.
+        virtual void FixedUpdate(float dt) {}
         virtual void Render() {}
     protected:
         // Scene on which this system acts.
@@ -41,11 +65,55 @@ namespace Ren {
     };
 
     // System which handles rendering.
+    // Keeps packed array of render proxies, which are updated only for entities whose TransformComponent, SpriteComponent
+    // or RenderTransformComponent has changed. Change is detected by EnTT signals, so modify the components with registry
+    // patch() or replace() (see Entity::Patch() and NativeScript::PatchComponent()). Lua scripts do so through the Transform
+    // and Sprite wrappers. Sprite is rendered at RenderTransformComponent, if the entity has one.
+    //  - Note: Components written directly (for ex. by the editor or through Entity::Get()) are not seen. Call Invalidate()
+    //          after such changes.
     class RenderSystem : public ComponentSystem {
+        // Everything needed to render a single sprite.
+        struct RenderProxy {
+            entt::entity ent{ entt::null };
+            SDL_Texture* texture{ nullptr };
+            // Bottom-left corner and size of the sprite in units.
+            glm::vec2 pos{ 0.0f }, size{ 0.0f };
+            float rotation{ 0.0f };
+            glm::ivec3 color{ 255 };
+            // Proxies are sorted by render layer.
+            int32_t layer{ 0 };
+        };
     public:
-        RenderSystem(Scene* p_scene, KeyInterface* p_input) : ComponentSystem(p_scene, p_input) {}
+        RenderSystem(Scene* p_scene, KeyInterface* p_input);
+        ~RenderSystem();
 
+        void Init() override;
         void Render() override;
+
+        // Rebuild all render proxies. Use this, if components were changed without triggering the update signal.
+        void Invalidate();
+
+    private:
+        std::vector<RenderProxy> m_proxies{};
+        // Index of the entity proxy in m_proxies.
+        std::unordered_map<entt::entity, std::size_t> m_proxyIndex{};
+        // New proxies and the ones, which changed layer. They are merged into m_proxies by mergeProxies().
+        std::vector<RenderProxy> m_insertedProxies{};
+        // Lowest index of a proxy removed since the last merge. Removed proxies are left in place with null entity.
+        std::size_t m_removedFrom{ SIZE_MAX };
+        // Entities, whose proxies has to be updated before rendering.
+        std::vector<entt::entity> m_journal{};
+        // Entity in the journal by its entity index (null if there is none), so that each entity is journaled once.
+        std::vector<entt::entity> m_journaled{};
+
+        // Record change of the entity into the journal. Connected to the registry signals.
+        void onChange(entt::registry& reg, entt::entity ent);
+        // Update proxies of entities in journal.
+        void flushJournal();
+        void updateProxy(entt::entity ent);
+        void removeProxy(entt::entity ent);
+        // Drop the removed proxies and merge in the inserted ones, so that m_proxies stays sorted by layer.
+        void mergeProxies();
     };
 
     // System which handles native scripts.
@@ -56,10 +124,20 @@ namespace Ren {
         void Init() override;
         void Destroy() override;
         void Update(float dt) override;
+        void FixedUpdate(float dt) override;
+        /// Initialize script bound after the system was initialized.
+        /// @param ent Entity ID of the entity with NativeScriptComponent.
+        void InitScript(entt::entity ent);
+        /// Call OnDestroy() of the script, before its component is removed while the system is running.
+        /// @param ent Entity ID of the entity with NativeScriptComponent.
+        void DestroyScript(entt::entity ent);
     };
 
     class LuaScript;
     /// Manage all LuaScriptComponents and initialization/destruction of LuaScripts.
+    /// All scripts of the scene run in a single lua state. Each entity has its own environment in it (see LuaScript::create_environment()),
+    /// so the bindings and core scripts are loaded only once, not for every entity.
+    /// In parallel mode (see SetParallel()) the entities are spread among several independent lua states, which are updated in parallel.
     class LuaScriptSystem : public ComponentSystem {
     public:
         LuaScriptSystem(Scene* p_scene, KeyInterface* p_input) : ComponentSystem(p_scene, p_input) {}
@@ -70,6 +148,8 @@ namespace Ren {
         void Destroy() override;
         /// Update all LuaScripts that are attached to LuaScriptComponents.
         void Update(float dt) override;
+        /// Fixed update all LuaScripts that are attached to LuaScriptComponents.
+        void FixedUpdate(float dt) override;
         /// Initialize script for usage.
         /// @param ent Entity ID of the entity with LuaScriptComponent.
         /// @param name Name of the script specified when calling LuaScriptComponent::Attach().
@@ -86,49 +166,334 @@ namespace Ren {
         /// @param ent Entity ID of the entity with LuaScriptComponent.
         /// @param script Reference to the LuaScript, which is attached to the LuaScriptComponent.
         void DestroyScript(entt::entity ent, Ref<LuaScript> script);
+
+        /// Lua state shared by all scripts of the scene (the first one in parallel mode). Created on first use.
+        sol::state& GetState();
+        /// Memory used by the lua states in bytes.
+        std::size_t GetMemoryUsed();
+
+        /// Memory and garbage collection statistics of a lua state.
+        struct StateStats {
+            LuaAllocator::Stats memory;
+            // Time spent in the budgeted collection during the last Update() in milliseconds.
+            float gc_ms{ 0.0f };
+        };
+        /// Statistics of the lua state at `index` (0 to GetStateCount() - 1).
+        StateStats GetStateStats(std::size_t index) const;
+
+        /// Frame-budgeted garbage collection. When `budget_ms` is greater than 0, the collectors of the lua states never run
+        /// on their own (in the middle of the frame). Instead incremental steps are run at the end of Update(), until the
+        /// budget is spent or the cycle is finished. 0 gives control back to the automatic collector.
+        ///  - Note: If the budget is too small to keep up with the garbage created by the scripts, memory keeps growing.
+        void SetGCBudget(float budget_ms);
+        inline float GetGCBudget() const { return m_gcBudget; }
+        /// Run incremental garbage collection steps in each lua state for at most `budget_ms` (at least one step is run).
+        void CollectGarbage(float budget_ms);
+
+        /// In batched mode OnUpdate() and OnFixedUpdate() of all scripts are called from a single loop inside Lua,
+        /// so there is one call from C++ to Lua per update instead of one per script.
+        inline void SetBatched(bool batched) { m_batched = batched; }
+        inline bool IsBatched() const { return m_batched; }
+
+        /// Spread entities among `state_count` lua states, which are updated in parallel on ThreadPool::Global().
+        /// Entity is assigned to a state, when its first script is initialized, so call this before Init().
+        ///  - Note: Scripts running in parallel must touch only the components of their own entity. Reading input,
+        ///          logging and physics queries are safe (queries lock the physics world and run on the calling thread).
+        ///          Calls modifying the scene (for ex. collision layers) are deferred until all scripts are updated
+        ///          (see Defer()). Scripts in different states can't share any Lua data.
+        inline void SetParallel(std::size_t state_count) { m_stateCount = std::max<std::size_t>(state_count, 1); }
+        /// Number of lua states created so far.
+        inline std::size_t GetStateCount() const { return m_lanes.size(); }
+        /// Sample running lua functions and measure time of every script call (per file and entity).
+        ///  - Note: Scripts are called one by one from C++ while profiling, even in batched mode.
+        void SetProfiling(bool profiling, uint32_t sample_instructions = 1000);
+        inline bool IsProfiling() const { return m_profiling; }
+        /// Profile of all lua states since profiling started (or since the last ResetProfile()).
+        LuaProfiler::Report GetProfile() const;
+        void ResetProfile();
+
+        /// Set budget of the update methods of the script. Can be called before or after the script is initialized.
+        ///  - Note: Scripts in the lua state of a script with budget are called one by one from C++, even in batched mode.
+        void SetBudget(LuaScript& script, const LuaBudget& budget);
+
+        /// Resume coroutines of all scripts waiting for the event (wait_until(event) in Lua, see scheduler.lua).
+        void Signal(const std::string& event);
+
+        /// Run `func` after all scripts are updated, if called from a parallel update. Otherwise it is run immediately.
+        /// Used by the Lua API for calls, which are not safe to run in parallel.
+        void Defer(std::function<void()> func);
+
+    private:
+        // Scripts implementing one of the update methods. Instance tables and the methods are also stored in Lua
+        // arrays with the same order (starting at 1), so that the batched mode can iterate them without C++.
+        struct Batch {
+            std::vector<LuaScript*> scripts;
+            sol::table instances;
+            sol::table methods;
+        };
+
+        // Lua state with the scripts of its entities.
+        struct Lane {
+            Ref<sol::state> lua;
+            Batch update;
+            Batch fixed_update;
+            // C_CallBatch() defined in core.lua.
+            sol::protected_function call_batch;
+            // C_Tick() defined in scheduler.lua.
+            sol::protected_function tick;
+            // C_TakeChanges() defined in ecs.lua.
+            sol::protected_function take_changes;
+            // Entities, whose components were changed by the scripts in the last update. They are patched after it.
+            std::vector<entt::entity> changed_transforms;
+            std::vector<entt::entity> changed_sprites;
+            // Declared after the state, so that it is destroyed (and removes its hook) first.
+            Ref<LuaProfiler> profiler;
+            // Number of initialized scripts with a budget.
+            std::size_t budgeted{ 0 };
+            // Time of the last CollectGarbage() in milliseconds.
+            float gc_ms{ 0.0f };
+        };
+
+        std::vector<Lane> m_lanes;
+        bool m_batched{ false };
+        bool m_profiling{ false };
+        uint32_t m_sampleInstructions{ 1000 };
+        float m_gcBudget{ 0.0f };
+        std::size_t m_stateCount{ 1 };
+        // Used to assign entities to lanes in parallel mode.
+        std::size_t m_nextLane{ 0 };
+        std::atomic<bool> m_inParallel{ false };
+        std::mutex m_deferredMutex;
+        std::vector<std::function<void()>> m_deferred;
+
+        // Get lane, it is created if it doesn't exist yet.
+        Lane& getLane(std::size_t index);
+        // Add script to the batch, if it implements the method. `index` is the member of LuaScript storing its index in the batch.
+        void addToBatch(Batch& batch, LuaScript* script, int32_t LuaScript::* index, const sol::protected_function& method);
+        void removeFromBatch(Batch& batch, LuaScript* script, int32_t LuaScript::* index);
+        // Call `method` of all scripts in the batch (from Lua in batched mode).
+        void runBatch(Lane& lane, Batch& batch, void (LuaScript::* method)(float), LuaThrottle LuaScript::* throttle, float dt);
+        // Call `method` of the script with its budget and measure it, if profiling.
+        void runScript(Lane& lane, LuaScript* script, void (LuaScript::* method)(float), LuaThrottle LuaScript::* throttle, float dt);
+        // Run the batch of all lanes. If `tick` is true, due coroutines are resumed after the batch.
+        void update(Batch Lane::* batch, void (LuaScript::* method)(float), LuaThrottle LuaScript::* throttle, float dt, bool tick = false);
+        // Resume due coroutines of the lane.
+        void tick(Lane& lane, float dt);
+        // Read entities, whose components were changed through the Lua wrappers (see ecs.lua).
+        void takeChanges(Lane& lane);
+        // Call `func` for all lanes (in parallel, if there is more of them) and then run the deferred functions.
+        void forEachLane(const std::function<void(Lane&)>& func);
     };
 
     // Handles updating of all rigid bodies.
+    // Physics world is stepped either in FixedUpdate() or on a dedicated thread (see SetThreaded()).
+    //  - Note: In threaded mode, b2Body must not be touched from the game thread. Use Enqueue() instead.
+    //          RigidBodyComponent::p_body is set a bit later after InitPhysicsBody() (once the body is created).
     class PhysicsSystem : public ComponentSystem {
         const b2Vec2 GRAVITY{ 0.0f, -9.81f };
 
-        class ContactListener : public b2ContactListener {
-            PhysicsSystem* m_sys{ nullptr };
-        public:
-            ContactListener(PhysicsSystem* sys) : m_sys(sys) {}
+        // Non-static body, which is awake or fell asleep in the last step (and it is synced for the last time).
+        struct ActiveBody {
+            entt::entity ent{ entt::null };
+            b2Body* body{ nullptr };
+            // State before the last step. Transform is interpolated between this and the current state.
+            b2Vec2 prev_position{ 0.0f, 0.0f };
+            float prev_angle{ 0.0f };
+        };
 
-            void BeginContact(b2Contact* contact) override;
-            void EndContact(b2Contact* contact) override;
-            void PreSolve(b2Contact* contact, const b2Manifold* oldManifold) override;
-            void PostSolve(b2Contact* contact, const b2ContactImpulse* impulse) override;
+        // States of the bodies published by the physics thread.
+        struct StateBuffer {
+            std::vector<ShardedWorld::BodyState> bodies;
+            // When the step finished.
+            std::chrono::steady_clock::time_point time{};
+            // Number of commands executed before the step.
+            uint64_t commands_applied{ 0 };
+        };
+        // Body created on the physics thread.
+        struct CreatedBody {
+            entt::entity ent;
+            b2Body* body;
+            // User data of the body. Used to match the body with the component, which could be reinitialized meanwhile.
+            uintptr_t user_data;
+            // Body replaced by this one, when the body migrated to another shard. It is disabled and destroyed once
+            // the component points to the new body.
+            b2Body* old_body{ nullptr };
         };
     public:
-        // Render outlines of the shapes.
-        // TODO: For now, only supports rectangle shapes. Implement more shapes (eg. circles and polygons)
+        // Render shapes of the bodies, which are visible by the camera.
         bool m_DebugRender{ false };
-        // Time of a single physics frame.
-        // TODO: implement this. System should be running in separate thread and have a stable refresh rate.
+        // What is drawn when m_DebugRender is enabled (b2Draw flags, for ex. b2Draw::e_shapeBit | b2Draw::e_jointBit).
+        uint32_t m_DebugDrawFlags{ b2Draw::e_shapeBit | b2Draw::e_jointBit };
+        // Interpolate rendered bodies between the last two physics steps. Physics is stepped with Scene::m_FixedTimeStep
+        // (or m_RefreshRate in threaded mode), so without interpolation the movement stutters, when the frame rate
+        // doesn't match the step. Interpolated pose is stored in RenderTransformComponent, TransformComponent always
+        // holds the state of the body after the last step.
+        bool m_Interpolate{ true };
+        // Time of a single physics step in threaded mode.
         float m_RefreshRate{ 1.0f / 60.0f };
+        // Record pre-solve and post-solve events. They are generated for every touching contact every step, so disable
+        // this if no one needs them.
+        bool m_RecordSolveEvents{ true };
         // These are the recommended number of iterations from box2d docs.
         // If you need more/less precision you can try tweaking these values.
         int32_t m_VelocityIterations{ 6 };
         int32_t m_PositionIterations{ 2 };
 
         PhysicsSystem(Scene* scene, KeyInterface* input);
+        ~PhysicsSystem();
 
         void Init() override;
         void Destroy() override;
+        // Interpolate render transforms of the moving bodies.
         void Update(float dt) override;
+        // Step the physics world and sync transforms with the bodies.
+        void FixedUpdate(float dt) override;
         void Render() override;
 
         // Set positions of rigidbody to transform component, create body in physics world and create its fixture.
         // Use this when you add RigidBodyComponent **after** the Scene::Init() method was called.
-        void InitPhysicsBody(entt::entity ent);
+        // If `keep_body_pose` is true, the body is created at the position and angle of RigidBodyComponent::body_def
+        // instead and the transform is moved there (for ex. when restoring a snapshot of live bodies).
+        void InitPhysicsBody(entt::entity ent, bool keep_body_pose = false);
         // Cleanup any data allocated on heap by this object.
         void CleanupPhysicsBody(entt::entity ent);
+        // Set collision layer (index into Scene::m_CollisionLayers) of the fixture (or all fixtures, if `fixture` is -1).
+        // Body of the entity is updated before the next step.
+        void SetFixtureLayer(entt::entity ent, int32_t fixture, int32_t layer);
+        // Update filters of all bodies with layered fixtures after Scene::m_CollisionLayers changed.
+        void ApplyCollisionLayers();
+
+        // Run physics world on a dedicated thread. When disabled, world is stepped in FixedUpdate().
+        void SetThreaded(bool threaded);
+        inline bool IsThreaded() const { return m_threaded; }
+        // Number of bodies, whose transforms are synced each frame (bodies that are awake).
+        inline std::size_t GetActiveBodyCount() const { return m_activeBodies.size(); }
+        // Move the entity and its body to `position` (angle of the body is kept). Writing TransformComponent of an
+        // entity with a body doesn't move the body, it is overwritten by the next sync.
+        void Teleport(entt::entity ent, glm::vec2 position);
+        // Sync transform of the body, which was woken up directly through b2Body (for ex. b2Body::ApplyForce()).
+        // Bodies woken up by the step (contacts, joints), by Enqueue() commands and by Teleport() are found automatically.
+        void TrackBody(entt::entity ent);
+        // Number of entities merged into static geometry (see RigidBodyComponent::static_geometry).
+        inline std::size_t GetStaticTileCount() const { return m_staticGeometry.Size(); }
+        // Raw physics world of the shard. Use LockWorld() when reading it in threaded mode.
+        inline b2World* GetWorld(std::size_t shard = 0) { return m_shards.GetWorld(shard); }
+
+        // Add a shard -- a separate world, which is stepped in parallel with the others on ThreadPool::Global() (or on
+        // the pool of the physics thread in threaded mode).
+        // Bodies don't interact across shards (no contacts nor joints), so split the scene where that doesn't matter
+        // (for ex. separate arenas or rooms). Shard 0 always exists and holds everything else.
+        // Awake bodies without joints migrate between shard 0 and the shards with region at step boundaries.
+        // Returns index of the shard.
+        uint32_t AddShard(std::optional<b2AABB> region = std::nullopt);
+        inline std::size_t GetShardCount() const { return m_shards.Size(); }
+        // Find entities, whose colliders overlap the box. Entities merged into static geometry are found as well.
+        // Found entities are appended to `out` (each entity only once).
+        void QueryAABB(const b2AABB& aabb, std::vector<entt::entity>& out);
+        // Cast `count` rays and write the closest hit of each into `hits` (array of `count` items). Rays are split
+        // between ThreadPool::Global() threads, the world is locked (read-only) meanwhile. Call it between steps.
+        // Called from inside of a ThreadPool::Global() job (for ex. parallel Lua update), it runs on the calling thread.
+        void RaycastBatch(const RaycastQuery* queries, std::size_t count, RaycastHit* hits);
+        // Find entities overlapping the boxes. Query `i` writes up to `max_results` entities into
+        // `results[i * max_results ...]` and their number into `counts[i]`. Parallelized as RaycastBatch().
+        void OverlapBatch(const OverlapQuery* queries, std::size_t count, entt::entity* results, std::size_t max_results, uint32_t* counts);
+        // Execute command on the physics world before the next step (on the physics thread in threaded mode).
+        void Enqueue(std::function<void(b2World&)> command);
+        // Execute command on the body of the entity before the next step. Skipped, if the entity has no body by then.
+        void Enqueue(entt::entity ent, std::function<void(b2Body&)> command);
+        // Lock the physics world, so that it can be safely read from the game thread (for ex. bodies state for snapshots).
+        inline std::unique_lock<std::mutex> LockWorld() { return std::unique_lock<std::mutex>(m_worldMutex); }
+
+        using ContactSignal = entt::sigh<void(const std::vector<ContactEvent>&)>;
+        // Subscribe to contact events. All events of a step are passed at once after the step (before native and Lua scripts).
+        inline entt::sink<ContactSignal> OnContacts() { return entt::sink{ m_contactSignal }; }
 
     private:
-        Ref<b2World> m_physWorld{ nullptr };
-        ContactListener m_contactListener;
+        // Entities merged into static geometry (see RigidBodyComponent::static_geometry). Modified under LockWorld(),
+        // so that it can be read while the world is stepped.
+        StaticGeometry m_staticGeometry;
+        // Worlds of the shards. Shard 0 (the default world) exists, until the system is destroyed.
+        ShardedWorld m_shards{ m_staticGeometry, GRAVITY };
+        b2World* m_physWorld{ nullptr };
+        // Held while the world is being modified.
+        std::mutex m_worldMutex;
+        // Contact events of the last step in order. Written only by the thread stepping the world.
+        std::vector<ContactEvent> m_stepContacts;
+        ContactSignal m_contactSignal;
+        // Only these bodies are synced with their transforms. Sleeping and static bodies don't move.
+        std::vector<ActiveBody> m_activeBodies;
+        // Entities moved by Teleport(). Their bodies are moved to the transform.
+        std::vector<entt::entity> m_teleports;
+        // Batches debug shapes for the renderer. The batch is kept between frames to reuse its memory.
+        PhysicsDebugDraw m_debugDraw;
+
+        /* Threaded mode */
+        bool m_threaded{ false };
+        std::thread m_thread;
+        std::atomic<bool> m_threadRunning{ false };
+        // Pool stepping the shards on the physics thread. The thread holds the world lock while stepping, so it must not
+        // wait for ThreadPool::Global(), whose jobs (parallel Lua lanes) may be waiting for the world lock.
+        std::unique_ptr<ThreadPool> m_threadPool;
+
+        // Commands for the physics world.
+        std::vector<std::function<void()>> m_commands;
+        std::mutex m_commandsMutex;
+        uint64_t m_commandsEnqueued{ 0 };
+        // Physics thread only.
+        uint64_t m_commandsApplied{ 0 };
+        std::unordered_map<entt::entity, b2Body*> m_threadBodies;
+
+        // Body states published by the physics thread to the game thread.
+        TripleBuffer<StateBuffer> m_states;
+
+        // Passed from the physics thread to the game thread.
+        std::vector<CreatedBody> m_createdBodies;
+        std::vector<ContactEvent> m_contacts;
+        std::mutex m_fromThreadMutex;
+        // Entities teleported by the game, mapped to the number of commands, which must be applied before the body
+        // state is used again.
+        std::unordered_map<entt::entity, uint64_t> m_pendingTeleports;
+
+        // Merge the entity into static geometry. Returns false, if it can't be merged (for ex. it is not made of boxes).
+        bool addStaticTile(entt::entity ent, const RigidBodyComponent& rig);
+        void removeStaticTile(entt::entity ent);
+        // Recreate bodies of the changed groups (by commands, they belong to the thread stepping the world).
+        void rebuildStaticGeometry();
+        // Single queries of the batches. Called with the world locked.
+        RaycastHit raycast(const RaycastQuery& query);
+        uint32_t overlap(const OverlapQuery& query, entt::entity* results, std::size_t max_results);
+
+        // Add bodies, which were woken up by the step, into m_activeBodies.
+        void updateActiveBodies();
+        // Add the body into m_activeBodies, if it is awake and not synced yet. Previous state of the body, which was
+        // stepped already, is taken from its transform.
+        void trackBody(b2Body* body, bool stepped);
+        void removeActiveBody(std::size_t index);
+        void clearActiveBodies();
+        // Set render transform of the body to the pose between its previous and current state (at `alpha`). The component
+        // is removed, when the body is rendered at its transform (not interpolated or not moving).
+        void setRenderTransform(entt::entity ent, const b2Vec2& prev_position, float prev_angle, const b2Vec2& position, float angle, float alpha);
+        // Execute all queued commands.
+        void runCommands();
+        // Find body of the entity. Called from the context commands are executed in.
+        b2Body* findBody(entt::entity ent);
+        void threadLoop();
+        void stopThread();
+        // Apply everything published by the physics thread to the scene.
+        void syncFromThread();
+        // Pass contact events to subscribers, native scripts and Lua scripts.
+        void dispatchContacts(const std::vector<ContactEvent>& contacts);
+
+        // Definition of the fixture with the shape and the filter of its collision layer.
+        b2FixtureDef fixtureDef(const Fixture& fixture) const;
+        // Send filters of the fixtures to the body (or regroup the merged static geometry).
+        void refreshFilters(entt::entity ent, RigidBodyComponent& rig);
+
+        // Shard the body of the component is created in.
+        uint32_t shardOf(const RigidBodyComponent& rig) const;
+        // Step all shards on `pool`, migrate the bodies between them and collect their contacts into m_stepContacts.
+        // Moved bodies are appended to `migrated`. Old bodies are destroyed, or only disabled in threaded mode
+        // (see CreatedBody::old_body). If `states` is set, states of the awake bodies are written into it.
+        void stepShards(ThreadPool& pool, float dt, std::vector<CreatedBody>& migrated, std::vector<ShardedWorld::BodyState>* states = nullptr);
     };
 } // namespace Ren
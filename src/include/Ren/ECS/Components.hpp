@@ -13,6 +13,7 @@
 #include <sol/sol.hpp>
 
 #include "Loaders.hpp"
+#include "Ren/Physics/ShapeLibrary.hpp"
 
 #define UNDEFINED_TAG "undefined"
 #define UNDEFINED_PATH "undefined_path"
@@ -23,6 +24,8 @@ namespace Ren {
         static std::string type_name() { return typeid(T).name(); }
     }
 
+    // Transform of an entity with RigidBodyComponent holds the state of the body after the last physics step.
+    // Sprite may be rendered elsewhere (see RenderTransformComponent).
     struct TransformComponent {
         glm::vec2 position{ .0f, .0f };
         glm::vec2 scale { .0f, .0f };
@@ -30,13 +33,18 @@ namespace Ren {
         float rotation{ 0.0f };
         int32_t layer{ 0 };
 
-        // Use this if entity has RigidBodyComponent and you want to enforce transform as position.
-        bool dirty = false;
-
         TransformComponent(glm::vec2 pos = glm::vec2(0.0f), glm::vec2 scale = glm::vec2(10.0f), int32_t layer = 0)
             : position(pos), scale(scale), layer(layer) {}
     };
 
+    // Pose the sprite of the entity is rendered at instead of its TransformComponent (for ex. body interpolated between
+    // the last two physics steps). Render-only, managed by the physics system.
+    struct RenderTransformComponent {
+        glm::vec2 position{ 0.0f, 0.0f };
+        // Rotation in degrees ccw from positive x.
+        float rotation{ 0.0f };
+    };
+
     // Base class for components, that has to load some texture.
     struct ImgComponent {
         std::filesystem::path img_path = UNDEFINED_PATH;
@@ -65,13 +73,23 @@ namespace Ren {
         glm::vec2 GetSize();
     };
 
-    // TODO support for multiple fixtures
     struct RigidBodyComponent {
-        using ShapeFix = std::pair<Ref<b2Shape>, b2FixtureDef>;
         b2BodyDef body_def{};
         b2Body* p_body{ nullptr };
-        // Note: Use p_shape. Do NOT use b2FixtureDef::shape as it will be set when component is initialized.
-        std::vector<ShapeFix> fixtures;
+        // Index in the list of awake bodies of PhysicsSystem (-1 when not in the list). Managed by PhysicsSystem.
+        int32_t active_index{ -1 };
+        // Static body made only of axis-aligned boxes (for ex. a level tile). It is merged with the neighbours of the same
+        // material into larger boxes, so that the world has less bodies and proxies. Such entity has no p_body, but it is
+        // still found by PhysicsSystem::QueryAABB() and in contact events.
+        bool static_geometry{ false };
+        // Shard (world) of the body, see PhysicsSystem::AddShard(). -1 means it is chosen by the position of the body.
+        int32_t shard{ -1 };
+        // Shapes come from ShapeLibrary and the list is shared by copies of the component (copy-on-write).
+        // Note: b2FixtureDef::shape is ignored, Fixture::shape is used instead.
+        FixtureList fixtures;
+
+        // True, if the body was created in the physics world (or it will be by the physics thread, or it was merged).
+        inline bool Initialized() const { return p_body || body_def.userData.pointer; }
     };
 
     ///////////////////////////////////////
@@ -94,11 +112,12 @@ namespace Ren {
     class LuaScript;
     /// Component providing lua scripting.
     struct LuaScriptComponent {
-        std::unordered_map<std::string, Ref<LuaScript>> scripts;
-        // Make this a reference, because it is easer to copy (for us -- less template error madness).
+        // Lua state of the scene, which is shared by all entities. Set by LuaScriptSystem, when the scripts are initialized.
+        // Keep it first, so that the state outlives the scripts and the environment.
         Ref<sol::state> lua;
-
-        LuaScriptComponent();
+        std::unordered_map<std::string, Ref<LuaScript>> scripts;
+        // Environment of this entity inside the shared state. Globals of the scripts are stored here.
+        sol::environment env;
 
         /// Attach new script to component.
         /// @param name Name of the script to be indentified with.
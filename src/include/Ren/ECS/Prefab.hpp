@@ -0,0 +1,35 @@
+/**
+ * @file Ren/ECS/Prefab.hpp
+ * @brief Declaration of prefab (entity template).
+ *
+ * Prefab describes components of an entity, which can then be instanced many times at once using Scene::Instantiate().
+ */
+#pragma once
+#include <list>
+#include <string>
+#include <optional>
+#include <filesystem>
+
+#include "Ren/Core/Core.hpp"
+#include "Components.hpp"
+
+namespace Ren {
+    /// Template of an entity. Can be built in code or loaded from YAML file.
+    ///     - Note: Resources (textures and Box2D shapes) are shared between all instances of the prefab.
+    struct Prefab {
+        /// Name of the prefab.
+        std::string name{ "Undefined" };
+        /// Tags added to every instance.
+        std::list<std::string> tags{};
+        /// Default transform of instances. Used, when no transforms are given to Scene::Instantiate().
+        TransformComponent transform{};
+        /// Sprite of the instances (optional).
+        std::optional<SpriteComponent> sprite{};
+        /// Rigid body of the instances (optional). Shapes of the fixtures are shared by all instances.
+        std::optional<RigidBodyComponent> rigid_body{};
+
+        /// Load prefab from a file.
+        /// @param path Path to the prefab relative to AssetManager::m_PrefabDir
+        static Prefab Load(std::filesystem::path path);
+    };
+} // namespace Ren
@@ -6,6 +6,8 @@
 #include <entt/entt.hpp>
 #include <filesystem> // std::filesystem::path
 #include <optional>
+#include <mutex>
+#include <thread>
 
 #include "Ren/Core/Core.hpp"
 #include "Components.hpp"
@@ -13,9 +15,12 @@
 #include "ComponentSystems.hpp"
 #include "SystemsManager.hpp"
 #include "Ren/Physics/Physics.hpp"
+#include "Ren/Physics/CollisionLayers.hpp"
 
 namespace Ren {
     using TagList = std::list<std::string>;
+    struct Prefab;
+    class EntityCommandBuffer;
 
     /*
         Does several things:
@@ -45,6 +50,11 @@ namespace Ren {
             template<typename... TComponents>
             inline auto GetM() { return p_scene->m_Registry->get<TComponents...>(id); }
 
+            /// Modify given component and notify listeners (for ex. render system) about the change.
+            /// Func is called with reference to the component. If no functions are given, only listeners are notified.
+            template<typename TComponent, typename... Func>
+            inline auto& Patch(Func&&... func) { return p_scene->m_Registry->patch<TComponent>(id, std::forward<Func>(func)...); }
+
             /// Remove given components.
             template<typename... TComponents>
             inline auto& Remove() { p_scene->m_Registry->remove<TComponents...>(id); }
@@ -71,16 +81,29 @@ namespace Ren {
         SDL_Renderer* m_Renderer{ nullptr };
         /// Name of the scene.
         std::string m_Name = "Undefined";
+        /// Time of a single fixed update (physics step) in seconds.
+        float m_FixedTimeStep{ 1.0f / 60.0f };
+        /// Maximum number of fixed updates in a single Update(). The rest of the time is dropped, so that one long frame
+        /// doesn't make the next frames even longer.
+        int32_t m_MaxFixedSteps{ 5 };
+        /// Named collision layers of the fixtures (see Fixture::layer). Call PhysicsSystem::ApplyCollisionLayers()
+        /// after the matrix is changed, so that the existing bodies are updated.
+        CollisionLayers m_CollisionLayers;
 
         Scene(SDL_Renderer* renderer, KeyInterface* input);
         ~Scene();
 
         /// Create entity with default components.
         Entity CreateEntity(const TransformComponent& transform_comp = {}, const TagList& tag_list = {});
+        /// Create `count` instances of the prefab in one batch. Textures and shapes of the prefab are shared by all instances.
+        /// @param transforms Array of `count` transforms for the instances. If nullptr, prefab transform is used for all of them.
+        /// @returns Created entities.
+        std::vector<entt::entity> Instantiate(const Prefab& prefab, std::size_t count, const TransformComponent* transforms = nullptr);
         /// Create Ren::Entity from entt::entity.
         inline Entity ToEntity(entt::entity ent) { return { ent, this }; }
-        /// Destroy given entity.
-        inline void DestroyEntity(Entity ent) { m_Registry->destroy(ent.id); }
+        /// Destroy given entity. Its physics body and tags are released as well.
+        ///     - Note: Do not call this while iterating over the scene. Use GetCommandBuffer().Destroy() instead.
+        void DestroyEntity(Entity ent);
         /// Checks if given entity is still valid (e.g. it was not destroyed).
         inline bool EntityValid(Entity ent) const { return m_Registry->valid(ent.id); }
 
@@ -105,6 +128,8 @@ namespace Ren {
         /// Load texture with given, path. If texture already exists in cache, then it is recycled.
         /// @returns [sucess, texture_handle]
         std::optional<TextureHandle> LoadTexture(std::filesystem::path path);
+        /// Remove textures, which are not referenced by any component or handle, from the texture cache.
+        void ReleaseUnusedTextures();
         /// Returns raw pointer to the texture cache.
         inline TextureCache* GetTextureCache() { return m_textureCache.get(); }
 
@@ -120,13 +145,23 @@ namespace Ren {
         template<typename T>
         inline T* GetSystem() { return m_sysManager.Get<T>(); }
 
+        /// Get command buffer of the calling thread. Recorded commands are applied at the next sync point of Scene::Update().
+        ///     - Note: Commands of a single thread keep their order. Buffers of different threads are played back one after
+        ///             another, but their order depends on the scheduling of the threads, so it can differ between runs.
+        EntityCommandBuffer& GetCommandBuffer();
+        /// Apply commands recorded in all command buffers.
+        void PlaybackCommandBuffers();
+
         /// Initializes all subystems of the scene.
         inline void Init() { m_sysManager.Init(); }
         /// Call destroy on all component systems.
         inline void Destroy() { m_sysManager.Destroy(); }
-        /// Call update on all component systems.
+        /// Call fixed update on all component systems for every whole fixed step in accumulated time and then call update.
+        /// Command buffers are played back after each system (sync points).
         /// @param dt Delta time
-        inline void Update(float dt) { m_sysManager.Update(dt); }
+        void Update(float dt);
+        /// Fraction of the fixed step, that was accumulated, but not simulated yet. Use it to interpolate between fixed states.
+        inline float GetFixedAlpha() const { return m_fixedAccumulator / m_FixedTimeStep; }
         /// Call render on all component systems.
         inline void Render() { m_sysManager.Render(); }
 
@@ -137,16 +172,28 @@ namespace Ren {
         SystemsManager m_sysManager;
         // Used for auto passing as argument to systems.
         KeyInterface* m_input;
+        // Time not yet simulated by fixed updates.
+        float m_fixedAccumulator{ 0.0f };
         // Map tag to entities to speed up the search time for entities by tag.
         std::unordered_map<std::string, std::list<entt::entity>> m_tagToEntities{};
         // Map entity to tags to speed up tag searchup.
         std::unordered_map<entt::entity, std::list<std::string>> m_entityToTags{};
+        // Command buffers of all threads, which recorded some commands. Ordered by the first command of the thread.
+        std::vector<std::pair<std::thread::id, Ref<EntityCommandBuffer>>> m_commandBuffers{};
+        std::mutex m_commandBuffersMutex;
 
         // Load texture (into texture cache) when the component is constructed. It will be unloaded when the cache is cleared.
+        // Components constructed with already loaded texture (for ex. prefab instances) are skipped.
         template<typename T>
-        inline void onTextureConstruct(entt::registry& reg, entt::entity ent) { LoadTexture(dynamic_cast<ImgComponent*>(&reg.get<T>(ent))); }
+        inline void onTextureConstruct(entt::registry& reg, entt::entity ent) {
+            ImgComponent* comp = dynamic_cast<ImgComponent*>(&reg.get<T>(ent));
+            if (!comp->GetTextureResource())
+                LoadTexture(comp);
+        }
 
         friend class SceneSerializer;
+        friend class EntityCommandBuffer;
+        friend class SceneSnapshot;
     }; // class Scene
 
     using Entity = Scene::Entity;
@@ -30,10 +30,20 @@ namespace Ren {
         SceneSerializer() {};
 
         static void Serialize(Ref<Scene> scene, std::filesystem::path path);
+        /// Serialize scene split into square chunks (by entity position). Each chunk is saved into its own file
+        /// in `dir`, together with `world.yaml` index file. Such world can be streamed using WorldStreamer.
+        /// Entities without TransformComponent have no position, so they are skipped (with a warning).
+        /// @param dir Full path to the output directory.
+        /// @param chunk_size Size of a single chunk in units.
+        static void SerializeChunks(Ref<Scene> scene, std::filesystem::path dir, float chunk_size);
 
         /// Deserialize scene.
         /// NOTE: Returned scene is NOT initialized.
         static Ref<Scene> Deserialze(std::filesystem::path path, SDL_Renderer* renderer, KeyInterface* input);
+        /// Create entities from serialized entity list (the "Entities" node).
+        /// NOTE: Created entities are NOT initialized.
+        /// @returns Created entities.
+        static std::vector<entt::entity> DeserializeEntities(const YAML::Node& entities, Scene* scene);
     private:
 
         template<typename... TComp>
@@ -0,0 +1,46 @@
+/**
+ * @file Ren/ECS/Serialization/SceneSnapshot.hpp
+ * @brief Declaration of binary scene snapshots.
+ *
+ * Snapshot is a binary image of the whole scene registry (built on entt::snapshot), including tags, Lua script parameters
+ * and state of the physics bodies. It is meant for quick saves, rollback and fast scene reloads, where YAML serialization
+ * is too slow.
+ */
+#pragma once
+#include <vector>
+#include <cstdint>
+#include <filesystem>
+
+#include "Ren/Core/Core.hpp"
+#include "Ren/ECS/Scene.hpp"
+
+namespace Ren {
+    /// Binary snapshot of the scene.
+    ///     - Note: Native scripts are not part of the snapshot, as they are arbitrary C++ objects.
+    ///     - Note: Lua scripts are re-initialized on restore. Only their parameters are restored, not the whole Lua state.
+    class SceneSnapshot {
+    public:
+        /// Take snapshot of the scene. Buffer of the previous snapshot is reused, so it is reallocated only when the scene
+        /// grows. Reading values of Lua script parameters still allocates (for ex. strings).
+        void Take(Scene* scene);
+        /// Replace content of the scene with content of this snapshot. Scene must be initialized.
+        /// Native scripts get OnDestroy() before the scene is cleared. Entities come back without their
+        /// NativeScriptComponent, so bind the scripts again and initialize them with NativeScriptSystem::InitScript().
+        void Restore(Scene* scene) const;
+
+        /// Write snapshot to a binary file.
+        /// @param path Full path to the file.
+        void SaveToFile(std::filesystem::path path) const;
+        /// Read snapshot from a binary file written by SaveToFile().
+        /// @param path Full path to the file.
+        /// @returns False if the file is not a valid snapshot.
+        bool LoadFromFile(std::filesystem::path path);
+
+        /// Size of the snapshot in bytes.
+        inline std::size_t GetSize() const { return m_data.size(); }
+        inline bool Empty() const { return m_data.empty(); }
+
+    private:
+        std::vector<uint8_t> m_data{};
+    };
+} // namespace Ren
@@ -0,0 +1,84 @@
+/**
+ * @file Ren/ECS/Serialization/WorldStreamer.hpp
+ * @brief Declaration of world streaming.
+ *
+ * World is a scene split into square chunks (see SceneSerializer::SerializeChunks()). Only the chunks near the focus
+ * points (usually the camera) are resident in the scene. Others are loaded asynchronously when needed and evicted when
+ * they are far away or when the memory budget is exceeded.
+ */
+#pragma once
+#include <vector>
+#include <future>
+#include <filesystem>
+#include <unordered_map>
+#include <yaml-cpp/yaml.h>
+#include <glm/glm.hpp>
+
+#include "Ren/Core/Core.hpp"
+#include "Ren/ECS/Scene.hpp"
+
+namespace Ren {
+    /// Streams chunks of the world in and out of the scene.
+    ///     - Note: Scene must be initialized (see Scene::Init()) before calling Update().
+    class WorldStreamer {
+    public:
+        using ChunkCoord = glm::ivec2;
+
+        /// Chunks closer than this distance (in units) to any focus point are loaded.
+        float m_LoadDistance{ 50.0f };
+        /// Chunks further than this distance (in units) from all focus points are evicted. Should be bigger than m_LoadDistance.
+        float m_UnloadDistance{ 80.0f };
+        /// Maximum estimated size of resident and loading chunks in bytes. Loads, which would exceed it, are not started
+        /// and the furthest chunks are evicted first when exceeded. Chunks with a focus point inside are loaded anyway.
+        std::size_t m_MemoryBudget{ 32 * 1024 * 1024 };
+
+        /// @param scene Scene to stream the chunks into.
+        /// @param world_dir Directory with serialized world, relative to AssetManager::m_ScenePath.
+        WorldStreamer(Scene* scene, std::filesystem::path world_dir);
+        /// Waits for pending loads. Resident chunks are left in the scene.
+        ~WorldStreamer();
+
+        /// Load and evict chunks based on the focus points. Call once per frame.
+        void Update(const std::vector<glm::vec2>& focus_points);
+        /// Evict all resident chunks.
+        void UnloadAll();
+
+        /// Estimated size of all resident chunks in bytes.
+        inline std::size_t GetResidentBytes() const { return m_residentBytes; }
+        /// Estimated size of the chunks being loaded in bytes.
+        inline std::size_t GetLoadingBytes() const { return m_loadingBytes; }
+        /// Size of a single chunk in units.
+        inline float GetChunkSize() const { return m_chunkSize; }
+        /// Is the chunk resident in the scene?
+        bool IsLoaded(ChunkCoord coord) const;
+
+    private:
+        enum class ChunkState { unloaded, loading, loaded };
+        struct Chunk {
+            ChunkCoord coord{ 0 };
+            std::filesystem::path file{};
+            // Size of the chunk file. Used as an estimate of memory needed by the chunk.
+            std::size_t bytes{ 0 };
+            ChunkState state{ ChunkState::unloaded };
+            // Parsed chunk file, when it is being loaded.
+            std::future<YAML::Node> pending{};
+            // Entities created from this chunk.
+            std::vector<entt::entity> entities{};
+        };
+
+        Scene* m_scene{ nullptr };
+        float m_chunkSize{ 32.0f };
+        std::unordered_map<uint64_t, Chunk> m_chunks{};
+        std::size_t m_residentBytes{ 0 };
+        // Chunks, which are being loaded, count to the budget as well. Otherwise many loads could start in one frame.
+        std::size_t m_loadingBytes{ 0 };
+
+        static inline uint64_t key(ChunkCoord c) { return (uint64_t(uint32_t(c.x)) << 32) | uint64_t(uint32_t(c.y)); }
+        // Distance of the chunk from the closest focus point.
+        float distance(const Chunk& chunk, const std::vector<glm::vec2>& focus_points) const;
+        // Create entities from parsed chunk file and initialize them.
+        void instantiate(Chunk& chunk, const YAML::Node& node);
+        // Destroy all entities of the chunk and release their resources.
+        void evict(Chunk& chunk);
+    };
+} // namespace Ren
@@ -140,12 +140,7 @@ namespace YAML {
             Node n;
             n["name"] = param.m_Name;
             n["type"] = Ren::LUA_PARAM_TYPE_S[(int)param.m_Type];   // String reprezentation of the type.
-            REN_ASSERT(param.m_data.has_value(), "Parameter must have value to be serialized.");
-            switch (param.m_Type) {
-                case Ren::LuaParamType::number: n["value"] = std::any_cast<float>(param.m_data); break;
-                case Ren::LuaParamType::string: n["value"] = std::any_cast<std::string>(param.m_data); break;
-                case Ren::LuaParamType::boolean: n["value"] = std::any_cast<bool>(param.m_data); break;
-            }
+            std::visit([&n](const auto& value) { n["value"] = value; }, param.m_value);
             return n;
         }
         static bool decode(const Node& n, Ren::LuaParam& p) {
@@ -159,18 +154,15 @@ namespace YAML {
             }
 
             p.m_Type = (Ren::LuaParamType)(type_it - type_s.begin());
-            p.m_cachedData = CreateRef<std::any>();
             switch (p.m_Type) {
-                case Ren::LuaParamType::number:
-                    (*p.m_cachedData) = n["value"].as<float>();
-                    break;
-                case Ren::LuaParamType::string:
-                    (*p.m_cachedData) = n["value"].as<std::string>();
-                    break;
-                case Ren::LuaParamType::boolean:
-                    (*p.m_cachedData) = n["value"].as<bool>();
-                    break;
+                case Ren::LuaParamType::number:  p.m_value = n["value"].as<float>(); break;
+                case Ren::LuaParamType::string:  p.m_value = n["value"].as<std::string>(); break;
+                case Ren::LuaParamType::boolean: p.m_value = n["value"].as<bool>(); break;
+                case Ren::LuaParamType::vec2:    p.m_value = n["value"].as<glm::vec2>(); break;
+                case Ren::LuaParamType::vec3:    p.m_value = n["value"].as<glm::vec3>(); break;
+                case Ren::LuaParamType::color:   p.m_value = n["value"].as<glm::ivec3>(); break;
             }
+            p.m_initValue = p.m_value;
 
             return true;
         }
@@ -299,46 +291,100 @@ namespace YAML {
         }
     };
     template<>
+    struct convert<Ren::CollisionLayers> {
+        // Every layer lists names of the layers it collides with.
+        static Node encode(const Ren::CollisionLayers& s) {
+            Node n;
+            for (int32_t a = 0; a < s.Count(); a++) {
+                Node n_layer;
+                n_layer["name"] = s.GetName(a);
+                n_layer["collides"].SetStyle(YAML::EmitterStyle::Flow);
+                for (int32_t b = 0; b < s.Count(); b++)
+                    if (s.Collides(a, b))
+                        n_layer["collides"].push_back(s.GetName(b));
+                n.push_back(n_layer);
+            }
+            return n;
+        }
+        static bool decode(const Node& n, Ren::CollisionLayers& s) {
+            if (!n.IsSequence())
+                return false;
+            s.Clear();
+            // Order of the layers is kept, because fixtures reference them by index.
+            for (auto&& n_layer : n)
+                if (s.Add(n_layer["name"].as<std::string>()) < 0)
+                    LOG_W("Too many collision layers. Layer '" + n_layer["name"].as<std::string>() + "' is ignored.");
+            for (auto&& n_layer : n) {
+                int32_t a = s.Find(n_layer["name"].as<std::string>());
+                if (a < 0)
+                    continue;
+                for (int32_t b = a; b < s.Count(); b++)
+                    s.SetCollides(a, b, false);
+                for (auto&& n_other : n_layer["collides"]) {
+                    int32_t b = s.Find(n_other.as<std::string>());
+                    if (b >= a)
+                        s.SetCollides(a, b, true);
+                }
+            }
+            return true;
+        }
+    };
+    template<>
     struct convert<Ren::RigidBodyComponent> {
         static Node encode(const Ren::RigidBodyComponent& s) {
             Node n;
-            REN_ASSERT(s.p_body, "PhysicsBodyComponent is not initialized. See Scene::InitPhysicsBody().");
+            REN_ASSERT(s.Initialized(), "PhysicsBodyComponent is not initialized. See Scene::InitPhysicsBody().");
 
             n["body_def"] = s.body_def;
-            for (auto&& [p_shape, fix_def] : s.fixtures)
-                n["fixtures"].push_back(fix_def);
+            if (s.static_geometry)
+                n["static_geometry"] = true;
+            if (s.shard >= 0)
+                n["shard"] = s.shard;
+            for (auto&& [shape, def, layer] : s.fixtures) {
+                b2FixtureDef fix_def = def;
+                fix_def.shape = shape.get();
+                Node n_fix;
+                n_fix = fix_def;
+                // Index into the CollisionLayers of the scene.
+                if (layer >= 0)
+                    n_fix["layer"] = layer;
+                n["fixtures"].push_back(n_fix);
+            }
 
             return n;
         }
         static bool decode(const Node& n, Ren::RigidBodyComponent& s) {
             s.body_def = n["body_def"].as<b2BodyDef>();
+            s.static_geometry = n["static_geometry"] && n["static_geometry"].as<bool>();
+            s.shard = n["shard"] ? n["shard"].as<int32_t>() : -1;
 
             for (auto&& n_fix : n["fixtures"])
             {
                 b2FixtureDef fix_def = n_fix.as<b2FixtureDef>();
-                Ref<b2Shape> shape = nullptr;
+                Ren::SharedShape shape;
 
+                // Shapes are interned, so that the same shapes in the file are stored only once.
                 if (n_fix["shape_type"].as<std::string>() == "polygon") {
-                    auto poly_shape = CreateRef<b2PolygonShape>();
+                    b2PolygonShape poly_shape;
                     YAML::Node ys = n_fix["shape"];
-                    poly_shape->m_count = ys["count"].as<int>();
-                    for (int i = 0; i < poly_shape->m_count; i++) {
-                        poly_shape->m_vertices[i] = ys["vertices"][i].as<b2Vec2>();
-                        poly_shape->m_normals[i] = ys["normals"][i].as<b2Vec2>();
+                    poly_shape.m_count = ys["count"].as<int>();
+                    for (int i = 0; i < poly_shape.m_count; i++) {
+                        poly_shape.m_vertices[i] = ys["vertices"][i].as<b2Vec2>();
+                        poly_shape.m_normals[i] = ys["normals"][i].as<b2Vec2>();
                     }
-                    poly_shape->m_centroid = ys["centroid"].as<b2Vec2>();
-                    shape = poly_shape;
+                    poly_shape.m_centroid = ys["centroid"].as<b2Vec2>();
+                    shape = Ren::ShapeLibrary::Intern(poly_shape);
                 }
                 else if (n_fix["shape_type"].as<std::string>() == "circle") {
-                    auto circle_shape = CreateRef<b2CircleShape>();
+                    b2CircleShape circle_shape;
                     YAML::Node ys = n_fix["shape"];
-                    circle_shape->m_radius = ys["radius"].as<float>();
-                    circle_shape->m_p = ys["position"].as<b2Vec2>();
-                    shape = circle_shape;
+                    circle_shape.m_radius = ys["radius"].as<float>();
+                    circle_shape.m_p = ys["position"].as<b2Vec2>();
+                    shape = Ren::ShapeLibrary::Intern(circle_shape);
                 }
 
                 REN_ASSERT(shape, "Fixture has an unknown shape type. Type = " + n_fix["shape_type"].as<std::string>());
-                s.fixtures.push_back({ shape, fix_def });
+                s.fixtures.push_back({ shape, fix_def, n_fix["layer"] ? n_fix["layer"].as<int32_t>() : -1 });
             }
 
             return true;
@@ -54,6 +54,14 @@ namespace Ren {
         // Call Update on all systems.
         inline void Update(float dt) { for (auto&& [sys_id, sys] : m_systems) sys->Update(dt); }
 
+        // Call Update on all systems and call `sync` after each of them.
+        template<typename Func>
+        inline void Update(float dt, Func sync) { for (auto&& [sys_id, sys] : m_systems) { sys->Update(dt); sync(); } }
+
+        // Call FixedUpdate on all systems and call `sync` after each of them.
+        template<typename Func>
+        inline void FixedUpdate(float dt, Func sync) { for (auto&& [sys_id, sys] : m_systems) { sys->FixedUpdate(dt); sync(); } }
+
         // Call Render on all systems.
         inline void Render() { for (auto&& [sys_id, sys] : m_systems) sys->Render(); }
 
@@ -0,0 +1,50 @@
+/**
+ * @file Ren/Physics/CollisionLayers.hpp
+ * @brief Declaration of named collision layers.
+ */
+#pragma once
+#include <array>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <box2d/box2d.h>
+
+namespace Ren {
+    /// Named collision layers of a scene and the matrix of layers, which collide with each other. Every layer is a single
+    /// bit of b2Filter::categoryBits, so there are at most 16 of them. Layer 0 ("default") always exists.
+    class CollisionLayers {
+    public:
+        static constexpr int32_t MAX_LAYERS = 16;
+        static constexpr const char* DEFAULT_LAYER = "default";
+
+        CollisionLayers();
+
+        /// Get index of the layer, it is created if it doesn't exist. New layers collide with all layers.
+        /// @returns Index of the layer or -1, if there are already MAX_LAYERS layers.
+        int32_t Add(const std::string& name);
+        /// @returns Index of the layer or -1, if there is no such layer.
+        int32_t Find(const std::string& name) const;
+        inline const std::string& GetName(int32_t layer) const { return m_names[layer]; }
+        inline int32_t Count() const { return int32_t(m_names.size()); }
+        /// Remove all layers except the default one and make everything collide again.
+        void Clear();
+
+        /// Set, whether the two layers collide (the matrix is symmetric).
+        void SetCollides(int32_t a, int32_t b, bool collides);
+        inline bool Collides(int32_t a, int32_t b) const { return m_masks[a] & (1 << b); }
+        /// Layers colliding with the layer as b2Filter::maskBits.
+        inline uint16 GetMask(int32_t layer) const { return m_masks[layer]; }
+        /// Filter of fixtures in the layer.
+        inline b2Filter GetFilter(int32_t layer, int16 group_index = 0) const {
+            b2Filter filter;
+            filter.categoryBits = uint16(1 << layer);
+            filter.maskBits = m_masks[layer];
+            filter.groupIndex = group_index;
+            return filter;
+        }
+
+    private:
+        std::vector<std::string> m_names;
+        std::array<uint16, MAX_LAYERS> m_masks;
+    };
+}
@@ -0,0 +1,53 @@
+/**
+ * @file Ren/Physics/DebugDraw.hpp
+ * @brief Declaration of Box2D debug drawing into a geometry batch.
+ */
+#pragma once
+#include <vector>
+#include <glm/glm.hpp>
+#include <box2d/box2d.h>
+
+#include "Ren/Renderer/GeometryBatch.hpp"
+
+namespace Ren {
+    /// Implementation of b2Draw, which streams all shapes into a single GeometryBatch.
+    /// Unlike b2World::DebugDraw(), only the part of the world inside the given view is drawn (culled using the broad-phase).
+    class PhysicsDebugDraw : public b2Draw {
+    public:
+        // Number of segments used to approximate circles.
+        int32_t m_CircleSegments{ 16 };
+        // Alpha of the filled shapes (0-255).
+        int32_t m_FillAlpha{ 128 };
+
+        /// Append the part of the world, which overlaps the view (in unit-space), to the batch.
+        /// What is drawn is controlled by b2Draw::SetFlags() (shapes, joints, AABBs and centers of mass).
+        void Draw(b2World& world, const glm::vec2& view_min, const glm::vec2& view_max);
+        inline GeometryBatch& GetBatch() { return m_batch; }
+        /// Call before drawing a new frame.
+        inline void Clear() { m_batch.Clear(); }
+
+        /* b2Draw interface */
+
+        void DrawPolygon(const b2Vec2* vertices, int32 vertexCount, const b2Color& color) override;
+        void DrawSolidPolygon(const b2Vec2* vertices, int32 vertexCount, const b2Color& color) override;
+        void DrawCircle(const b2Vec2& center, float radius, const b2Color& color) override;
+        void DrawSolidCircle(const b2Vec2& center, float radius, const b2Vec2& axis, const b2Color& color) override;
+        void DrawSegment(const b2Vec2& p1, const b2Vec2& p2, const b2Color& color) override;
+        void DrawTransform(const b2Transform& xf) override;
+        /// @param size Size of the point in pixels.
+        void DrawPoint(const b2Vec2& p, float size, const b2Color& color) override;
+
+    private:
+        GeometryBatch m_batch;
+        // Pixels per unit of the current camera. Used for DrawPoint().
+        float m_pixelsPerUnit{ 1.0f };
+        // Chain fixtures are reported once per edge by the broad-phase, so remember which were already drawn.
+        std::vector<const b2Fixture*> m_drawnChains;
+
+        // Draw single fixture of the body with transform `xf`.
+        void drawFixture(const b2Fixture* fixture, const b2Transform& xf, const b2Color& color);
+        inline Color4 toColor(const b2Color& c, float alpha = 1.0f) const {
+            return Color4(int32_t(c.r * 255.0f), int32_t(c.g * 255.0f), int32_t(c.b * 255.0f), int32_t(c.a * alpha * 255.0f));
+        }
+    };
+}
@@ -5,6 +5,7 @@
 #pragma once
 #include <cstdint>
 #include <glm/glm.hpp>
+#include <entt/entt.hpp>
 
 #include "box2d/box2d.h"
 
@@ -12,5 +13,55 @@ namespace Ren {
     namespace Utils {
         inline glm::vec2 to_vec2(const b2Vec2& vec) { return *(glm::vec2*)(&vec); }
         inline b2Vec2 to_b2Vec2(const glm::vec2& vec) { return *(b2Vec2*)(&vec); }
+
+        // Entity is stored directly in the body user data. It is offset by one, so that 0 means "no entity".
+        inline uintptr_t to_user_data(entt::entity ent) { return uintptr_t(entt::to_integral(ent)) + 1; }
+        inline entt::entity to_entity(uintptr_t user_data) { return user_data ? entt::entity(user_data - 1) : entt::entity(entt::null); }
+        inline entt::entity body_entity(const b2Body* body) { return to_entity(body->GetUserData().pointer); }
     }
+
+    enum class ContactEventType : uint8_t { begin, end, pre_solve, post_solve };
+
+    /// Contact recorded during the physics step. Everything is copied, so the event is valid after the step
+    /// (unlike b2Contact) and the world can be modified while handling it.
+    struct ContactEvent {
+        ContactEventType type;
+        entt::entity a{ entt::null }, b{ entt::null };
+        // True, if any of the fixtures is a sensor.
+        bool sensor{ false };
+        // Contact normal pointing from a to b in world coordinates. Not set for end events.
+        b2Vec2 normal{ 0.0f, 0.0f };
+        // Contact points in world coordinates. Not set for end events.
+        b2Vec2 points[b2_maxManifoldPoints]{};
+        int32_t point_count{ 0 };
+        // Impulses applied to resolve the contact (post solve only).
+        float normal_impulses[b2_maxManifoldPoints]{};
+        float tangent_impulses[b2_maxManifoldPoints]{};
+    };
+
+    /// Ray for PhysicsSystem::RaycastBatch(). The closest fixture on the segment is reported.
+    struct RaycastQuery {
+        b2Vec2 from{ 0.0f, 0.0f };
+        b2Vec2 to{ 0.0f, 0.0f };
+        // Only fixtures, whose category bits overlap the mask, are hit (see CollisionLayers::GetFilter()).
+        uint16_t mask{ 0xFFFF };
+        // Entity ignored by the ray (for ex. the one casting it).
+        entt::entity ignore{ entt::null };
+        bool hit_sensors{ false };
+    };
+    struct RaycastHit {
+        bool hit{ false };
+        // Entity of the hit fixture (merged static geometry is resolved as well). Can be null for bodies without entity.
+        entt::entity ent{ entt::null };
+        b2Vec2 point{ 0.0f, 0.0f };
+        b2Vec2 normal{ 0.0f, 0.0f };
+        // Position of the hit on the segment (0 at `from`, 1 at `to`).
+        float fraction{ 1.0f };
+    };
+    /// Box for PhysicsSystem::OverlapBatch(). Entities with any fixture, whose bounding box overlaps the box, are reported.
+    struct OverlapQuery {
+        b2AABB aabb{};
+        uint16_t mask{ 0xFFFF };
+        entt::entity ignore{ entt::null };
+    };
 }
@@ -0,0 +1,97 @@
+/**
+ * @file Ren/Physics/ShapeLibrary.hpp
+ * @brief Declaration of interned Box2D shapes and pooled fixture lists.
+ */
+#pragma once
+#include <atomic>
+#include <cstdint>
+#include <utility>
+#include <box2d/box2d.h>
+
+namespace Ren {
+    /// Handle to a shape interned in ShapeLibrary. Copying only bumps a reference count. Shapes are immutable.
+    class SharedShape {
+    public:
+        SharedShape() = default;
+        SharedShape(const SharedShape& other);
+        SharedShape(SharedShape&& other) noexcept : m_entry(other.m_entry) { other.m_entry = nullptr; }
+        SharedShape& operator=(SharedShape other) noexcept { std::swap(m_entry, other.m_entry); return *this; }
+        ~SharedShape();
+
+        const b2Shape* get() const;
+        inline const b2Shape* operator->() const { return get(); }
+        inline explicit operator bool() const { return m_entry != nullptr; }
+        inline bool operator==(const SharedShape& other) const { return m_entry == other.m_entry; }
+
+        // Defined in ShapeLibrary.cpp.
+        struct Entry;
+    private:
+        Entry* m_entry{ nullptr };
+
+        explicit SharedShape(Entry* entry);
+
+        friend class ShapeLibrary;
+    };
+
+    /// Interns shapes by value, so that identical shapes (for ex. thousands of crates) are stored only once.
+    /// Unused shapes are kept until ReleaseUnused() is called.
+    class ShapeLibrary {
+    public:
+        /// Get shared instance of the shape. Supports circles, edges, polygons and chains.
+        static SharedShape Intern(const b2Shape& shape);
+        /// Box with half sizes `hx` and `hy`.
+        static SharedShape Box(float hx, float hy, const b2Vec2& center = { 0.0f, 0.0f }, float angle = 0.0f);
+        static SharedShape Circle(float radius, const b2Vec2& center = { 0.0f, 0.0f });
+        /// Convex hull of the points (see b2PolygonShape::Set()).
+        static SharedShape Polygon(const b2Vec2* points, int32 count);
+
+        /// Remove shapes, which are not referenced by any handle.
+        static void ReleaseUnused();
+        /// Number of unique shapes in the library.
+        static std::size_t Size();
+    };
+
+    /// Fixture of a rigid body. `def.shape` is ignored, `shape` is used instead.
+    struct Fixture {
+        SharedShape shape;
+        b2FixtureDef def;
+        // Collision layer of the scene (see CollisionLayers). It replaces `def.filter` (except the group index).
+        // -1 means `def.filter` is used as is.
+        int32_t layer{ -1 };
+    };
+
+    /// List of fixtures stored in a pooled block. Copies share the block (for ex. all instances of a prefab),
+    /// which is copied only when a shared list is modified.
+    class FixtureList {
+    public:
+        FixtureList() = default;
+        FixtureList(const FixtureList& other);
+        FixtureList(FixtureList&& other) noexcept : m_block(other.m_block) { other.m_block = nullptr; }
+        FixtureList& operator=(FixtureList other) noexcept { std::swap(m_block, other.m_block); return *this; }
+        ~FixtureList();
+
+        void push_back(const Fixture& fixture);
+        inline void Add(SharedShape shape, const b2FixtureDef& def = {}, int32_t layer = -1) { push_back({ std::move(shape), def, layer }); }
+        /// Set collision layer of the fixture at `index` (or of all fixtures, if `index` is -1).
+        void SetLayer(int32_t index, int32_t layer);
+        void reserve(std::size_t capacity);
+        void clear();
+
+        std::size_t size() const;
+        inline bool empty() const { return size() == 0; }
+        const Fixture* begin() const;
+        inline const Fixture* end() const { return begin() + size(); }
+        inline const Fixture& operator[](std::size_t i) const { return begin()[i]; }
+
+        /// Number of bytes held by the pool (both used and free blocks).
+        static std::size_t PoolBytes();
+
+        // Defined in ShapeLibrary.cpp.
+        struct Block;
+    private:
+        Block* m_block{ nullptr };
+
+        // Make sure, that the block is not shared and has room for `capacity` fixtures.
+        void makeUnique(std::size_t capacity);
+    };
+}
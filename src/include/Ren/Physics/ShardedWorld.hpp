@@ -0,0 +1,102 @@
+/**
+ * @file Ren/Physics/ShardedWorld.hpp
+ * @brief Declaration of physics world split into shards stepped in parallel.
+ */
+#pragma once
+#include <cstdint>
+#include <optional>
+#include <vector>
+#include <box2d/box2d.h>
+#include <entt/entt.hpp>
+
+#include "Ren/Core/Core.hpp"
+#include "Ren/Core/ThreadPool.hpp"
+#include "Ren/Physics/Physics.hpp"
+
+namespace Ren {
+    class StaticGeometry;
+
+    /// Physics simulation split into shards. Every shard is an independent b2World, so the shards are stepped in parallel.
+    /// Bodies don't interact across shards. Shard 0 holds everything, what doesn't belong to another shard.
+    /// Contacts of all shards are recorded as ContactEvents and collected in shard order after the step.
+    class ShardedWorld {
+    public:
+        /// State of a body before and after a step (see StepTracked()).
+        struct BodyState {
+            entt::entity ent{ entt::null };
+            b2Vec2 prev_position{ 0.0f, 0.0f };
+            float prev_angle{ 0.0f };
+            b2Vec2 position{ 0.0f, 0.0f };
+            float angle{ 0.0f };
+        };
+        /// Body moved into another shard by Migrate().
+        struct Migration {
+            // New body in the target shard.
+            b2Body* body{ nullptr };
+            // Replaced body. It is disabled, when Migrate() keeps it, and null otherwise.
+            b2Body* old_body{ nullptr };
+        };
+
+        /// Record pre-solve and post-solve events (see PhysicsSystem::m_RecordSolveEvents).
+        bool m_RecordSolveEvents{ true };
+
+        /// @param static_geometry Merged static geometry, whose entities are resolved in contact events.
+        ShardedWorld(const StaticGeometry& static_geometry, const b2Vec2& gravity);
+        ShardedWorld(const ShardedWorld&) = delete;
+        ShardedWorld& operator=(const ShardedWorld&) = delete;
+
+        /// Add a shard. Dynamic bodies inside `region` belong to it. Shards without region hold only bodies assigned
+        /// to them explicitly. Returns index of the shard.
+        uint32_t Add(std::optional<b2AABB> region = std::nullopt);
+        /// Destroy all shards together with their bodies.
+        void Clear();
+        inline std::size_t Size() const { return m_shards.size(); }
+        inline b2World* GetWorld(std::size_t shard) const { return shard < m_shards.size() ? m_shards[shard].world.get() : nullptr; }
+        /// Worlds of all shards in order.
+        inline const std::vector<b2World*>& GetWorlds() const { return m_worlds; }
+        /// Shard with the region containing the position (0, if there is none).
+        uint32_t ShardAt(const b2Vec2& position) const;
+
+        /// Step all shards in parallel on `pool`.
+        void Step(ThreadPool& pool, float dt, int32_t velocity_iterations, int32_t position_iterations);
+        /// Step all shards and write states of the non-static bodies, which were awake before or after the step, into
+        /// `states`. Bodies, which fell asleep in the step, end at their final state. Bodies woken up by the step are
+        /// not interpolated. Disabled bodies are skipped.
+        void StepTracked(ThreadPool& pool, float dt, int32_t velocity_iterations, int32_t position_iterations, std::vector<BodyState>& states);
+        /// Move awake bodies without joints, which left the region of their shard, into the shard they are in now.
+        /// Old bodies are destroyed, or only disabled, if `keep_old` is true (for ex. when a component still points to them).
+        void Migrate(bool keep_old, std::vector<Migration>& migrated);
+        /// Append contact events recorded by the shards since the last call.
+        void CollectContacts(std::vector<ContactEvent>& out);
+
+    private:
+        class ContactRecorder : public b2ContactListener {
+            ShardedWorld* m_world{ nullptr };
+            uint32_t m_shard{ 0 };
+        public:
+            ContactRecorder(ShardedWorld* world, uint32_t shard) : m_world(world), m_shard(shard) {}
+
+            void BeginContact(b2Contact* contact) override;
+            void EndContact(b2Contact* contact) override;
+            void PreSolve(b2Contact* contact, const b2Manifold* oldManifold) override;
+            void PostSolve(b2Contact* contact, const b2ContactImpulse* impulse) override;
+        };
+        struct Shard {
+            Ref<b2World> world;
+            Ref<ContactRecorder> listener;
+            std::optional<b2AABB> region;
+            // Contact events recorded by this shard.
+            std::vector<ContactEvent> contacts;
+        };
+
+        const StaticGeometry& m_staticGeometry;
+        b2Vec2 m_gravity;
+        std::vector<Shard> m_shards;
+        std::vector<b2World*> m_worlds;
+        // Bodies awake before the current step (StepTracked() only).
+        std::vector<b2Body*> m_awake;
+
+        // Append event to the contacts of the shard.
+        void recordContact(uint32_t shard, ContactEventType type, b2Contact* contact, const b2ContactImpulse* impulse = nullptr);
+    };
+}
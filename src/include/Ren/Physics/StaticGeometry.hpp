@@ -0,0 +1,81 @@
+/**
+ * @file Ren/Physics/StaticGeometry.hpp
+ * @brief Declaration of static geometry merged from tiles.
+ */
+#pragma once
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include <box2d/box2d.h>
+#include <entt/entt.hpp>
+
+namespace Ren {
+    /// Static entities made of axis-aligned boxes (tiles) merged into a single body per material. Touching boxes are
+    /// merged into bigger ones, so a tile level has a few bodies and proxies instead of one per tile.
+    /// Merged entities have no body of their own, they are found through an index of their boxes (see Query()).
+    ///  - Note: Tiles are added and removed by the game, while queries and contact callbacks read them during the step.
+    ///          Modify the geometry only under PhysicsSystem::LockWorld().
+    class StaticGeometry {
+    public:
+        /// New content of a group body. Created by Rebuild() and applied by Apply() on the thread stepping the world.
+        struct GroupUpdate {
+            uint32_t group{ 0 };
+            uint32_t shard{ 0 };
+            b2FixtureDef def;
+            std::vector<b2AABB> boxes;
+        };
+
+        StaticGeometry() = default;
+        StaticGeometry(const StaticGeometry&) = delete;
+        StaticGeometry& operator=(const StaticGeometry&) = delete;
+
+        /// Merge the entity into the geometry of `shard`. `fixtures` are the fixture definitions of the body (with shapes).
+        /// @returns False, if it can't be merged (it is not a static body with zero angle made of axis-aligned boxes).
+        bool Add(entt::entity ent, const b2BodyDef& body_def, const std::vector<b2FixtureDef>& fixtures, uint32_t shard);
+        void Remove(entt::entity ent);
+        /// Remove all entities. Bodies of the groups are not destroyed, they are released together with the worlds.
+        void Clear();
+        inline bool Contains(entt::entity ent) const { return m_tiles.count(ent) > 0; }
+        inline bool Empty() const { return m_tiles.empty(); }
+        inline std::size_t Size() const { return m_tiles.size(); }
+
+        /// Merge boxes of the groups changed since the last call.
+        std::vector<GroupUpdate> Rebuild();
+        /// Replace body of the group with the merged boxes.
+        void Apply(b2World& world, const GroupUpdate& update);
+
+        /// Call `func(entity)` for every merged entity overlapping the box, until it returns false.
+        void Query(const b2AABB& aabb, const std::function<bool(entt::entity)>& func) const;
+        /// Union of category bits of the fixtures of the merged entity.
+        uint16_t GetCategoryBits(entt::entity ent) const;
+
+    private:
+        // Entity merged into static geometry.
+        struct Tile {
+            // Boxes of the fixtures in world space and the groups they are merged into.
+            std::vector<std::pair<uint32_t, b2AABB>> boxes;
+            // Proxies of the boxes in m_index.
+            std::vector<int32_t> proxies;
+        };
+        // Static geometry with the same material. It is merged into a single body.
+        struct Group {
+            b2FixtureDef def;
+            // Shard the body of the group is created in.
+            uint32_t shard{ 0 };
+            std::vector<entt::entity> tiles;
+            bool dirty{ false };
+        };
+
+        std::unordered_map<entt::entity, Tile> m_tiles;
+        std::vector<Group> m_groups;
+        // Group of the material (bytes of the fixture definition).
+        std::unordered_map<std::string, uint32_t> m_groupIds;
+        bool m_dirty{ false };
+        // Boxes of the merged entities (user data is the entity).
+        b2DynamicTree m_index;
+        // Bodies of the groups. Modified only by Apply().
+        std::vector<b2Body*> m_bodies;
+    };
+}
@@ -21,10 +21,19 @@ extern "C" {
 #include "Ren/Core/GameCore.hpp"
 #include "Ren/Core/Layer.hpp"
 #include "Ren/Core/AssetManager.hpp"
+#include "Ren/Core/ThreadPool.hpp"
+#include "Ren/Core/TripleBuffer.hpp"
 
 #include "ECS/Scene.hpp"
+#include "ECS/Prefab.hpp"
+#include "ECS/CommandBuffer.hpp"
 #include "Scripting/NativeScript.hpp"
+#include "Scripting/LuaAllocator.hpp"
+#include "Scripting/LuaChunkCache.hpp"
+#include "Scripting/LuaProfiler.hpp"
 #include "ECS/Serialization/SceneSerializer.hpp"
+#include "ECS/Serialization/WorldStreamer.hpp"
+#include "ECS/Serialization/SceneSnapshot.hpp"
 
 #include "Utils/FpsCounter.hpp"
 
@@ -32,3 +41,8 @@ extern "C" {
 #include "Renderer/TextRenderer.hpp"
 
 #include "Ren/Physics/Physics.hpp"
+#include "Ren/Physics/DebugDraw.hpp"
+#include "Ren/Physics/ShapeLibrary.hpp"
+#include "Ren/Physics/CollisionLayers.hpp"
+#include "Ren/Physics/StaticGeometry.hpp"
+#include "Ren/Physics/ShardedWorld.hpp"
@@ -31,6 +31,7 @@ namespace Ren {
 
         // Set viewport size in pixels. Commonly this is a size of a game viewport (fullscreen -> window size).
         inline void SetViewportSize(const glm::ivec2& size) { m_viewportSize = size; }
+        inline const glm::ivec2& GetViewportSize() const { return m_viewportSize; }
         // How many pixels represents a single unit.
         void SetUnitScale(uint32_t pixels_per_unit);
         // How many pixels represents a single unit (with and height).
@@ -0,0 +1,48 @@
+/**
+ * @file Ren/Renderer/GeometryBatch.hpp
+ * @brief Declaration of geometry batch, which is rendered with a single draw call.
+ */
+#pragma once
+extern "C" {
+    #include <SDL.h>
+}
+#include <vector>
+#include <glm/glm.hpp>
+
+#include "Ren/Core/Core.hpp"
+
+namespace Ren {
+    /// Lines and triangles in unit-space, which are rendered by a single draw call (Renderer::DrawBatch()).
+    /// Keep the batch alive between frames and Clear() it, so that its memory is reused.
+    struct GeometryBatch {
+        struct LineVertex {
+            glm::vec2 pos;
+            SDL_Color color;
+        };
+        // Vertices of filled triangles (3 per triangle). Positions are in unit-space.
+        std::vector<SDL_Vertex> triangles;
+        // End points of lines (2 per line). Lines are always 1 pixel wide, so they are expanded when rendered.
+        std::vector<LineVertex> lines;
+        // Vertices in pixel-space, which are passed to the renderer. Filled when the batch is rendered.
+        std::vector<SDL_Vertex> pixel_vertices;
+
+        inline static SDL_Color ToSDL(const Color4& c) { return { Uint8(c.r), Uint8(c.g), Uint8(c.b), Uint8(c.a) }; }
+
+        inline void AddLine(const glm::vec2& a, const glm::vec2& b, const Color4& color) {
+            SDL_Color c = ToSDL(color);
+            lines.push_back({ a, c });
+            lines.push_back({ b, c });
+        }
+        inline void AddTriangle(const glm::vec2& a, const glm::vec2& b, const glm::vec2& c, const Color4& color) {
+            SDL_Color col = ToSDL(color);
+            triangles.push_back({ { a.x, a.y }, col, { 0.0f, 0.0f } });
+            triangles.push_back({ { b.x, b.y }, col, { 0.0f, 0.0f } });
+            triangles.push_back({ { c.x, c.y }, col, { 0.0f, 0.0f } });
+        }
+        inline void Clear() {
+            triangles.clear();
+            lines.clear();
+        }
+        inline bool Empty() const { return triangles.empty() && lines.empty(); }
+    };
+}
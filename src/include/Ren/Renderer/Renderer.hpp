@@ -8,6 +8,7 @@
 
 #include "RenderCommand.hpp"
 #include "Ren/Renderer/Camera.hpp"
+#include "Ren/Renderer/GeometryBatch.hpp"
 #include "Ren/RenSDL/Texture.hpp"
 
 namespace Ren {
@@ -24,6 +25,12 @@ namespace Ren {
             m_cameraInvPV = glm::inverse(m_cameraPV);
             m_renderTarget = render_target;
 
+            // Visible area in unit-space. Pixel-space y may be flipped, so take min and max of the corners.
+            glm::vec2 corner_a = m_camera->ToUnitsPre(glm::vec2(0.0f), m_cameraInvPV);
+            glm::vec2 corner_b = m_camera->ToUnitsPre(glm::vec2(m_camera->GetViewportSize()), m_cameraInvPV);
+            m_viewMin = glm::min(corner_a, corner_b);
+            m_viewMax = glm::max(corner_a, corner_b);
+
             if (render_target)
                 SDL_SetRenderTarget(m_renderer, render_target->m_Texture);
         }
@@ -45,6 +52,17 @@ namespace Ren {
         static void DrawCircle(const Ren::Rect& rect, const Ren::Color4& color, uint32_t precision = 32);
         static void DrawCircle(const glm::vec2& pos, float radius, const Ren::Color4& color, uint32_t precision = 32);
         static void DrawLine(const glm::vec2& p1, const glm::vec2& p2, const Ren::Color4& color);
+        // Render all lines and triangles of the batch with a single draw call.
+        // Batch is not copied, so it must stay alive (and unchanged) until Render() is called.
+        static void DrawBatch(GeometryBatch* batch);
+
+        // Visible area of the current camera in unit-space (updated in BeginRender()).
+        inline static const glm::vec2& GetViewMin() { return m_viewMin; }
+        inline static const glm::vec2& GetViewMax() { return m_viewMax; }
+        // Returns true, if the box given by its corners in unit-space overlaps the visible area.
+        inline static bool InView(const glm::vec2& min, const glm::vec2& max) {
+            return min.x <= m_viewMax.x && max.x >= m_viewMin.x && min.y <= m_viewMax.y && max.y >= m_viewMin.y;
+        }
 
         // Executes all render commands, that were submitted earlier.
         // TODO: Rendering optimizations like culling
@@ -73,6 +91,8 @@ namespace Ren {
         inline static Camera* m_camera{ nullptr };
         inline static glm::mat4 m_cameraPV{ 1.0f };
         inline static glm::mat4 m_cameraInvPV{ 1.0f };
+        inline static glm::vec2 m_viewMin{ 0.0f };
+        inline static glm::vec2 m_viewMax{ 0.0f };
     };
 
     inline static glm::vec2 UpDir() { return Renderer::GetCamera()->UpDir(); }
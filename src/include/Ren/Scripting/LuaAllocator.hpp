@@ -0,0 +1,75 @@
+/**
+ * @file Ren/Scripting/LuaAllocator.hpp
+ * @brief Declaration of pooled memory allocator for lua states.
+ */
+#pragma once
+#include <array>
+#include <cstddef>
+#include <vector>
+#include <sol/sol.hpp>
+
+#include "Ren/Core/Core.hpp"
+
+namespace Ren {
+    /// Memory allocator (lua_Alloc) of a single lua state. Small blocks (strings, tables, closures, ...) are taken from
+    /// free lists of size classes, which are carved from larger pages. Bigger blocks are allocated with malloc.
+    /// Pages are returned to the system only when the allocator is destroyed.
+    ///     - Note: Not thread-safe. That is fine, because lua state can't be used by more threads at once anyway.
+    class LuaAllocator {
+    public:
+        /// Granularity of the size classes in bytes.
+        static constexpr std::size_t CLASS_SIZE = 16;
+        /// Largest pooled block in bytes.
+        static constexpr std::size_t MAX_POOLED = 512;
+        /// Size of a page, from which the pooled blocks are carved.
+        static constexpr std::size_t PAGE_SIZE = 64 * 1024;
+
+        struct Stats {
+            // Bytes used by lua (same as sol::state::memory_used()).
+            std::size_t used{ 0 };
+            // Highest `used` so far.
+            std::size_t peak{ 0 };
+            // Bytes of the pool pages (both used and free blocks).
+            std::size_t pooled{ 0 };
+            // Number of allocations and reallocations, which had to move the block.
+            std::size_t allocations{ 0 };
+        };
+
+        LuaAllocator() = default;
+        LuaAllocator(const LuaAllocator&) = delete;
+        LuaAllocator& operator=(const LuaAllocator&) = delete;
+        ~LuaAllocator();
+
+        /// Create lua state with its own allocator. The allocator is destroyed together with the state.
+        static Ref<sol::state> CreateState();
+        /// Allocator of the state or nullptr, if the state was not created by CreateState().
+        static LuaAllocator* Get(lua_State* L);
+
+        inline const Stats& GetStats() const { return m_stats; }
+
+        /// The lua_Alloc function, `ud` is the allocator.
+        static void* Alloc(void* ud, void* ptr, std::size_t osize, std::size_t nsize);
+
+    private:
+        static constexpr std::size_t CLASS_COUNT = MAX_POOLED / CLASS_SIZE;
+
+        // Free block stores pointer to the next free block of its size class.
+        struct FreeBlock {
+            FreeBlock* next;
+        };
+
+        std::array<FreeBlock*, CLASS_COUNT> m_free{};
+        std::vector<char*> m_pages;
+        // Not yet used part of the last page.
+        char* m_pageBegin{ nullptr };
+        char* m_pageEnd{ nullptr };
+        Stats m_stats;
+
+        void* allocate(std::size_t size);
+        void deallocate(void* ptr, std::size_t size);
+        void* reallocate(void* ptr, std::size_t osize, std::size_t nsize);
+
+        // Index of the size class for block of `size` bytes (1 to MAX_POOLED).
+        static inline std::size_t size_class(std::size_t size) { return (size - 1) / CLASS_SIZE; }
+    };
+}
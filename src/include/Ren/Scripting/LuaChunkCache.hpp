@@ -0,0 +1,45 @@
+/**
+ * @file Ren/Scripting/LuaChunkCache.hpp
+ * @brief Declaration of the cache of compiled Lua chunks.
+ */
+#pragma once
+#include <cstdint>
+#include <filesystem>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <sol/sol.hpp>
+
+namespace Ren {
+    /// Cache of compiled Lua files shared by all lua states. Every file is compiled only once (or when it is modified,
+    /// which is detected by its modification time and size) and its bytecode (string.dump) is kept in memory, so loading a script for another entity or another scene
+    /// only loads the bytecode without parsing.
+    ///
+    /// If there is a precompiled `.luac` file next to the script (see Precompile()), which is not older than the script,
+    /// it is loaded instead of the source.
+    class LuaChunkCache {
+    public:
+        /// Load the file as a new function (chunk) into the state. Globals of the chunk are the globals of the state,
+        /// use sol::set_environment() to change them.
+        static sol::load_result Load(sol::state_view lua, const std::filesystem::path& path);
+        /// Write the bytecode of the script into `.luac` file next to it.
+        /// @returns False if the script can't be compiled or the file can't be written.
+        static bool Precompile(const std::filesystem::path& path);
+        /// Precompile all `.lua` files in the directory and its subdirectories.
+        /// @returns Number of precompiled files.
+        static std::size_t PrecompileDir(const std::filesystem::path& dir);
+
+        static void Clear();
+        /// Number of cached files.
+        static std::size_t Size();
+
+    private:
+        struct Entry {
+            std::filesystem::file_time_type time;
+            std::uintmax_t size{ 0 };
+            std::string bytecode;
+        };
+        inline static std::mutex ms_mutex;
+        inline static std::unordered_map<std::string, Entry> ms_entries;
+    };
+}
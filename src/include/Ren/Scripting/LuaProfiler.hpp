@@ -0,0 +1,105 @@
+/**
+ * @file Ren/Scripting/LuaProfiler.hpp
+ * @brief Declaration of sampling profiler and instruction limits of lua states.
+ */
+#pragma once
+#include <chrono>
+#include <cstdint>
+#include <filesystem>
+#include <string>
+#include <unordered_map>
+#include <entt/entt.hpp>
+#include <sol/sol.hpp>
+
+namespace Ren {
+    /// Budget of a script for a single call of OnUpdate() or OnFixedUpdate() (see LuaScriptSystem::SetBudget()).
+    struct LuaBudget {
+        // Script taking longer is throttled. It skips as many following calls as the times it exceeded the budget
+        // (at most MAX_SKIP) and then gets the whole skipped time as delta time. 0 means no limit.
+        float time_ms{ 0.0f };
+        // Call running more instructions is aborted with an error. Protects the game loop from infinite loops. 0 means no limit.
+        // Coroutines of the script, which are resumed by the scheduler, get the same limit for each resume.
+        uint32_t instructions{ 0 };
+
+        static constexpr int32_t MAX_SKIP = 30;
+
+        inline bool Active() const { return time_ms > 0.0f || instructions > 0; }
+    };
+
+    /// Throttling of a script method by its LuaBudget.
+    struct LuaThrottle {
+        // Number of calls to skip.
+        int32_t skip{ 0 };
+        // Delta time of the skipped calls, which is passed to the next call.
+        float dt{ 0.0f };
+    };
+
+    /// Owns the debug hook (lua_sethook()) of a lua state. The count hook is used to sample the running functions and
+    /// to abort calls, which exceed their instruction limit. Hook is removed, when neither of them is needed.
+    /// Coroutines have their own hook, so the scheduler applies the current one with PrepareThread() before resuming them.
+    ///     - Note: Not thread-safe. Each lua state has its own profiler (see LuaScriptSystem).
+    class LuaProfiler {
+    public:
+        /// Time and number of samples (functions) or calls (scripts and entities).
+        struct Entry {
+            double ms{ 0.0 };
+            uint64_t count{ 0 };
+        };
+        struct Report {
+            // Key is "file:line function" of the function definition.
+            std::unordered_map<std::string, Entry> functions;
+            // Key is path of the script file.
+            std::unordered_map<std::string, Entry> scripts;
+            std::unordered_map<entt::entity, Entry> entities;
+
+            /// Add entries of the other report.
+            void Merge(const Report& other);
+            /// Write all entries as CSV (kind,name,ms,count) sorted by time.
+            /// @returns False, if the file couldn't be written.
+            bool Export(const std::filesystem::path& path) const;
+        };
+
+        explicit LuaProfiler(lua_State* L);
+        LuaProfiler(const LuaProfiler&) = delete;
+        LuaProfiler& operator=(const LuaProfiler&) = delete;
+        ~LuaProfiler();
+
+        /// Sample the running function every `instructions` instructions. Time since the previous sample is attributed to it.
+        void SetSampling(bool sampling, uint32_t instructions = 1000);
+        inline bool IsSampling() const { return m_sampling; }
+
+        /// Call before calling into lua. If `instruction_limit` is not 0, the call raises an error after executing
+        /// that many instructions.
+        void BeginCall(uint32_t instruction_limit = 0);
+        void EndCall();
+        /// Call before resuming a coroutine `co` of the state. It gets the hook of the current call, so its instructions
+        /// count to the limit of the call. If no call with a limit is running and `instruction_limit` is not 0, a call
+        /// with that limit is started.
+        /// @returns True, if a call was started. It has to be ended with EndCall() once the coroutine yields.
+        bool PrepareThread(lua_State* co, uint32_t instruction_limit = 0);
+        /// Attribute time of a script call to its file and entity.
+        void AddScriptCall(const std::string& script, entt::entity ent, double ms);
+
+        inline const Report& GetReport() const { return m_report; }
+        inline void Reset() { m_report = Report{}; }
+
+        /// Profiler of the state (or of the state of the coroutine) or nullptr, if it has none.
+        static LuaProfiler* Get(lua_State* L);
+
+    private:
+        using Clock = std::chrono::steady_clock;
+
+        lua_State* m_L;
+        bool m_sampling{ false };
+        uint32_t m_sampleInstructions{ 1000 };
+        // Instruction limit of the current call and instructions counted so far.
+        uint32_t m_limit{ 0 };
+        uint64_t m_executed{ 0 };
+        Clock::time_point m_lastSample;
+        Report m_report;
+
+        // Set hook of the state according to the sampling and current limit.
+        void updateHook();
+        static void hook(lua_State* L, lua_Debug* ar);
+    };
+}
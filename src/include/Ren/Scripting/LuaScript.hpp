@@ -6,20 +6,23 @@
 #include <vector>
 #include <string>
 #include <filesystem>
-#include <any>
 #include <sol/sol.hpp>
 #include <optional>
-#include <any>
+#include <variant>
 #include <array>
+#include <glm/glm.hpp>
 #include <yaml-cpp/yaml.h>
 
 #include "Ren/ECS/Scene.hpp"
 #include "Ren/Core/Input.hpp"
+#include "Ren/Scripting/LuaProfiler.hpp"
 
 namespace Ren {
-    // We expose only basic types for simplicity.
-    enum class LuaParamType : int { number = 0, string, boolean };
-    const static std::array<const char*, 3> LUA_PARAM_TYPE_S = { "number", "string", "boolean" };
+    // We expose only basic types for simplicity. Vectors are Vec2 and Vec3, color is Color (see LuaVector.hpp and LuaScript.cpp).
+    enum class LuaParamType : int { number = 0, string, boolean, vec2, vec3, color };
+    const static std::array<const char*, 6> LUA_PARAM_TYPE_S = { "number", "string", "boolean", "vec2", "vec3", "color" };
+    /// Value of LuaParam. Alternatives are in the same order as LuaParamType.
+    using LuaParamValue = std::variant<float, std::string, bool, glm::vec2, glm::vec3, glm::ivec3>;
 
     class LuaScript;
     /// Hold information about parameters present in given LuaScript instance.
@@ -28,32 +31,45 @@ namespace Ren {
         /// Name of the parameter in LUA parameter array.
         std::string m_Name;
         /// Data type of the parameter in LUA parameter array.
-        LuaParamType m_Type;
+        LuaParamType m_Type{ LuaParamType::number };
         /// Pointer to the LuaScript instsance holding this parameter.
         LuaScript* m_Script;
 
-        /// @param p_script Pointer to the LuaScript instance holding this parameter.
+        /// @param p_script Pointer to the initialized LuaScript instance holding this parameter.
         /// @param name Name of this parameter in LUA parameter table.
         /// NOTE: Type will be deduced automatically.
         LuaParam(LuaScript* p_script, const std::string& name);
+        /// Create parameter with stored value (used when restoring the script). Value is set in LUA when the script is initialized.
+        /// @param value Value of the parameter. Type of the parameter is given by the alternative it holds.
+        LuaParam(LuaScript* p_script, const std::string& name, LuaParamValue value);
         LuaParam() = default;
 
-        /// Get value from LUA.
+        /// Get value from LUA (or the last known value, if the script is not initialized).
+        /// T must be the type of the alternative of LuaParamValue given by m_Type (or int for numbers).
         template<typename T> T Get();
         /// Set value in LUA.
         template<typename T> void Set(T val);
+        /// Get value from LUA as variant.
+        LuaParamValue GetValue();
+        /// Set value in LUA from variant. Type of the parameter is not changed, so the variant must hold the right type.
+        void SetValue(const LuaParamValue& value);
         /// Return LUA value when casting.
         template<typename T> operator T() { return Get<T>(); }
         /// Set value in LUA.
         template<typename T> LuaParam& operator=(const T& val) { Set<T>(val); return *this; }
 
     private:
-        std::any m_data;
-        Ref<std::any> m_cachedData;
+        // Last value read from or written to LUA.
+        LuaParamValue m_value{};
+        // Restored value, which is set in LUA when the script is initialized. So it won't be overriden by the script.
+        std::optional<LuaParamValue> m_initValue;
+        // Parameter table of the script (NAME.PARAM). Valid only while the script is initialized.
+        sol::table m_table{};
 
-        // Set value from m_chachedData. Called from LuaScript::init().
-        // It is used when deserializing. We need to store the value here so it won't be overriden by anything.
-        void setFromData();
+        // Bind to the parameter table of initialized script and set the restored value. Called from LuaScript::init().
+        void bind(const sol::table& table);
+        // Read value of m_Type from LUA into m_value.
+        void read();
 
         friend class LuaScript;
         friend struct YAML::convert<Ren::LuaParam>;
@@ -68,17 +84,21 @@ namespace Ren {
         const std::string ON_INIT{ "OnInit" };
         const std::string ON_DESTROY{ "OnDestroy" };
         const std::string ON_UPDATE{ "OnUpdate" };
+        const std::string ON_FIXED_UPDATE{ "OnFixedUpdate" };
+        const std::string ON_CONTACT_BEGIN{ "OnContactBegin" };
+        const std::string ON_CONTACT_END{ "OnContactEnd" };
     public:
         std::vector<LuaParam> m_Parameters;
 
-        /// @param name Name of the LUA metatable. Must be unique.
-        /// @param lua_state Pointer to the lua state to use.
+        /// @param name Name of the LUA metatable. Must be unique on the entity.
         /// @param script_path Path to script relative to AssetManager::m_ScriptDir
-        LuaScript(std::string name, sol::state* lua_state, std::filesystem::path script_path);
+        LuaScript(std::string name, std::filesystem::path script_path);
         ~LuaScript() {}
 
         const std::string& GetName() { return NAME; }
         std::string GetScriptPath() { return m_scriptPath.string(); }
+        /// Budget of the update methods. Set it with LuaScriptSystem::SetBudget().
+        const LuaBudget& GetBudget() const { return m_budget; }
 
         /// Call OnInit() function in LUA
         void OnInit();
@@ -87,19 +107,45 @@ namespace Ren {
         /// Call NAME:OnUpdate(dt) function in LUA
         /// @param dt Delta time
         void OnUpdate(float dt);
+        /// Call NAME:OnFixedUpdate(dt) function in LUA
+        /// @param dt Fixed delta time
+        void OnFixedUpdate(float dt);
+        /// Call NAME:OnContactBegin(other) function in LUA
+        /// @param other The other entity in contact (passed to LUA as integer id).
+        void OnContactBegin(entt::entity other);
+        /// Call NAME:OnContactEnd(other) function in LUA
+        /// @param other The other entity in contact (passed to LUA as integer id).
+        void OnContactEnd(entt::entity other);
 
     private:
+        // Lua state of the scene (owned by LuaScriptSystem).
         sol::state*     m_lua{ nullptr };
+        // Environment of the entity (shared by all scripts of the entity).
+        sol::environment m_env{};
+        // Instance table of this script (NAME) and its methods. Resolved once in init(), so methods
+        // defined after the script file was executed are not called.
+        sol::table      m_instance{};
+        sol::protected_function m_onInit{}, m_onDestroy{}, m_onUpdate{}, m_onFixedUpdate{}, m_onContactBegin{}, m_onContactEnd{};
+        // Index in the batches of LuaScriptSystem (-1 when not there). Managed by LuaScriptSystem.
+        int32_t         m_updateIndex{ -1 };
+        int32_t         m_fixedUpdateIndex{ -1 };
+        // Lane (lua state) of LuaScriptSystem, which runs this script (-1 when not initialized).
+        int32_t         m_lane{ -1 };
+        // Budget of the update methods and their throttling. Managed by LuaScriptSystem.
+        LuaBudget       m_budget{};
+        LuaThrottle     m_updateThrottle{};
+        LuaThrottle     m_fixedUpdateThrottle{};
         Entity          m_entity{};
         KeyInterface*   m_input{ nullptr };
         std::filesystem::path   m_scriptPath{};
 
         // Create class for this script and setup it. Should be called by LuaScriptSystem only.
         void init();
-        // Create custom datatypes and stuff for this lua state.
-        // FIXME: Maybe this should be set by the LuaScriptSystem instead, but I like that
-        //        all the sol2 LUA stuff is here.
-        void first_init();
+        // Create custom datatypes, API functions and load core scripts. Called once for each lua state of a scene.
+        static void register_bindings(sol::state& lua, KeyInterface* input);
+        // Create environment of the entity in the shared lua state. All scripts of the entity are run in it,
+        // so their globals don't collide with the scripts of other entities.
+        static sol::environment create_environment(sol::state& lua, Entity ent);
         // Destroy class etc. Should be called by LuaScriptSystem only.
         void destroy();
 
@@ -0,0 +1,26 @@
+/**
+ * @file Ren/Scripting/LuaVector.hpp
+ * @brief Declaration of native vector types for Lua.
+ */
+#pragma once
+#include <sol/sol.hpp>
+
+namespace Ren {
+    /// Vec2 and Vec3 types for Lua, which are glm::vec2 and glm::vec3 registered as usertypes. They are the same types as the
+    /// vectors of the components, so no conversion is needed. Operators (+, -, *, /, unary -, ==, #, ..) return new vectors,
+    /// in-place methods (set, add, mul) modify the vector itself. Components can also be accessed by index (v[1], v[2]).
+    ///
+    /// Operators and methods accept table vectors (VecGen, Vec4) and arrays ({ 1, 2 }) as the other operand and return
+    /// native vectors. Two exceptions follow from Lua itself:
+    ///     - `==` between a native vector and a table is always false. Use v:equals(t) or Vec.equal(a, b).
+    ///     - setmetatable() can't be used on native vectors. Use Vec.to_table(v) to get a table copy.
+    ///
+    /// Batch helpers work on flat arrays of numbers ({ x1, y1, x2, y2, ... } for Vec2), so that no vectors are created:
+    ///     Vec2.normalize_all(a)           -- Normalize all vectors of the array in place (zero vectors are kept).
+    ///     Vec2.lerp_all(a, b, t, out)     -- Linear interpolation of the vectors of `a` and `b` into `out` (new array if nil).
+    ///     Vec2.distance_all(a, b, out)    -- Distances between the vectors of `a` and `b` into `out` (new array if nil).
+    struct LuaVector {
+        /// Register Vec2 and Vec3 in the state (glmvec2 is an alias of Vec2). Called once for each lua state.
+        static void Register(sol::state& lua);
+    };
+}
@@ -11,6 +11,8 @@
 
 #include "Ren/Core/Input.hpp"
 #include "Ren/ECS/Scene.hpp"
+#include "Ren/ECS/CommandBuffer.hpp"
+#include "Ren/Physics/Physics.hpp"
 
 namespace Ren {
     class NativeScriptSystem;
@@ -22,15 +24,17 @@ namespace Ren {
         virtual void OnInit() {}
         virtual void OnDestroy() {}
         virtual void OnUpdate(float dt) {}
+        // Called with constant dt before each physics step. Apply forces and such here.
+        virtual void OnFixedUpdate(float dt) {}
 
-        // Box2D collision callbacks.
-        virtual void OnContactBegin(Entity e, b2Contact* contact) {}
-        virtual void OnContactEnd(Entity e, b2Contact* contact) {}
-        virtual void OnContactPreSolve(Entity e, b2Contact* contact, const b2Manifold* old_manifold) {}
-        virtual void OnContactPostSolve(Entity e, b2Contact* contact, const b2ContactImpulse* impulse) {}
+        // Collision callbacks. Called after the physics step, so it is safe to modify the world from them.
+        // `e` is the other entity in contact. Note that it can be either ContactEvent::a or ContactEvent::b.
+        virtual void OnContactBegin(Entity e, const ContactEvent& contact) {}
+        virtual void OnContactEnd(Entity e, const ContactEvent& contact) {}
+        virtual void OnContactPreSolve(Entity e, const ContactEvent& contact) {}
+        virtual void OnContactPostSolve(Entity e, const ContactEvent& contact) {}
 
         // TODO:
-        // void OnFixedUpdate(float dt) {}
         // void OnCollision(...) {}
     protected:
         KeyInterface* m_input;
@@ -38,9 +42,16 @@ namespace Ren {
 
         template<typename T>
         inline T& GetComponent() { return self.Get<T>(); }
+        // Modify component and notify the other systems (for ex. renderer) about the change. Components changed through
+        // GetComponent() are not seen by them.
+        template<typename T, typename... Func>
+        inline T& PatchComponent(Func&&... func) { return self.Patch<T>(std::forward<Func>(func)...); }
         inline bool HasTag(std::string tag) { return m_entity.p_scene->HasTag(m_entity, tag); }
         inline void AddTag(std::string tag) { m_entity.p_scene->AddTag(m_entity, tag); }
         inline void RemTag(std::string tag) { m_entity.p_scene->RemTag(m_entity, tag); }
+        // Structural changes (creating/destroying entities, adding/removing components) should be recorded here.
+        // They are applied after the update, so it is safe to use even from contact callbacks.
+        inline EntityCommandBuffer& Commands() { return m_entity.p_scene->GetCommandBuffer(); }
         inline bool KeyPressed(Key key) { return m_input->KeyPressed(key); }
         inline bool KeyHeld(Key key) { return m_input->KeyHeld(key); }
     private:
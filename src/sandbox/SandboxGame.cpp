@@ -5,6 +5,7 @@
 
 #include "DemoLayer.hpp"
 #include "ImGuiLayer.hpp"
+#include "BenchmarkLayer.hpp"
 
 // Window dimension constants.
 const int WINDOW_WIDTH = 1600;
@@ -21,6 +22,7 @@ public:
         // NOTE: Here could be: Rendering layer, network layer, audio layer etc.
         PushLayer(demo_layer);
         // PushLayer(gui_layer);
+        PushOverlay(CreateRef<BenchmarkLayer>("Benchmark layer"));
 
         ren_utils::LogEmitter::AddListener<ren_utils::StreamLogger>({ stdout });
     }
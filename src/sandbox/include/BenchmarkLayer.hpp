@@ -0,0 +1,710 @@
+#pragma once
+#include <chrono>
+#include <cmath>
+#include <filesystem>
+#include <fstream>
+#include <unordered_map>
+#include <vector>
+#include <Ren/Ren.hpp>
+#include "sandbox.hpp"
+
+// Layer with simple engine benchmarks. Each benchmark runs on its own scene and writes the results into the log.
+//     F2 - Spawn rate of prefab instances.
+//     F3 - Physics step and transform sync of many bodies with 0%, 1%, 10% and 100% of them awake.
+//     F4 - Physics debug draw of many bodies.
+//     F5 - Tile level with and without merging of static geometry.
+//     F6 - Separate arenas simulated in a single world and in parallel shards.
+//     F7 - Crowd of agents with and without collision layers, which filter out agent-agent pairs.
+//     F8 - Line of sight raycasts one by one and in a batch.
+//     F9 - Load time and memory of many entities with Lua scripts.
+//     F10 - Update of Lua scripts called one by one from C++ and in a batch from Lua.
+//     F11 - Garbage created by vector math in Lua with table vectors and native Vec2.
+//     F12 - Update of Lua scripts in a single state and spread among parallel states.
+//     HOME - Streaming of a chunked tile world around a moving focus point within a memory budget.
+//     INSERT - Self-checks of engine behaviour, which is hard to see in the demo. Failures are logged as errors.
+class BenchmarkLayer : public Ren::Layer {
+    using Clock = std::chrono::steady_clock;
+public:
+    BenchmarkLayer(const std::string& name) : Ren::Layer(name) {}
+
+    void OnUpdate(float dt) override {
+        if (KeyPressed(Ren::Key::F2))
+            benchSpawnRate(10000);
+        if (KeyPressed(Ren::Key::F3))
+            benchSleepingBodies(50000, 120);
+        if (KeyPressed(Ren::Key::F4))
+            benchDebugDraw(20000, 60);
+        if (KeyPressed(Ren::Key::F5))
+            benchStaticGeometry(200, 50, 500, 120);
+        if (KeyPressed(Ren::Key::F6))
+            benchShards(8, 1500, 120);
+        if (KeyPressed(Ren::Key::F7))
+            benchCrowd(5000, 120);
+        if (KeyPressed(Ren::Key::F8))
+            benchRaycasts(2000, 100000);
+        if (KeyPressed(Ren::Key::F9))
+            benchLuaScripts(5000, 60);
+        if (KeyPressed(Ren::Key::F10))
+            benchLuaDispatch(10000, 120);
+        if (KeyPressed(Ren::Key::F11))
+            benchLuaVectors(1000000);
+        if (KeyPressed(Ren::Key::F12))
+            benchLuaParallel(20000, 120);
+        if (KeyPressed(Ren::Key::HOME))
+            benchWorldStreaming(12, 8, 600);
+        if (KeyPressed(Ren::Key::INSERT))
+            runChecks();
+    }
+
+private:
+    // Milliseconds elapsed since `start`.
+    static float msSince(Clock::time_point start) { return std::chrono::duration<float, std::milli>(Clock::now() - start).count(); }
+
+    // Log result of a self-check.
+    static bool check(bool passed, const char* name) {
+        if (passed)
+            LOG_I(strfmt("[Check] %s -- passed", name));
+        else
+            LOG_E(strfmt("[Check] %s -- FAILED", name));
+        return passed;
+    }
+    void runChecks() {
+        checkCommandPlayback();
+        checkLuaVectors();
+        checkCoroutineBudget();
+        checkSnapshotRestore();
+        checkChunkCacheReload();
+    }
+
+    // Create new empty scene for a benchmark.
+    Ref<Ren::Scene> createScene() { return CreateRef<Ren::Scene>(GetRenderer(), GetInput()); }
+    // Destroy scene created with createScene().
+    void destroyScene(Ref<Ren::Scene>& scene) {
+        scene->Destroy();
+        scene.reset();
+    }
+
+    // Compare spawning of `count` debris bodies one by one (as DemoLayer does on click) with Scene::Instantiate().
+    void benchSpawnRate(std::size_t count) {
+        Ren::Prefab prefab = Ren::Prefab::Load("debris.yaml");
+        SAND_ASSERT(prefab.sprite && prefab.rigid_body, "Debris prefab must have sprite and rigid body.");
+
+        std::vector<Ren::TransformComponent> transforms(count, prefab.transform);
+        for (std::size_t i = 0; i < count; i++)
+            transforms[i].position = { float(i % 100), float(i / 100) };
+
+        float one_by_one_ms = 0.0f;
+        std::size_t unique_shapes = 0;
+        {
+            auto scene = createScene();
+            auto start = Clock::now();
+            for (auto&& trans : transforms) {
+                Ren::Entity ent = scene->CreateEntity(trans, prefab.tags);
+                ent.Add<Ren::SpriteComponent>(prefab.sprite->img_path);
+                auto& rig = ent.Add<Ren::RigidBodyComponent>();
+                rig.body_def = prefab.rigid_body->body_def;
+                for (auto&& [shape, fix_def, layer] : prefab.rigid_body->fixtures)
+                    rig.fixtures.Add(Ren::ShapeLibrary::Intern(*shape.get()), fix_def, layer);
+                scene->GetSystem<Ren::PhysicsSystem>()->InitPhysicsBody(ent);
+            }
+            one_by_one_ms = msSince(start);
+            unique_shapes = Ren::ShapeLibrary::Size();
+            destroyScene(scene);
+        }
+
+        float instantiate_ms = 0.0f;
+        {
+            auto scene = createScene();
+            auto start = Clock::now();
+            scene->Instantiate(prefab, count, transforms.data());
+            instantiate_ms = msSince(start);
+            destroyScene(scene);
+        }
+
+        LOG_I(strfmt("[Benchmark] Spawn %zu bodies -- one by one: %.2f ms (%.0f/s), Instantiate: %.2f ms (%.0f/s), unique shapes: %zu, fixture pool: %zu B",
+                     count, one_by_one_ms, count / one_by_one_ms * 1000.0f, instantiate_ms, count / instantiate_ms * 1000.0f,
+                     unique_shapes, Ren::FixtureList::PoolBytes()));
+    }
+
+    // Step `count` bodies for `frames` frames with growing part of them awake. Sync cost should follow the number of
+    // awake bodies, not the number of all bodies.
+    void benchSleepingBodies(std::size_t count, int32_t frames) {
+        struct Result { float step_ms, sync_ms; std::size_t active; };
+        auto run = [&](float ratio) {
+            auto scene = createScene();
+            auto physics = scene->GetSystem<Ren::PhysicsSystem>();
+
+            // Bodies don't touch each other, so the sleeping ones stay asleep. Awake ones fall freely.
+            std::size_t awake_count = std::size_t(count * ratio);
+            for (std::size_t i = 0; i < count; i++) {
+                Ren::Entity ent = scene->CreateEntity({ { float(i % 250) * 2.0f, float(i / 250) * 2.0f }, glm::vec2(1.0f) });
+                auto& rig = ent.Add<Ren::RigidBodyComponent>();
+                rig.body_def.type = b2_dynamicBody;
+                rig.body_def.awake = i < awake_count;
+                b2FixtureDef fix_def;
+                fix_def.density = 1.0f;
+                rig.fixtures.Add(Ren::ShapeLibrary::Box(0.5f, 0.5f), fix_def);
+                physics->InitPhysicsBody(ent);
+            }
+
+            Result result{ 0.0f, 0.0f, 0 };
+            float dt = scene->m_FixedTimeStep;
+            for (int32_t f = 0; f < frames; f++) {
+                auto start = Clock::now();
+                physics->FixedUpdate(dt);
+                result.step_ms += msSince(start);
+                start = Clock::now();
+                physics->Update(dt);
+                result.sync_ms += msSince(start);
+            }
+            result.active = physics->GetActiveBodyCount();
+            destroyScene(scene);
+            return result;
+        };
+
+        std::string results;
+        for (float ratio : { 0.0f, 0.01f, 0.1f, 1.0f }) {
+            Result r = run(ratio);
+            results += strfmt(" | %.0f%% awake: step %.3f ms, sync %.3f ms (%zu active)", ratio * 100.0f, r.step_ms / frames, r.sync_ms / frames, r.active);
+        }
+        LOG_I(strfmt("[Benchmark] %zu bodies, %d frames --", count, frames) + results);
+    }
+
+    // Debug draw `count` boxes for `frames` frames, once with all of them in view and once with the camera showing a small part.
+    void benchDebugDraw(std::size_t count, int32_t frames) {
+        auto scene = createScene();
+        auto physics = scene->GetSystem<Ren::PhysicsSystem>();
+        physics->m_DebugRender = true;
+        for (std::size_t i = 0; i < count; i++) {
+            Ren::Entity ent = scene->CreateEntity({ { float(i % 200), float(i / 200) }, glm::vec2(1.0f) });
+            auto& rig = ent.Add<Ren::RigidBodyComponent>();
+            rig.fixtures.Add(Ren::ShapeLibrary::Box(0.4f, 0.4f));
+            physics->InitPhysicsBody(ent);
+        }
+
+        Ren::CartesianCamera camera;
+        camera.SetViewportSize(m_GameCore->GetWindowSize());
+        camera.m_CamPos = { 100.0f, float(count / 200) * 0.5f };
+        auto run = [&](uint32_t pixels_per_unit) {
+            camera.SetUnitScale(pixels_per_unit);
+            auto start = Clock::now();
+            for (int32_t f = 0; f < frames; f++) {
+                Ren::Renderer::BeginRender(&camera);
+                scene->Render();
+                Ren::Renderer::Render();
+                Ren::Renderer::EndRender();
+            }
+            return msSince(start) / frames;
+        };
+
+        // Fit the whole grid into the viewport, then zoom in.
+        float all_ms = run(std::max(1u, uint32_t(m_GameCore->GetWindowSize().x / 200)));
+        float zoomed_ms = run(50);
+        destroyScene(scene);
+
+        LOG_I(strfmt("[Benchmark] Debug draw of %zu bodies -- all in view: %.3f ms/frame, zoomed in: %.3f ms/frame", count, all_ms, zoomed_ms));
+    }
+
+    // Tile level of `width` x `height` tiles (with some holes) and `balls` dynamic bodies falling on it.
+    void benchStaticGeometry(int32_t width, int32_t height, int32_t balls, int32_t frames) {
+        struct Result { float init_ms, step_ms; int32_t bodies, proxies; };
+        auto run = [&](bool merge) {
+            auto scene = createScene();
+            auto physics = scene->GetSystem<Ren::PhysicsSystem>();
+            for (int32_t y = 0; y < height; y++) {
+                for (int32_t x = 0; x < width; x++) {
+                    if ((x * 7 + y * 13) % 17 == 0)
+                        continue;
+                    Ren::Entity tile = scene->CreateEntity({ { float(x), float(y) - height }, glm::vec2(1.0f) });
+                    auto& rig = tile.Add<Ren::RigidBodyComponent>();
+                    rig.static_geometry = merge;
+                    rig.fixtures.Add(Ren::ShapeLibrary::Box(0.5f, 0.5f));
+                }
+            }
+            for (int32_t i = 0; i < balls; i++) {
+                Ren::Entity ball = scene->CreateEntity({ { float(i % width), 2.0f + float(i / width) * 2.0f }, glm::vec2(1.0f) });
+                auto& rig = ball.Add<Ren::RigidBodyComponent>();
+                rig.body_def.type = b2_dynamicBody;
+                b2FixtureDef fix_def;
+                fix_def.density = 1.0f;
+                rig.fixtures.Add(Ren::ShapeLibrary::Circle(0.4f), fix_def);
+            }
+
+            Result result{ 0.0f, 0.0f, 0, 0 };
+            auto start = Clock::now();
+            scene->Init();
+            physics->FixedUpdate(scene->m_FixedTimeStep);
+            result.init_ms = msSince(start);
+
+            start = Clock::now();
+            for (int32_t f = 0; f < frames; f++)
+                physics->FixedUpdate(scene->m_FixedTimeStep);
+            result.step_ms = msSince(start) / frames;
+            result.bodies = physics->GetWorld()->GetBodyCount();
+            result.proxies = physics->GetWorld()->GetProxyCount();
+            destroyScene(scene);
+            return result;
+        };
+
+        Result separate = run(false);
+        Result merged = run(true);
+        LOG_I(strfmt("[Benchmark] %dx%d tiles -- separate: init %.2f ms, step %.3f ms, %d bodies, %d proxies | merged: init %.2f ms, step %.3f ms, %d bodies, %d proxies",
+                     width, height, separate.init_ms, separate.step_ms, separate.bodies, separate.proxies,
+                     merged.init_ms, merged.step_ms, merged.bodies, merged.proxies));
+    }
+
+    // `arenas` walled arenas with `count` boxes each, all in one world and then one shard per arena.
+    void benchShards(int32_t arenas, int32_t count, int32_t frames) {
+        const float size = 40.0f, gap = 10.0f;
+        auto run = [&](bool sharded) {
+            auto scene = createScene();
+            auto physics = scene->GetSystem<Ren::PhysicsSystem>();
+            for (int32_t a = 0; a < arenas; a++) {
+                float x0 = a * (size + gap);
+                if (sharded && a > 0)
+                    physics->AddShard(b2AABB{ { x0 - gap * 0.5f, -1000.0f }, { x0 + size + gap * 0.5f, 1000.0f } });
+
+                // Floor and walls.
+                Ren::Entity walls = scene->CreateEntity({ { x0, 0.0f }, glm::vec2(1.0f) });
+                auto& walls_rig = walls.Add<Ren::RigidBodyComponent>();
+                walls_rig.fixtures.Add(Ren::ShapeLibrary::Box(size * 0.5f, 0.5f, { size * 0.5f, -0.5f }));
+                walls_rig.fixtures.Add(Ren::ShapeLibrary::Box(0.5f, size, { -0.5f, size }));
+                walls_rig.fixtures.Add(Ren::ShapeLibrary::Box(0.5f, size, { size + 0.5f, size }));
+
+                for (int32_t i = 0; i < count; i++) {
+                    Ren::Entity box = scene->CreateEntity({ { x0 + 1.0f + float(i % 38), 1.0f + float(i / 38) }, glm::vec2(1.0f) });
+                    auto& rig = box.Add<Ren::RigidBodyComponent>();
+                    rig.body_def.type = b2_dynamicBody;
+                    b2FixtureDef fix_def;
+                    fix_def.density = 1.0f;
+                    rig.fixtures.Add(Ren::ShapeLibrary::Box(0.4f, 0.4f), fix_def);
+                }
+            }
+            scene->Init();
+
+            auto start = Clock::now();
+            for (int32_t f = 0; f < frames; f++)
+                physics->FixedUpdate(scene->m_FixedTimeStep);
+            float step_ms = msSince(start) / frames;
+            destroyScene(scene);
+            return step_ms;
+        };
+
+        float single_ms = run(false);
+        float sharded_ms = run(true);
+        LOG_I(strfmt("[Benchmark] %d arenas with %d boxes -- single world: %.3f ms/step, %d shards: %.3f ms/step (%zu threads)",
+                     arenas, count, single_ms, arenas, sharded_ms, Ren::ThreadPool::Global().GetConcurrency()));
+    }
+
+    // Top-down crowd of `count` agents walking around a closed area.
+    void benchCrowd(int32_t count, int32_t frames) {
+        struct Result { float step_ms; int32_t contacts; };
+        const int32_t side = int32_t(std::sqrt(float(count)));
+        const float size = side * 1.0f;
+        auto run = [&](bool filtered) {
+            auto scene = createScene();
+            auto physics = scene->GetSystem<Ren::PhysicsSystem>();
+            int32_t crowd = -1;
+            if (filtered) {
+                crowd = scene->m_CollisionLayers.Add("crowd");
+                scene->m_CollisionLayers.SetCollides(crowd, crowd, false);
+            }
+
+            Ren::Entity walls = scene->CreateEntity({ { 0.0f, 0.0f }, glm::vec2(1.0f) });
+            auto& walls_rig = walls.Add<Ren::RigidBodyComponent>();
+            walls_rig.fixtures.Add(Ren::ShapeLibrary::Box(size * 0.5f, 0.5f, { size * 0.5f, -0.5f }));
+            walls_rig.fixtures.Add(Ren::ShapeLibrary::Box(size * 0.5f, 0.5f, { size * 0.5f, size + 0.5f }));
+            walls_rig.fixtures.Add(Ren::ShapeLibrary::Box(0.5f, size * 0.5f, { -0.5f, size * 0.5f }));
+            walls_rig.fixtures.Add(Ren::ShapeLibrary::Box(0.5f, size * 0.5f, { size + 0.5f, size * 0.5f }));
+
+            for (int32_t i = 0; i < count; i++) {
+                Ren::Entity agent = scene->CreateEntity({ { 0.5f + float(i % side), 0.5f + float(i / side) }, glm::vec2(1.0f) });
+                auto& rig = agent.Add<Ren::RigidBodyComponent>();
+                rig.body_def.type = b2_dynamicBody;
+                rig.body_def.gravityScale = 0.0f;
+                rig.body_def.linearVelocity = { float((i * 7) % 5) - 2.0f, float((i * 13) % 5) - 2.0f };
+                b2FixtureDef fix_def;
+                fix_def.density = 1.0f;
+                rig.fixtures.Add(Ren::ShapeLibrary::Circle(0.45f), fix_def, crowd);
+            }
+            scene->Init();
+
+            auto start = Clock::now();
+            for (int32_t f = 0; f < frames; f++)
+                physics->FixedUpdate(scene->m_FixedTimeStep);
+            Result result{ msSince(start) / frames, physics->GetWorld()->GetContactCount() };
+            destroyScene(scene);
+            return result;
+        };
+
+        Result all = run(false);
+        Result filtered = run(true);
+        LOG_I(strfmt("[Benchmark] Crowd of %d agents -- unfiltered: %.3f ms/step, %d contacts | layers: %.3f ms/step, %d contacts",
+                     count, all.step_ms, all.contacts, filtered.step_ms, filtered.contacts));
+    }
+
+    // `rays` line of sight checks between random pairs of `bodies` scattered boxes.
+    void benchRaycasts(int32_t bodies, int32_t rays) {
+        auto scene = createScene();
+        auto physics = scene->GetSystem<Ren::PhysicsSystem>();
+        const float size = 200.0f;
+        std::vector<b2Vec2> positions;
+        for (int32_t i = 0; i < bodies; i++) {
+            positions.push_back({ float((i * 7919) % 2000) / 2000.0f * size, float((i * 104729) % 2000) / 2000.0f * size });
+            Ren::Entity box = scene->CreateEntity({ Ren::Utils::to_vec2(positions.back()), glm::vec2(1.0f) });
+            box.Add<Ren::RigidBodyComponent>().fixtures.Add(Ren::ShapeLibrary::Box(0.5f, 0.5f));
+        }
+        scene->Init();
+
+        std::vector<Ren::RaycastQuery> queries(rays);
+        for (int32_t i = 0; i < rays; i++) {
+            queries[i].from = positions[(i * 31) % bodies] + b2Vec2(0.0f, 1.0f);
+            queries[i].to = positions[(i * 57 + 13) % bodies] + b2Vec2(0.0f, 1.0f);
+        }
+        std::vector<Ren::RaycastHit> hits(rays);
+
+        // What a script would do per entity.
+        auto start = Clock::now();
+        for (int32_t i = 0; i < rays; i++)
+            physics->RaycastBatch(&queries[i], 1, &hits[i]);
+        float single_ms = msSince(start);
+
+        start = Clock::now();
+        physics->RaycastBatch(queries.data(), queries.size(), hits.data());
+        float batch_ms = msSince(start);
+        destroyScene(scene);
+
+        LOG_I(strfmt("[Benchmark] %d raycasts among %d bodies -- one by one: %.2f ms, batch: %.2f ms (%zu threads)",
+                     rays, bodies, single_ms, batch_ms, Ren::ThreadPool::Global().GetConcurrency()));
+    }
+
+    // Load `count` entities with a Lua script and update them for `frames` frames.
+    // Scene is loaded twice, first with empty LuaChunkCache (each file is compiled once) and then with the cached bytecode.
+    void benchLuaScripts(int32_t count, int32_t frames) {
+        auto run = [&](float& load_ms, Ren::LuaAllocator::Stats& memory) {
+            auto scene = createScene();
+            auto lua = scene->GetSystem<Ren::LuaScriptSystem>();
+            for (int32_t i = 0; i < count; i++) {
+                Ren::Entity ent = scene->CreateEntity({ { float(i % 100), float(i / 100) }, glm::vec2(1.0f) });
+                ent.Add<Ren::SpriteComponent>();
+                ent.Add<Ren::LuaScriptComponent>().Attach("Bench", "bench.lua");
+            }
+
+            auto start = Clock::now();
+            lua->Init();
+            load_ms = msSince(start);
+            memory = lua->GetStateStats(0).memory;
+
+            start = Clock::now();
+            for (int32_t f = 0; f < frames; f++)
+                lua->Update(scene->m_FixedTimeStep);
+            float update_ms = msSince(start) / frames;
+            destroyScene(scene);
+            return update_ms;
+        };
+
+        float cold_ms = 0.0f, load_ms = 0.0f;
+        Ren::LuaAllocator::Stats memory;
+        Ren::LuaChunkCache::Clear();
+        run(cold_ms, memory);
+        float update_ms = run(load_ms, memory);
+
+        LOG_I(strfmt("[Benchmark] %d Lua scripts -- load: %.2f ms (%.2f ms with empty chunk cache), memory: %.2f MB (%.2f KB per entity, %.2f MB pooled, %zu allocations), update: %.3f ms/frame",
+                     count, load_ms, cold_ms, memory.used / (1024.0f * 1024.0f), memory.used / 1024.0f / count,
+                     memory.pooled / (1024.0f * 1024.0f), memory.allocations, update_ms));
+    }
+
+    // Update `count` Lua scripts for `frames` frames with and without batched mode of LuaScriptSystem.
+    void benchLuaDispatch(int32_t count, int32_t frames) {
+        auto scene = createScene();
+        auto lua = scene->GetSystem<Ren::LuaScriptSystem>();
+        for (int32_t i = 0; i < count; i++) {
+            Ren::Entity ent = scene->CreateEntity({ { float(i % 100), float(i / 100) }, glm::vec2(1.0f) });
+            ent.Add<Ren::SpriteComponent>();
+            ent.Add<Ren::LuaScriptComponent>().Attach("Bench", "bench.lua");
+        }
+        lua->Init();
+
+        auto run = [&](bool batched) {
+            lua->SetBatched(batched);
+            auto start = Clock::now();
+            for (int32_t f = 0; f < frames; f++)
+                lua->Update(scene->m_FixedTimeStep);
+            return msSince(start) / frames;
+        };
+        float single_ms = run(false);
+        float batched_ms = run(true);
+        destroyScene(scene);
+
+        LOG_I(strfmt("[Benchmark] Update of %d Lua scripts -- one by one: %.3f ms/frame, batched: %.3f ms/frame",
+                     count, single_ms, batched_ms));
+    }
+
+    // `ops` vector operations (p = p + v * dt) in Lua with table vectors (as vector.lua used to implement Vec2) and native Vec2.
+    void benchLuaVectors(int32_t ops) {
+        auto scene = createScene();
+        sol::state& lua = scene->GetSystem<Ren::LuaScriptSystem>()->GetState();
+        lua.script(R"(
+            function BenchTableVec2(x, y)
+                local res = { size = 2, x = x, y = y }
+                setmetatable(res, VecGenMeta)
+                return res
+            end
+            function BenchVectors(new, ops)
+                local p, v = new(0, 0), new(1, 2)
+                for i = 1, ops do
+                    p = p + v * 0.016
+                end
+                return p.x
+            end
+        )");
+
+        struct Result { float ms, garbage_mb; };
+        auto run = [&](sol::object new_vec) {
+            // Garbage is the memory allocated while the collector is stopped.
+            lua.collect_garbage();
+            lua.stop_gc();
+            std::size_t before = lua.memory_used();
+            auto start = Clock::now();
+            lua["BenchVectors"](new_vec, ops);
+            Result result{ msSince(start), (lua.memory_used() - before) / (1024.0f * 1024.0f) };
+            lua.restart_gc();
+            lua.collect_garbage();
+            return result;
+        };
+        Result table = run(lua["BenchTableVec2"]);
+        Result native = run(lua["Vec2"]["new"]);
+        destroyScene(scene);
+
+        LOG_I(strfmt("[Benchmark] %d Lua vector ops -- tables: %.2f ms, %.2f MB garbage | native Vec2: %.2f ms, %.2f MB garbage",
+                     ops, table.ms, table.garbage_mb, native.ms, native.garbage_mb));
+    }
+
+    // Update `count` Lua scripts for `frames` frames in a single lua state and in one state per thread of the pool.
+    void benchLuaParallel(int32_t count, int32_t frames) {
+        auto run = [&](std::size_t states) {
+            auto scene = createScene();
+            auto lua = scene->GetSystem<Ren::LuaScriptSystem>();
+            lua->SetParallel(states);
+            lua->SetBatched(true);
+            for (int32_t i = 0; i < count; i++) {
+                Ren::Entity ent = scene->CreateEntity({ { float(i % 100), float(i / 100) }, glm::vec2(1.0f) });
+                ent.Add<Ren::SpriteComponent>();
+                ent.Add<Ren::LuaScriptComponent>().Attach("Bench", "bench.lua");
+            }
+            lua->Init();
+
+            auto start = Clock::now();
+            for (int32_t f = 0; f < frames; f++)
+                lua->Update(scene->m_FixedTimeStep);
+            float update_ms = msSince(start) / frames;
+            destroyScene(scene);
+            return update_ms;
+        };
+        std::size_t threads = Ren::ThreadPool::Global().GetConcurrency();
+        float single_ms = run(1);
+        float parallel_ms = run(threads);
+
+        LOG_I(strfmt("[Benchmark] Update of %d Lua scripts -- single state: %.3f ms/frame, %zu parallel states: %.3f ms/frame",
+                     count, single_ms, threads, parallel_ms));
+    }
+
+    // Tile world of `chunks` x `chunks` chunks with `tiles` x `tiles` static tiles each, written with SerializeChunks()
+    // and streamed back by WorldStreamer, while the focus point crosses it in `frames` frames.
+    void benchWorldStreaming(int32_t chunks, int32_t tiles, int32_t frames) {
+        const float chunk_size = 16.0f, tile_size = chunk_size / tiles;
+        const float world_size = chunks * chunk_size;
+        const std::filesystem::path dir = SOURCE_DIR "/build/bench_world";
+        {
+            auto scene = createScene();
+            for (int32_t y = 0; y < chunks * tiles; y++) {
+                for (int32_t x = 0; x < chunks * tiles; x++) {
+                    Ren::Entity tile = scene->CreateEntity({ (glm::vec2(x, y) + 0.5f) * tile_size, glm::vec2(1.0f) });
+                    auto& rig = tile.Add<Ren::RigidBodyComponent>();
+                    rig.static_geometry = true;
+                    rig.fixtures.Add(Ren::ShapeLibrary::Box(tile_size * 0.5f, tile_size * 0.5f));
+                }
+            }
+            Ren::SceneSerializer::SerializeChunks(scene, dir, chunk_size);
+            destroyScene(scene);
+        }
+        // Only the chunks with the focus point inside may go over the budget.
+        std::size_t chunk_bytes = 0;
+        for (auto&& file : std::filesystem::directory_iterator(dir))
+            if (file.path().filename() != "world.yaml")
+                chunk_bytes = std::max(chunk_bytes, std::size_t(file.file_size()));
+
+        auto scene = createScene();
+        scene->Init();
+        float update_ms = 0.0f, max_update_ms = 0.0f;
+        std::size_t peak_bytes = 0, budget = 0;
+        int32_t loaded = 0;
+        {
+            Ren::WorldStreamer streamer(scene.get(), dir);
+            streamer.m_LoadDistance = chunk_size;
+            streamer.m_UnloadDistance = chunk_size * 2.0f;
+            streamer.m_MemoryBudget = budget = chunk_bytes * 6;
+            for (int32_t f = 0; f < frames; f++) {
+                glm::vec2 focus{ world_size * f / frames, world_size * 0.5f };
+                auto start = Clock::now();
+                streamer.Update({ focus });
+                float ms = msSince(start);
+                update_ms += ms;
+                max_update_ms = std::max(max_update_ms, ms);
+                peak_bytes = std::max(peak_bytes, streamer.GetResidentBytes() + streamer.GetLoadingBytes());
+            }
+            for (int32_t y = 0; y < chunks; y++)
+                for (int32_t x = 0; x < chunks; x++)
+                    loaded += streamer.IsLoaded({ x, y });
+            streamer.UnloadAll();
+        }
+        destroyScene(scene);
+
+        LOG_I(strfmt("[Benchmark] Streaming of %dx%d chunks, %d frames -- update %.3f ms/frame (max %.3f ms), peak %zu kB of %zu kB budget, %d chunks loaded at the end",
+                     chunks, chunks, frames, update_ms / frames, max_update_ms, peak_bytes / 1024, budget / 1024, loaded));
+        check(peak_bytes <= budget + chunk_bytes * 4, "World streamer stays within the memory budget");
+    }
+
+    // Components of the command buffer check.
+    struct CheckFirst { int32_t value{ 0 }; };
+    struct CheckSecond { int32_t value{ 0 }; };
+    // Handler records another command while the buffer is played back.
+    static void onCheckFirst(Ren::Scene& scene, entt::registry& reg, entt::entity ent) {
+        scene.GetCommandBuffer().Emplace<CheckSecond>(ent, reg.get<CheckFirst>(ent).value + 1);
+    }
+    // Commands recorded by on_construct handlers during playback must be applied by the same playback.
+    void checkCommandPlayback() {
+        auto scene = createScene();
+        auto& reg = *scene->m_Registry;
+        reg.on_construct<CheckFirst>().connect<&BenchmarkLayer::onCheckFirst>(*scene);
+
+        const int32_t count = 100;
+        std::vector<Ren::Entity> entities;
+        for (int32_t i = 0; i < count; i++) {
+            entities.push_back(scene->CreateEntity());
+            scene->GetCommandBuffer().Emplace<CheckFirst>(entities.back(), i);
+        }
+        scene->PlaybackCommandBuffers();
+
+        bool passed = true;
+        for (int32_t i = 0; i < count; i++) {
+            auto second = reg.try_get<CheckSecond>(entities[i].id);
+            passed = passed && second && second->value == i + 1;
+        }
+        passed = passed && scene->GetCommandBuffer().Empty();
+        check(passed, "Commands recorded during command buffer playback");
+
+        reg.on_construct<CheckFirst>().disconnect<&BenchmarkLayer::onCheckFirst>(*scene);
+        destroyScene(scene);
+    }
+
+    // Native vectors mixed with table vectors and arrays in Lua.
+    void checkLuaVectors() {
+        auto scene = createScene();
+        sol::state& lua = scene->GetSystem<Ren::LuaScriptSystem>()->GetState();
+        auto result = lua.safe_script(R"(
+            local v, g = Vec2:new(1, 2), VecGen:new({ 3, 4 })
+            assert((v + { 1, 2 }):equals(Vec2:new(2, 4)))
+            assert(({ 1, 2 } + v):equals({ 2, 4 }))
+            assert((v * g):equals(Vec2:new(3, 8)))
+            assert(Vec.dot(v, g) == 11 and Vec.dot(g, v) == 11)
+            assert(Vec.equal(v, { x = 1, y = 2 }) and not Vec.equal(v, g))
+            assert(v[1] == 1 and v[2] == 2 and v[3] == nil)
+            v[1] = 5
+            assert(v.x == 5)
+            local t = setmetatable(Vec.to_table(v), VecGenMeta)
+            assert(t.x == 5 and t.y == 2)
+            return true
+        )", sol::script_pass_on_error);
+        if (!result.valid()) {
+            sol::error err = result;
+            LOG_E(err.what());
+        }
+        check(result.valid(), "Lua vectors mixed with tables");
+        destroyScene(scene);
+    }
+
+    // Script rewritten without changing its modification time (for ex. within the resolution of the file system clock)
+    // is compiled again, when its size changed.
+    void checkChunkCacheReload() {
+        const std::filesystem::path path = SOURCE_DIR "/build/check_reload.lua";
+        const auto write = [&path](const char* source) { std::ofstream(path, std::ios::trunc) << source; };
+        sol::state lua;
+
+        write("return 1");
+        auto time = std::filesystem::last_write_time(path);
+        sol::load_result first = Ren::LuaChunkCache::Load(lua, path);
+        write("return 1234");
+        std::filesystem::last_write_time(path, time);
+        sol::load_result second = Ren::LuaChunkCache::Load(lua, path);
+
+        bool passed = first.valid() && second.valid() &&
+            first.get<sol::protected_function>()().get<int>() == 1 && second.get<sol::protected_function>()().get<int>() == 1234;
+        check(passed, "Lua chunk cache reloads a modified script with the same modification time");
+        std::filesystem::remove(path);
+    }
+
+    // Coroutines of a script with an instruction budget are aborted, when they exceed it.
+    void checkCoroutineBudget() {
+        auto scene = createScene();
+        auto lua = scene->GetSystem<Ren::LuaScriptSystem>();
+        sol::table result = lua->GetState().create_named_table("BudgetCheckResult");
+        Ren::Entity ent = scene->CreateEntity();
+        auto& comp = ent.Add<Ren::LuaScriptComponent>();
+        comp.Attach("BudgetCheck", "budget_check.lua");
+        lua->SetBudget(*comp.scripts.at("BudgetCheck"), Ren::LuaBudget{ 0.0f, 100000 });
+        lua->Init();
+
+        // Both coroutines log the error of the exceeded budget.
+        lua->Update(scene->m_FixedTimeStep);
+        lua->Signal("budget_check");
+        check(result.get_or("ticked", false) && !result.get_or("tick_finished", false), "Coroutine budget when resumed by the scheduler");
+        check(result.get_or("signaled", false) && !result.get_or("signal_finished", false), "Coroutine budget when resumed by a signal");
+        destroyScene(scene);
+    }
+
+    // Snapshot taken between two physics steps puts the bodies back exactly where they were.
+    void checkSnapshotRestore() {
+        auto scene = createScene();
+        for (int32_t i = 0; i < 20; i++) {
+            Ren::Entity ent = scene->CreateEntity({ { float(i % 5) * 2.0f, float(i / 5) * 2.0f }, glm::vec2(1.0f) });
+            auto& rig = ent.Add<Ren::RigidBodyComponent>();
+            rig.body_def.type = b2_dynamicBody;
+            rig.body_def.angularVelocity = 1.0f;
+            rig.fixtures.Add(Ren::ShapeLibrary::Box(0.4f, 0.4f));
+        }
+        scene->Init();
+
+        struct Pose { b2Vec2 position; float angle; };
+        auto poses = [&scene]() {
+            std::unordered_map<entt::entity, Pose> out;
+            for (auto&& [ent, rig] : scene->m_Registry->view<Ren::RigidBodyComponent>().each())
+                if (rig.p_body)
+                    out[ent] = { rig.p_body->GetPosition(), rig.p_body->GetAngle() };
+            return out;
+        };
+        // Frames shorter than the step leave the scene between two steps.
+        auto run = [&scene](int32_t frames) {
+            for (int32_t f = 0; f < frames; f++)
+                scene->Update(scene->m_FixedTimeStep * 0.7f);
+        };
+
+        run(25);
+        Ren::SceneSnapshot snapshot;
+        snapshot.Take(scene.get());
+        auto before = poses();
+        run(25);
+        snapshot.Restore(scene.get());
+        auto after = poses();
+
+        bool same = before.size() == 20 && after.size() == before.size();
+        for (auto&& [ent, pose] : after) {
+            auto it = before.find(ent);
+            auto& trans = scene->m_Registry->get<Ren::TransformComponent>(ent);
+            same = same && it != before.end() && pose.position == it->second.position && pose.angle == it->second.angle
+                && trans.position == Ren::Utils::to_vec2(pose.position);
+        }
+        check(same, "Snapshot restores bodies between physics steps");
+        destroyScene(scene);
+    }
+};
@@ -13,6 +13,7 @@ class DemoLayer : public Ren::Layer {
     Ren::Entity m_ent;
     Ren::CartesianCamera m_camera;
     Ren::Texture2D m_renderTexture;
+    Ren::SceneSnapshot m_quickSave;
 
 public:
     DemoLayer(const std::string &name) : Ren::Layer(name) {}
@@ -61,9 +62,8 @@ public:
             Ren::Entity dynamic_body =
             m_scene->CreateEntity({{pos.x, pos.y}}, {"spawned_body"});
             auto &dynamic_body_r = dynamic_body.Add<Ren::RigidBodyComponent>();
-            auto box_shape = CreateRef<b2PolygonShape>();
-            box_shape->SetAsBox(ren_utils::random_float(0.5f, 2.0f),
-                                ren_utils::random_float(0.5f, 2.0f));
+            auto box_shape = Ren::ShapeLibrary::Box(ren_utils::random_float(0.5f, 2.0f),
+                                                    ren_utils::random_float(0.5f, 2.0f));
             dynamic_body_r.body_def.type = b2_dynamicBody;
             b2FixtureDef fix_def;
             fix_def.density = ren_utils::random_float(0.5f, 5.0f);
@@ -82,7 +82,7 @@ public:
         const float rotation_speed = 90.0f; // 90 degrees per second.
         auto entities = m_scene->GetEntitiesByTag("rotate");
         for (auto &&ent : *entities)
-            ent.Get<Ren::TransformComponent>().rotation += rotation_speed * dt;
+            ent.Patch<Ren::TransformComponent>([&](auto& trans) { trans.rotation += rotation_speed * dt; });
 
         if (KeyPressed(Ren::Key::SPACE))
             m_camera.m_CamPos = glm::vec2(0.0f);
@@ -110,6 +110,19 @@ public:
             Ren::SceneSerializer::Serialize(m_scene, SOURCE_DIR "/build/param.yaml");
         }
 
+        // Quick save and quick load.
+        if (KeyPressed(Ren::Key::F5)) {
+            m_quickSave.Take(m_scene.get());
+            m_quickSave.SaveToFile(SOURCE_DIR "/build/quicksave.snap");
+            LOG_I("Quick saved " + std::to_string(m_quickSave.GetSize()) + " bytes.");
+        }
+        if (KeyPressed(Ren::Key::F9) && (!m_quickSave.Empty() || m_quickSave.LoadFromFile(SOURCE_DIR "/build/quicksave.snap"))) {
+            m_quickSave.Restore(m_scene.get());
+            // Native scripts are not part of the snapshot. Restore() destroys them, so bind and initialize them again.
+            if (auto ent = bindNativeScripts())
+                m_scene->GetSystem<Ren::NativeScriptSystem>()->InitScript(*ent);
+        }
+
         m_scene->Update(dt);
     }
     void OnRender(SDL_Renderer *renderer) override {
@@ -121,6 +134,7 @@ public:
             "'i' to toggle imgui demo window\n"
             "ESC to exit\n"
             "Mouse left button for spawning new body\n"
+            "F5 to quick save, F9 to quick load\n"
             "Mouse wheel for zoom",
             {10.0f, 10.0f}, 1.0f, Ren::Colors3::White, 10);
         m_scene->Render();
@@ -132,12 +146,19 @@ private:
     void sceneFromFile(std::filesystem::path path = "scenes/demo.ren") {
         m_scene = Ren::SceneSerializer::Deserialze(path, GetRenderer(), GetInput());
         m_scene->GetSystem<Ren::PhysicsSystem>()->m_DebugRender = true;
-        auto ent = m_scene->GetEntityByTag("awesomeface");
-        if (ent)
-            ent->Add<Ren::NativeScriptComponent>().Bind<MovementScript>();
+        bindNativeScripts();
         m_scene->Init();
     }
 
+    // Returns entity with newly bound script.
+    std::optional<Ren::Entity> bindNativeScripts() {
+        auto ent = m_scene->GetEntityByTag("awesomeface");
+        if (!ent || ent->HasAll<Ren::NativeScriptComponent>())
+            return std::nullopt;
+        ent->Add<Ren::NativeScriptComponent>().Bind<MovementScript>();
+        return ent;
+    }
+
     void sceneFromScratch(bool serialize = false) {
         m_scene = CreateRef<Ren::Scene>(GetRenderer(), GetInput());
 
@@ -153,16 +174,14 @@ private:
             rig.body_def.type = b2_dynamicBody;
             rig.body_def.fixedRotation = false;
 
-            auto circle_shape = CreateRef<b2CircleShape>();
-            circle_shape->m_radius = size.x;
+            auto circle_shape = Ren::ShapeLibrary::Circle(size.x);
             b2FixtureDef fix;
             fix.density = 1.0f;
             fix.friction = 0.3f;
             fix.restitution = 0.67f;
             rig.fixtures.push_back({circle_shape, fix});
 
-            auto box_shape = CreateRef<b2PolygonShape>();
-            box_shape->SetAsBox(size.x, size.y, {0, 0.5f}, 0.0f);
+            auto box_shape = Ren::ShapeLibrary::Box(size.x, size.y, {0, 0.5f}, 0.0f);
             rig.fixtures.push_back({box_shape, fix});
         }
 
@@ -173,26 +192,20 @@ private:
 
         /////////// Box2D ///////////
         {
-            auto box_shape = CreateRef<b2PolygonShape>();
-
             Ren::Entity ground_body = m_scene->CreateEntity(
             Ren::TransformComponent({0.0f, -10.0f}), Ren::TagList{"ground"});
             auto &ground_body_r = ground_body.Add<Ren::RigidBodyComponent>();
-            box_shape->SetAsBox(50.0f, 10.0f);
-            ground_body_r.fixtures.push_back({box_shape, {}});
+            ground_body_r.fixtures.Add(Ren::ShapeLibrary::Box(50.0f, 10.0f));
 
             Ren::Entity another_body =
             m_scene->CreateEntity({{-1.7f, 2.0f}}, {"another_body"});
             auto &another_body_r = another_body.Add<Ren::RigidBodyComponent>();
-            box_shape = CreateRef<b2PolygonShape>();
-            box_shape->SetAsBox(1.0f, 1.0f);
-            another_body_r.fixtures.push_back({box_shape, {}});
+            another_body_r.fixtures.Add(Ren::ShapeLibrary::Box(1.0f, 1.0f));
 
             // Dynamic body
             Ren::Entity dynamic_body = m_scene->CreateEntity({{0.0f, 10.0f}}, {"dynamic_body"});
             auto &dynamic_body_r = dynamic_body.Add<Ren::RigidBodyComponent>();
-            box_shape = CreateRef<b2PolygonShape>();
-            box_shape->SetAsBox(1.5f, 1.f);
+            auto box_shape = Ren::ShapeLibrary::Box(1.5f, 1.f);
             dynamic_body_r.body_def.type = b2_dynamicBody;
             b2FixtureDef fix_def;
             fix_def.density = 1.0f;
@@ -85,6 +85,11 @@ public:
         ImGui::Checkbox("Scene grab input", &m_grabInput);
         static bool show_demo = false;
         ImGui::Checkbox("Show demo", &show_demo);
+        if (auto physics = m_DemoLayer->m_scene->GetSystem<Ren::PhysicsSystem>()) {
+            bool threaded = physics->IsThreaded();
+            if (ImGui::Checkbox("Threaded physics", &threaded))
+                physics->SetThreaded(threaded);
+        }
         ImGui::Separator();
         if (ImGui::Button("Exit"))
             m_GameCore->m_Run = false;
@@ -12,7 +12,7 @@ public:
         SAND_STATUS("Native movement script destroyed.");
     }
 
-    void OnContactBegin(Ren::Entity e, b2Contact* contact) override {
+    void OnContactBegin(Ren::Entity e, const Ren::ContactEvent& contact) override {
         std::string tags = "";
         for (auto&& tag : e.GetTags())
             tags += tag + " ";